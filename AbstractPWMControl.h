@@ -47,6 +47,7 @@ protected:
 	int status_flag = 0;
 	PWM** ppwms;
 	Digital** pdigitals;
+	Digital* enablePin[10] = {0,0,0,0,0,0,0,0,0,0}; // enable pin by channel, resolved when the channel is created
 	// 10 possible drive channels, index is by channel-1.
 	// pwmDrive[channel] [[PWM array index][dir pin][timer prescale][timer resolution]
 	// PWM params array by channel:
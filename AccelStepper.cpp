@@ -4,6 +4,7 @@
 // $Id: AccelStepper.cpp,v 1.24 2020/04/20 00:15:03 mikem Exp mikem $
 
 #include "AccelStepper.h"
+#include "StepperInterruptService.h"
 
 #if 0
 // Some debugging assistance
@@ -93,9 +94,134 @@ void AccelStepper::setCurrentPosition(long position)
 	_n = 0;
 	_stepInterval = 0;
 	_speed = 0.0;
+	_stepRate = 0;
 }
 
+/*
+* The profile run() steps on, the integer version by default, see STEPPER_INTEGER_PROFILE. Both are built so M709 can compare them.
+*/
 void AccelStepper::computeNewSpeed()
+{
+#ifdef STEPPER_INTEGER_PROFILE
+	computeNewSpeedInteger();
+#else
+	computeNewSpeedFloat();
+#endif
+}
+/*
+* Integer only version of the profile below. The float version takes a division per step in Equation 13 and a division for
+* Equation 16, which caps the step rate on AVR. Here the rate on a ramp is the rate at its start plus the acceleration times
+* the ticks since, a 24 by 24 bit multiply, as the step interrupt does it, and the interval comes from the speed_lookuptable tables
+* by calcStepTimer, so there is no division or sqrt per step. With constant acceleration the steps to stop from the present rate
+* are the steps taken to reach it, so _n, held while cruising at max speed, stands in for Equation 16.
+* The ramp from a stop starts at rest, with _startRate as the floor, and the rate is taken half the last interval on, at about the
+* middle of the coming step, which keeps the move time within a fraction of a percent of the float version, see M709.
+* Rates are bounded by the tables, STEPPER_MIN_RATE to STEPPER_MAX_RATE steps per second, the interval has the 0.5us resolution of the ticks.
+*/
+void AccelStepper::computeNewSpeedInteger()
+{
+	long distanceTo = distanceToGo(); // +ve is clockwise from curent location
+	long stepsToStop = _n < 0 ? -_n : _n;
+
+	if (distanceTo == 0 && stepsToStop <= 1)
+	{
+		// We are at the target and its time to stop
+		_stepInterval = 0;
+		_speed = 0.0;
+		_stepRate = 0;
+		_n = 0;
+		return;
+	}
+
+	if (distanceTo > 0)
+	{
+		if (_n > 0)
+		{
+			if ((stepsToStop >= distanceTo) || _direction == DIRECTION_CCW)
+			{
+				_n = -stepsToStop; // Start deceleration
+				_rampRate = _stepRate;
+				_rampTime = 0;
+			}
+		}
+		else if (_n < 0)
+		{
+			if ((stepsToStop < distanceTo) && _direction == DIRECTION_CW)
+			{
+				_n = -_n; // Start acceleration
+				_rampRate = _stepRate;
+				_rampTime = 0;
+			}
+		}
+	}
+	else if (distanceTo < 0)
+	{
+		if (_n > 0)
+		{
+			if ((stepsToStop >= -distanceTo) || _direction == DIRECTION_CW)
+			{
+				_n = -stepsToStop; // Start deceleration
+				_rampRate = _stepRate;
+				_rampTime = 0;
+			}
+		}
+		else if (_n < 0)
+		{
+			if ((stepsToStop < -distanceTo) && _direction == DIRECTION_CCW)
+			{
+				_n = -_n; // Start acceleration
+				_rampRate = _stepRate;
+				_rampTime = 0;
+			}
+		}
+	}
+
+	uint16_t rate;
+	bool ramping = true;
+	if (_n == 0)
+	{
+		// First step from stopped, the ramp itself starts at rest
+		rate = _startRate < _maxRate ? _startRate : _maxRate;
+		_rampRate = 0;
+		_rampTime = 0;
+		_direction = (distanceTo > 0) ? DIRECTION_CW : DIRECTION_CCW;
+		_n++;
+	}
+	else if (_n > 0)
+	{
+		// _stepInterval in us is half the last interval in ticks
+		rate = _rampRate + mulU24X24toH16(_rampTime + _stepInterval, _accelRate);
+		if (rate < _startRate)
+			rate = _startRate;
+		if (rate >= _maxRate || rate < _rampRate) {
+			rate = _maxRate; // cruising, hold _n at the steps it took to get here
+			ramping = false;
+		} else
+			_n++;
+	}
+	else
+	{
+		uint16_t delta = mulU24X24toH16(_rampTime + _stepInterval, _accelRate);
+		if (delta < _rampRate && _rampRate - delta > _startRate) {
+			rate = _rampRate - delta;
+		} else {
+			rate = _startRate;
+			ramping = false;
+		}
+		if (rate > _maxRate)
+			rate = _maxRate;
+		_n++;
+	}
+	uint16_t ticks = calcStepTimer(rate);
+	// the ramp time only runs on a ramp, off one the product with _accelRate would pass 16 bits and wrap the rate
+	if (ramping && _rampTime < 0xFFFFFF)
+		_rampTime += ticks;
+	_stepRate = rate;
+	_stepInterval = ticks >> 1;
+	_speed = (_direction == DIRECTION_CCW) ? -(float)rate : (float)rate;
+}
+
+void AccelStepper::computeNewSpeedFloat()
 {
 	long distanceTo = distanceToGo(); // +ve is clockwise from curent location
 
@@ -176,6 +302,32 @@ void AccelStepper::computeNewSpeed()
 	Serial.println("-----");
 	#endif
 }
+/*
+* Dry run of the profile for M709 and the host comparison in test/bench/stepper_profile.cpp, no pins are touched and no time is waited. profileMove sets up a move of steps from rest
+* at position 0, then each profileStep advances one step and returns the interval to the next in microseconds, 0 once stopped.
+*/
+unsigned long AccelStepper::profileMove(long steps, bool integer)
+{
+	setCurrentPosition(0);
+	_targetPos = steps;
+	if (integer)
+		computeNewSpeedInteger();
+	else
+		computeNewSpeedFloat();
+	return _stepInterval;
+}
+
+unsigned long AccelStepper::profileStep(bool integer)
+{
+	if (!_stepInterval)
+		return 0;
+	_currentPos += (_direction == DIRECTION_CW) ? 1 : -1;
+	if (integer)
+		computeNewSpeedInteger();
+	else
+		computeNewSpeedFloat();
+	return _stepInterval;
+}
 
 // Run the motor to implement speed and acceleration in order to proceed to the target position
 // You must call this at least once per step, preferably in your main loop
@@ -217,6 +369,12 @@ AccelStepper::AccelStepper(uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_
 	_cn = 0.0;
 	_cmin = 1.0;
 	_direction = DIRECTION_CCW;
+	_stepRate = 0;
+	_startRate = 1;
+	_maxRate = 1;
+	_rampRate = 0;
+	_rampTime = 0;
+	_accelRate = 0;
 
 	int i;
 	for (i = 0; i < 4; i++)
@@ -246,6 +404,7 @@ AccelStepper::AccelStepper(void (*forward)(), void (*backward)())
 	_pin[3] = 0;
 	_forward = forward;
 	_backward = backward;
+	Pins[0] = Pins[1] = Pins[2] = Pins[3] = NULL;
 
 	// NEW
 	_n = 0;
@@ -253,6 +412,12 @@ AccelStepper::AccelStepper(void (*forward)(), void (*backward)())
 	_cn = 0.0;
 	_cmin = 1.0;
 	_direction = DIRECTION_CCW;
+	_stepRate = 0;
+	_startRate = 1;
+	_maxRate = 1;
+	_rampRate = 0;
+	_rampTime = 0;
+	_accelRate = 0;
 
 	int i;
 	for (i = 0; i < 4; i++)
@@ -261,6 +426,12 @@ AccelStepper::AccelStepper(void (*forward)(), void (*backward)())
 	setAcceleration(1);
 }
 
+AccelStepper::~AccelStepper()
+{
+	for (uint8_t i = 0; i < 4; i++)
+		delete Pins[i];
+}
+
 void AccelStepper::setMaxSpeed(float speed)
 {
 	if (speed < 0.0)
@@ -269,6 +440,8 @@ void AccelStepper::setMaxSpeed(float speed)
 	{
 		_maxSpeed = speed;
 		_cmin = 1000000.0 / speed;
+		// the tables go no lower than STEPPER_MIN_RATE, below it calcStepTimer would use another interval than _stepRate says
+		_maxRate = speed > STEPPER_MAX_RATE ? STEPPER_MAX_RATE : (speed < STEPPER_MIN_RATE ? STEPPER_MIN_RATE : (uint16_t)speed);
 		// Recompute _n from current speed and adjust speed if accelerating or cruising
 		if (_n > 0)
 		{
@@ -296,6 +469,11 @@ void AccelStepper::setAcceleration(float acceleration)
 		// New c0 per Equation 7, with correction per Equation 15
 		_c0 = 0.676 * sqrt(2.0 / acceleration) * 1000000.0; // Equation 15
 		_acceleration = acceleration;
+		float startRate = ceil(1000000.0 / _c0);
+		_startRate = startRate > STEPPER_MAX_RATE ? STEPPER_MAX_RATE : (startRate < STEPPER_MIN_RATE ? STEPPER_MIN_RATE : (uint16_t)startRate);
+		_accelRate = (uint32_t)(min(acceleration, 65535.0) * 16777216.0 / (F_CPU / 8));
+		_rampRate = _stepRate;
+		_rampTime = 0;
 		computeNewSpeed();
 	}
 }
@@ -655,3 +833,32 @@ bool AccelStepper::isRunning()
 {
 	return !(_speed == 0.0 && _targetPos == _currentPos);
 }
+
+bool AccelStepper::stepOnce(boolean direction)
+{
+	_direction = direction ? DIRECTION_CW : DIRECTION_CCW;
+	if (_direction == DIRECTION_CW)
+		_currentPos += 1;
+	else
+		_currentPos -= 1;
+	_targetPos = _currentPos;
+	if (_interface == DRIVER)
+	{
+		// as step1, but the pulse width is left to the caller
+		setOutputPins(_direction ? 0b10 : 0b00); // Set direction first else get rogue pulses
+		setOutputPins(_direction ? 0b11 : 0b01); // step HIGH
+		return true;
+	}
+	step(_currentPos);
+	return false;
+}
+
+void AccelStepper::endStep()
+{
+	setOutputPins(_direction ? 0b10 : 0b00); // step LOW
+}
+
+float AccelStepper::acceleration()
+{
+	return _acceleration;
+}
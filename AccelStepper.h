@@ -379,6 +379,9 @@ class AccelStepper
 	/// \param[in] forward void-returning procedure that will make a forward step
 	/// \param[in] backward void-returning procedure that will make a backward step
 	AccelStepper(void (*forward)(), void (*backward)());
+
+	/// Releases the pin objects created by the constructor
+	virtual ~AccelStepper();
 	
 	/// Set the target position. The run() function will try to move the motor (at most one step per call)
 	/// from the current position to the target position set by the most
@@ -531,6 +534,33 @@ class AccelStepper
 	/// \return true if the speed is not zero or not at the target position
 	bool    isRunning();
 
+	/// Take exactly one step in the given direction and update the current position, with no timing of its own.
+	/// Used by StepperInterruptService to step from the timer interrupt, which does the timing.
+	/// A DRIVER stepper only sets the direction and raises the step pin, with no pulse delay, and the caller lowers it
+	/// with endStep() once the pulses of all the slots have been held together.
+	/// \param[in] direction true for clockwise, false for anticlockwise
+	/// \return true if the step pin was left high for endStep()
+	bool    stepOnce(boolean direction);
+
+	/// Lower the step pin raised by stepOnce() on a DRIVER stepper.
+	void    endStep();
+
+	/// Start a dry run of a move of steps from rest at position 0 with the integer or float profile, for the M709 comparison.
+	/// No pins are touched and the position is left wherever the dry run ends.
+	/// \param[in] steps The steps of the move, + clockwise
+	/// \param[in] integer true for the integer profile, false for the float one
+	/// \return The interval to the first step in microseconds
+	unsigned long profileMove(long steps, bool integer);
+
+	/// Advance the dry run started by profileMove() one step.
+	/// \param[in] integer The profile given to profileMove()
+	/// \return The interval to the next step in microseconds, 0 once the move has stopped
+	unsigned long profileStep(bool integer);
+
+	/// Returns the acceleration set by setAcceleration()
+	/// \return The acceleration in steps per second per second
+	float   acceleration();
+
 	protected:
 
 	/// \brief Direction indicator
@@ -551,6 +581,10 @@ class AccelStepper
 	/// move() or moveTo()
 	void           computeNewSpeed();
 
+	/// The two profiles computeNewSpeed() chooses from with STEPPER_INTEGER_PROFILE
+	void           computeNewSpeedInteger();
+	void           computeNewSpeedFloat();
+
 	/// Low level function to set the motor output pins
 	/// bit 0 of the mask corresponds to _pin[0]
 	/// bit 1 of the mask corresponds to _pin[1]
@@ -687,6 +721,14 @@ class AccelStepper
 
 	/// Min step size in microseconds based on maxSpeed
 	float _cmin; // at max speed
+
+	/// Integer profile, see computeNewSpeed. Rates in steps per second, times in 2MHz timer ticks
+	uint16_t _stepRate; // present rate, 0 stopped
+	uint16_t _startRate; // first step from stopped, Equation 15
+	uint16_t _maxRate; // at max speed
+	uint16_t _rampRate; // rate at the start of the present ramp
+	uint32_t _rampTime; // ticks since the start of the present ramp
+	uint32_t _accelRate; // acceleration in steps per second per tick, scaled by 2^24
 	
 	Digital* Pins[4];
 
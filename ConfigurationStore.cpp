@@ -28,13 +28,14 @@ void _EEPROM_readData(int &pos, uint8_t* value, uint8_t size)
 // the default values are used whenever there is a change to the data, to prevent
 // wrong data being written to the variables.
 // ALSO:  always make sure the variables in the Store and retrieve sections are in the same order.
-#define EEPROM_VERSION "V10"
+#define EEPROM_VERSION "V11"
 
 void Config_StoreSettings() 
 {
   char ver[4]= "000";
   int i=EEPROM_OFFSET;
   EEPROM_WRITE_VAR(i,ver); // invalidate data first  
+  EEPROM_WRITE_VAR(i,imuCalibration);
   //EEPROM_WRITE_VAR(i,max_acceleration_units_per_sq_second);
   //EEPROM_WRITE_VAR(i,acceleration);
   char ver2[4]=EEPROM_VERSION;
@@ -52,6 +53,22 @@ void Config_PrintSettings()
     //SERIAL_ECHOPAIR("  M201 X" ,max_acceleration_units_per_sq_second[0] ); 
     SERIAL_PGMLN("2 ");
     //SERIAL_ECHOPAIR("  M204 S",acceleration );
+	// IMU calibration, gyro bias, mag offset, mag scale, as M21
+	for(int j = 0; j < 3; j++) {
+		SERIAL_PORT.print(j+3);
+		SERIAL_PORT.print(' ');
+		SERIAL_PORT.println(imuCalibration.gyroBias[j]);
+	}
+	for(int j = 0; j < 3; j++) {
+		SERIAL_PORT.print(j+6);
+		SERIAL_PORT.print(' ');
+		SERIAL_PORT.println(imuCalibration.magOffset[j]);
+	}
+	for(int j = 0; j < 3; j++) {
+		SERIAL_PORT.print(j+9);
+		SERIAL_PORT.print(' ');
+		SERIAL_PORT.println(imuCalibration.magScale[j]);
+	}
 	SERIAL_PGM(MSG_BEGIN);
 	SERIAL_PGM(eepromHdr);
 	SERIAL_PGMLN(MSG_TERMINATE);
@@ -67,6 +84,7 @@ void Config_RetrieveSettings()
     if (strncmp(ver,stored_ver,3) == 0)
     {
         // version number match
+        EEPROM_READ_VAR(i,imuCalibration);
         //EEPROM_READ_VAR(i,axis_steps_per_unit);  
         //EEPROM_READ_VAR(i,max_acceleration_units_per_sq_second);
         
@@ -112,6 +130,12 @@ void Config_ResetDefault()
     //minimumfeedrate=DEFAULT_MINIMUMFEEDRATE;
     //minsegmenttime=DEFAULT_MINSEGMENTTIME;       
     //mintravelfeedrate=DEFAULT_MINTRAVELFEEDRATE;
+    for (short j=0;j<3;j++)
+    {
+        imuCalibration.gyroBias[j]=0;
+        imuCalibration.magOffset[j]=0;
+        imuCalibration.magScale[j]=IMU_CAL_ONE;
+    }
 //SERIAL_ECHO_START;
 //SERIAL_ECHOLNPGM("Hardcoded Default Settings Loaded");
 
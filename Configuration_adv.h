@@ -52,11 +52,79 @@ High High High	Sixteenth step
 
 
 
+//===========================================================================
+//=============================Motor Control     ============================
+//===========================================================================
+// Interval in milliseconds at which the per channel acceleration/deceleration ramp set by M14 is stepped toward target
+#define MOTOR_RAMP_INTERVAL 10
+// Interval in milliseconds at which channel currents are sampled against the limits set by M16
+#define CURRENT_SAMPLE_INTERVAL 50
+// Output scale, in 1/1000, restored per current sample once a limited channel is back under its limit
+#define CURRENT_LIMIT_RECOVERY 20
+
+//===========================================================================
+//=============================Stepper Control   ============================
+//===========================================================================
+// 16 bit timer given over to the step interrupt of G200-G203, run in CTC mode at prescale 8. Its PWM pins are then unavailable,
+// Timer5 takes pins 44,45,46.
+#define STEPPER_TIMER Timer5
+// Highest step rate in steps per second, one step per interrupt
+#define STEPPER_MAX_RATE 10000
+// Microseconds a W1 driver step pin is held high by the step interrupt, once per event for all slots together, a constant so the
+// delay compiles to a fixed loop. The G200 F pulse width only applies when stepping from run()
+#define STEPPER_PULSE_WIDTH 2
+// Rate in steps per second a move starts from and stops at
+#define STEPPER_START_RATE 120
+// Largest instant change in steps per second of any one slot at the junction of two queued moves, the planner slows the junction to keep under it
+#define STEPPER_JERK 200
+// AccelStepper run() and runToPosition() take the step intervals of their acceleration profile from the speed_lookuptable tables
+// with integer arithmetic instead of the float division per step of the original, comment out to go back to float
+#define STEPPER_INTEGER_PROFILE
+
+//===========================================================================
+//=============================IMU               ============================
+//===========================================================================
+// Pin change interrupt pins wired to the L3GD20 DRDY/INT2, LSM303 accel INT1 and LSM303 mag DRDY outputs
+#define IMU_GYRO_INT_PIN 67
+#define IMU_ACCEL_INT_PIN 68
+#define IMU_MAG_INT_PIN 52
+// The gyro and accel fill their hardware FIFOs and interrupt on the watermark, the mag DRDY is active low on each sample
+#define IMU_FIFO_WATERMARK 4
+// Samples read from a FIFO per I2C transaction
+#define IMU_FIFO_BURST 8
+// Microseconds between samples at the output data rates set, gyro 190Hz, accel 200Hz, mag 220Hz
+#define IMU_GYRO_PERIOD 5263
+#define IMU_ACCEL_PERIOD 5000
+// Timestamped samples waiting for the fusion stage, power of 2, the oldest are dropped when it is full
+#define IMU_SAMPLE_BUFFER 32
+// Mahony filter gains, proportional pulls the gyro integration to the accel and mag, integral learns the gyro bias
+#define IMU_FUSION_KP 0.5
+#define IMU_FUSION_KI 0.0
+// Least gyro samples for a bias, about 2/3 second at rest, and least mag half range in counts on each axis for a calibration
+#define IMU_CAL_GYRO_SAMPLES 128
+#define IMU_CAL_MAG_RADIUS 100
+// Milliseconds between BMP085 temperature and pressure cycles, a cycle takes about 32ms in ultra high resolution
+#define IMU_BARO_PERIOD 50
+
+//===========================================================================
+//=============================Profiling         ============================
+//===========================================================================
+// Count the runs and cycles of each interrupt vector for M707, costs about 30 cycles a vector and 690 bytes of RAM
+//#define ISR_PROFILE
+// 16 bit timer run free at the CPU clock to time the vectors, claimed for the whole of its time at setup
+#define ISR_PROFILE_TIMER Timer1
+#define ISR_PROFILE_TCNT TCNT1
+// Time the main loop period, each G and M code and manage_inactivity for M708, costs a few micros() calls a pass and about 400 bytes of RAM
+#define LOOP_PROFILE
+// Distinct codes timed, and buckets of the loop period histogram from under 64us doubling to 65ms and over
+#define LOOP_PROFILE_CODES 16
+#define LOOP_PROFILE_BUCKETS 12
+
 //===========================================================================
 //=============================Buffers           ============================
 //===========================================================================
 
-// The number of linear motions that can be in the plan at any give time.
+// The number of linear motions that can be in the plan at any give time, also the stepper moves queued by G202-G204.
 // THE BLOCK_BUFFER_SIZE NEEDS TO BE A POWER OF 2, i.g. 8,16,32 because shifts and ors are used to do the ring-buffering.
 #define BLOCK_BUFFER_SIZE 16 // maximize block buffer
 
@@ -23,10 +23,14 @@ class CounterInterruptService: public InterruptService {
 	//Interrupt Service Routine. RoboCore provides a virtual base defining the 'service' method for all unified interrupt requests
 	void service(void)
 	{	
+		count();
+	}
+	// the count itself, called directly from the INTn vectors
+	inline void count(void)
+	{
 		if( counter < maxcount ) {
 			++counter;
-		} 
-			
+		}
 	}
 	
 	int get_counter() {
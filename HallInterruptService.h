@@ -42,9 +42,9 @@ class HallInterruptService: public InterruptService {
 	BLDC3PhaseSensor* motor; // main motor object ref
 	HallInterruptService(BLDC3PhaseSensor* motor) { this->motor = motor; }
 	//Pin Change Interrupt Service Routine. RoboCore provides a virtual base defining the 'service' method for all unified interrupt requests
+	// Called from the ISR with interrupts already off, and they stay off until it returns
 	void service(void)
 	{
-		cli();
 		fastTemp.word = motor->Read_hall_pins();
 		// check for potential garbage
 		if( fastTemp.word >= validHallLo && fastTemp.word <= validHallHi  && fastTemp.word != lastHall) {
@@ -74,7 +74,6 @@ class HallInterruptService: public InterruptService {
 			_delay_ms(20); // discharge
 			motor->Stop_motor();
 		}
-		sei();	
 	}
 
 };
@@ -190,6 +190,35 @@ int HardwareSerial::availableForWrite(void)
   return tail - head - 1;
 }
 
+// The receive counters are written by the RX interrupt, read them with it held off
+uint32_t HardwareSerial::getRxCount(void)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  uint32_t count = _rx_count;
+  SREG = oldSREG;
+  return count;
+}
+
+uint16_t HardwareSerial::getRxDropped(void)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t dropped = _rx_dropped;
+  SREG = oldSREG;
+  return dropped;
+}
+
+void HardwareSerial::resetCounts(void)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  _rx_count = 0;
+  _rx_dropped = 0;
+  SREG = oldSREG;
+  _tx_count = 0;
+}
+
 void HardwareSerial::flush()
 {
   // If we have never written a byte, no need to flush. This special
@@ -213,6 +242,7 @@ void HardwareSerial::flush()
 size_t HardwareSerial::write(uint8_t c)
 {
   _written = true;
+  ++_tx_count;
   // If the buffer and the data register is empty, just write the byte
   // to the data register and be done. This shortcut helps
   // significantly improve the effective datarate at high (>
@@ -106,6 +106,10 @@ class HardwareSerial : public Stream
     volatile rx_buffer_index_t _rx_buffer_tail;
     volatile tx_buffer_index_t _tx_buffer_head;
     volatile tx_buffer_index_t _tx_buffer_tail;
+    // Bytes received and written since startup or resetCounts(), and received bytes lost to a full buffer
+    volatile uint32_t _rx_count;
+    volatile uint16_t _rx_dropped;
+    uint32_t _tx_count;
 
     // Don't put any members after these buffers, since only the first
     // 32 bytes of this struct can be accessed quickly using the ldd
@@ -133,6 +137,10 @@ class HardwareSerial : public Stream
     inline size_t write(int n) { return write((uint8_t)n); }
     using Print::write; // pull in write(str) and write(buf, size) from Print
     operator bool() { return true; }
+    uint32_t getRxCount(void);
+    uint16_t getRxDropped(void);
+    inline uint32_t getTxCount(void) { return _tx_count; }
+    void resetCounts(void);
 
     // Interrupt handlers - Not intended to be called externally
     inline void _rx_complete_irq(void);
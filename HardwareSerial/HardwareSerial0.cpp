@@ -25,6 +25,7 @@
 #include "../Arduino.h"
 #include "HardwareSerial.h"
 #include "HardwareSerial_private.h"
+#include "../IsrProfile.h"
 
 // Each HardwareSerial is defined in its own file, sine the linker pulls
 // in the entire file when any element inside is used. --gc-sections can
@@ -46,6 +47,7 @@
   #error "Don't know what the Data Received vector is called for Serial"
 #endif
   {
+    ISR_PROFILE_SCOPE(USART0_RX_vect_num)
     Serial._rx_complete_irq();
   }
 
@@ -61,6 +63,7 @@ ISR(USART_UDRE_vect)
   #error "Don't know what the Data Register Empty vector is called for Serial"
 #endif
 {
+  ISR_PROFILE_SCOPE(USART0_UDRE_vect_num)
   Serial._tx_udr_empty_irq();
 }
 
@@ -25,6 +25,7 @@
 #include "../Arduino.h"
 #include "HardwareSerial.h"
 #include "HardwareSerial_private.h"
+#include "../IsrProfile.h"
 
 // Each HardwareSerial is defined in its own file, sine the linker pulls
 // in the entire file when any element inside is used. --gc-sections can
@@ -44,6 +45,7 @@ ISR(USART1_RX_vect)
 #error "Don't know what the Data Register Empty vector is called for Serial1"
 #endif
 {
+  ISR_PROFILE_SCOPE(USART1_RX_vect_num)
   Serial1._rx_complete_irq();
 }
 
@@ -55,6 +57,7 @@ ISR(USART1_UDRE_vect)
 #error "Don't know what the Data Register Empty vector is called for Serial1"
 #endif
 {
+  ISR_PROFILE_SCOPE(USART1_UDRE_vect_num)
   Serial1._tx_udr_empty_irq();
 }
 
@@ -25,6 +25,7 @@
 #include "../Arduino.h"
 #include "HardwareSerial.h"
 #include "HardwareSerial_private.h"
+#include "../IsrProfile.h"
 
 // Each HardwareSerial is defined in its own file, sine the linker pulls
 // in the entire file when any element inside is used. --gc-sections can
@@ -38,11 +39,13 @@
 
 ISR(USART2_RX_vect)
 {
+  ISR_PROFILE_SCOPE(USART2_RX_vect_num)
   Serial2._rx_complete_irq();
 }
 
 ISR(USART2_UDRE_vect)
 {
+  ISR_PROFILE_SCOPE(USART2_UDRE_vect_num)
   Serial2._tx_udr_empty_irq();
 }
 
@@ -92,7 +92,8 @@ HardwareSerial::HardwareSerial(
     _ucsra(ucsra), _ucsrb(ucsrb), _ucsrc(ucsrc),
     _udr(udr),
     _rx_buffer_head(0), _rx_buffer_tail(0),
-    _tx_buffer_head(0), _tx_buffer_tail(0)
+    _tx_buffer_head(0), _tx_buffer_tail(0),
+    _rx_count(0), _rx_dropped(0), _tx_count(0)
 {
 }
 
@@ -104,6 +105,7 @@ void HardwareSerial::_rx_complete_irq(void)
     // No Parity error, read byte and store it in the buffer if there is
     // room
     unsigned char c = *_udr;
+    ++_rx_count;
     rx_buffer_index_t i = (unsigned int)(_rx_buffer_head + 1) % SERIAL_RX_BUFFER_SIZE;
 
     // if we should be storing the received character into the location
@@ -113,6 +115,8 @@ void HardwareSerial::_rx_complete_irq(void)
     if (i != _rx_buffer_tail) {
       _rx_buffer[_rx_buffer_head] = c;
       _rx_buffer_head = i;
+    } else {
+      ++_rx_dropped;
     }
   } else {
     // Parity error, read byte but discard it
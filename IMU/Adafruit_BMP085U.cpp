@@ -46,17 +46,20 @@ void Adafruit_BMP085_Unified::readCoefficients(void)
     _bmp085_coeffs.md  = 2868;
     _bmp085Mode        = 0;
   #else
-    _bmp085_coeffs.ac1 = (int)read16(BMP085_ADDRESS, BMP085_REGISTER_CAL_AC1);
-    _bmp085_coeffs.ac2 = (int)read16(BMP085_ADDRESS,BMP085_REGISTER_CAL_AC2);
-    _bmp085_coeffs.ac3 = (int)read16(BMP085_ADDRESS,BMP085_REGISTER_CAL_AC3);
-    _bmp085_coeffs.ac4 = read16(BMP085_ADDRESS,BMP085_REGISTER_CAL_AC4);
-    _bmp085_coeffs.ac5 = read16(BMP085_ADDRESS,BMP085_REGISTER_CAL_AC5);
-    _bmp085_coeffs.ac6 = read16(BMP085_ADDRESS,BMP085_REGISTER_CAL_AC6);
-    _bmp085_coeffs.b1 = (int)read16(BMP085_ADDRESS,BMP085_REGISTER_CAL_B1);
-    _bmp085_coeffs.b2 = (int)read16(BMP085_ADDRESS,BMP085_REGISTER_CAL_B2);
-    _bmp085_coeffs.mb = (int)read16(BMP085_ADDRESS,BMP085_REGISTER_CAL_MB);
-    _bmp085_coeffs.mc = (int)read16(BMP085_ADDRESS,BMP085_REGISTER_CAL_MC);
-    _bmp085_coeffs.md = (int)read16(BMP085_ADDRESS,BMP085_REGISTER_CAL_MD);
+    // the 11 big endian words from AC1 to MD in one burst
+    uint8_t raw[22];
+    readBurst(BMP085_ADDRESS, BMP085_REGISTER_CAL_AC1, raw, 22);
+    _bmp085_coeffs.ac1 = (int16_t)((raw[0] << 8) | raw[1]);
+    _bmp085_coeffs.ac2 = (int16_t)((raw[2] << 8) | raw[3]);
+    _bmp085_coeffs.ac3 = (int16_t)((raw[4] << 8) | raw[5]);
+    _bmp085_coeffs.ac4 = (uint16_t)((raw[6] << 8) | raw[7]);
+    _bmp085_coeffs.ac5 = (uint16_t)((raw[8] << 8) | raw[9]);
+    _bmp085_coeffs.ac6 = (uint16_t)((raw[10] << 8) | raw[11]);
+    _bmp085_coeffs.b1 = (int16_t)((raw[12] << 8) | raw[13]);
+    _bmp085_coeffs.b2 = (int16_t)((raw[14] << 8) | raw[15]);
+    _bmp085_coeffs.mb = (int16_t)((raw[16] << 8) | raw[17]);
+    _bmp085_coeffs.mc = (int16_t)((raw[18] << 8) | raw[19]);
+    _bmp085_coeffs.md = (int16_t)((raw[20] << 8) | raw[21]);
   #endif
 }
 
@@ -84,10 +87,6 @@ void Adafruit_BMP085_Unified::readRawPressure(int32_t *pressure)
   #if BMP085_USE_DATASHEET_VALS
     *pressure = 23843;
   #else
-    uint8_t  p8;
-    uint16_t p16;
-    int32_t  p32;
-
     write8(BMP085_ADDRESS, BMP085_REGISTER_CONTROL, BMP085_REGISTER_READPRESSURECMD + (_bmp085Mode << 6));
     switch(_bmp085Mode)
     {
@@ -106,16 +105,138 @@ void Adafruit_BMP085_Unified::readRawPressure(int32_t *pressure)
         break;
     }
 
-    p16 = read16(BMP085_ADDRESS,BMP085_REGISTER_PRESSUREDATA);
-    p32 = (uint32_t)p16 << 8;
-    p8 = read8(BMP085_ADDRESS,BMP085_REGISTER_PRESSUREDATA+2);
-    p32 += p8;
-    p32 >>= (8 - _bmp085Mode);
-    
-    *pressure = p32;
+    *pressure = readPressureData();
   #endif
 }
 
+/**************************************************************************/
+/*!
+    @brief  Reads the finished pressure conversion, MSB, LSB and XLSB
+            in one burst
+*/
+/**************************************************************************/
+int32_t Adafruit_BMP085_Unified::readPressureData(void)
+{
+  uint8_t raw[3];
+  int32_t p32;
+  readBurst(BMP085_ADDRESS, BMP085_REGISTER_PRESSUREDATA, raw, 3);
+  p32 = ((uint32_t)raw[0] << 16) | ((uint16_t)raw[1] << 8) | raw[2];
+  p32 >>= (8 - _bmp085Mode);
+  return p32;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Milliseconds to wait for a pressure conversion in the mode set,
+            the datasheet maximum rounded up
+*/
+/**************************************************************************/
+uint8_t Adafruit_BMP085_Unified::pressureTime(void)
+{
+  switch(_bmp085Mode)
+  {
+    case BMP085_MODE_ULTRALOWPOWER:
+      return 5;
+    case BMP085_MODE_STANDARD:
+      return 8;
+    case BMP085_MODE_HIGHRES:
+      return 14;
+    default:
+      return 26;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Advances the conversions without waiting on them, call it often
+            from the main loop. Idle starts a temperature conversion, a
+            finished temperature is read and a pressure conversion started,
+            a finished pressure is read and compensated. Returns 1 when a
+            new temperature and pressure are ready, then it is idle again.
+            A conversion is done when millis has moved past its time,
+            so the wait is at least the conversion time whatever the
+            millis phase.
+*/
+/**************************************************************************/
+uint8_t Adafruit_BMP085_Unified::update(uint32_t now)
+{
+  switch(_state)
+  {
+    case BMP085_IDLE:
+      write8(BMP085_ADDRESS, BMP085_REGISTER_CONTROL, BMP085_REGISTER_READTEMPCMD);
+      _startTime = now;
+      _state = BMP085_TEMPERATURE;
+      return 0;
+    case BMP085_TEMPERATURE:
+      if ((now - _startTime) <= BMP085_TEMPERATURE_MS)
+        return 0;
+      _b5 = computeB5((int32_t)read16(BMP085_ADDRESS, BMP085_REGISTER_TEMPDATA));
+      _temperature = (int16_t)((_b5 + 8) >> 4);
+      write8(BMP085_ADDRESS, BMP085_REGISTER_CONTROL, BMP085_REGISTER_READPRESSURECMD + (_bmp085Mode << 6));
+      _startTime = now;
+      _state = BMP085_PRESSURE;
+      return 0;
+    case BMP085_PRESSURE:
+      if ((now - _startTime) <= pressureTime())
+        return 0;
+      _pressure = computePressure(readPressureData(), _b5);
+      _state = BMP085_IDLE;
+      return 1;
+    default:
+      _state = BMP085_IDLE;
+      return 0;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Datasheet temperature term B5 from the raw temperature, integer,
+            the temperature is (B5 + 8) >> 4 in 0.1C
+*/
+/**************************************************************************/
+int32_t Adafruit_BMP085_Unified::computeB5(int32_t ut)
+{
+  int32_t x1 = ((ut - (int32_t)_bmp085_coeffs.ac6) * (int32_t)_bmp085_coeffs.ac5) >> 15;
+  int32_t x2 = ((int32_t)_bmp085_coeffs.mc << 11) / (x1 + (int32_t)_bmp085_coeffs.md);
+  return x1 + x2;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Datasheet pressure compensation in Pa, integer
+*/
+/**************************************************************************/
+int32_t Adafruit_BMP085_Unified::computePressure(int32_t up, int32_t b5)
+{
+  int32_t  x1, x2, b6, x3, b3, p;
+  uint32_t b4, b7;
+
+  b6 = b5 - 4000;
+  x1 = (_bmp085_coeffs.b2 * ((b6 * b6) >> 12)) >> 11;
+  x2 = (_bmp085_coeffs.ac2 * b6) >> 11;
+  x3 = x1 + x2;
+  b3 = (((((int32_t) _bmp085_coeffs.ac1) * 4 + x3) << _bmp085Mode) + 2) >> 2;
+  x1 = (_bmp085_coeffs.ac3 * b6) >> 13;
+  x2 = (_bmp085_coeffs.b1 * ((b6 * b6) >> 12)) >> 16;
+  x3 = ((x1 + x2) + 2) >> 2;
+  b4 = (_bmp085_coeffs.ac4 * (uint32_t) (x3 + 32768)) >> 15;
+  b7 = ((uint32_t) (up - b3) * (50000 >> _bmp085Mode));
+
+  if (b7 < 0x80000000)
+  {
+    p = (b7 << 1) / b4;
+  }
+  else
+  {
+    p = (b7 / b4) << 1;
+  }
+
+  x1 = (p >> 8) * (p >> 8);
+  x1 = (x1 * 3038) >> 16;
+  x2 = (-7357 * p) >> 16;
+  return p + ((x1 + x2 + 3791) >> 4);
+}
+
 /**************************************************************************/
 /*!
     @brief  Instantiates a new Adafruit_BMP085_Unified class
@@ -123,6 +244,9 @@ void Adafruit_BMP085_Unified::readRawPressure(int32_t *pressure)
 /**************************************************************************/
 Adafruit_BMP085_Unified::Adafruit_BMP085_Unified(int32_t sensorID) {
   _sensorID = sensorID;
+  _state = BMP085_IDLE;
+  _temperature = 0;
+  _pressure = 0;
 }
 
 /***************************************************************************
@@ -168,47 +292,14 @@ bool Adafruit_BMP085_Unified::begin(bmp085_mode_t mode)
 /**************************************************************************/
 void Adafruit_BMP085_Unified::getPressure(float *pressure)
 {
-  int32_t  ut = 0, up = 0, compp = 0;
-  int32_t  x1, x2, b5, b6, x3, b3, p;
-  uint32_t b4, b7;
+  int32_t  ut = 0, up = 0;
 
   /* Get the raw pressure and temperature values */
   readRawTemperature(&ut);
   readRawPressure(&up);
 
-  /* Temperature compensation */
-  x1 = (ut - (int32_t)(_bmp085_coeffs.ac6))*((int32_t)(_bmp085_coeffs.ac5))/pow(2,15);
-  x2 = ((int32_t)(_bmp085_coeffs.mc*pow(2,11)))/(x1+(int32_t)(_bmp085_coeffs.md));
-  b5 = x1 + x2;
-
-  /* Pressure compensation */
-  b6 = b5 - 4000;
-  x1 = (_bmp085_coeffs.b2 * ((b6 * b6) >> 12)) >> 11;
-  x2 = (_bmp085_coeffs.ac2 * b6) >> 11;
-  x3 = x1 + x2;
-  b3 = (((((int32_t) _bmp085_coeffs.ac1) * 4 + x3) << _bmp085Mode) + 2) >> 2;
-  x1 = (_bmp085_coeffs.ac3 * b6) >> 13;
-  x2 = (_bmp085_coeffs.b1 * ((b6 * b6) >> 12)) >> 16;
-  x3 = ((x1 + x2) + 2) >> 2;
-  b4 = (_bmp085_coeffs.ac4 * (uint32_t) (x3 + 32768)) >> 15;
-  b7 = ((uint32_t) (up - b3) * (50000 >> _bmp085Mode));
-
-  if (b7 < 0x80000000)
-  {
-    p = (b7 << 1) / b4;
-  }
-  else
-  {
-    p = (b7 / b4) << 1;
-  }
-
-  x1 = (p >> 8) * (p >> 8);
-  x1 = (x1 * 3038) >> 16;
-  x2 = (-7357 * p) >> 16;
-  compp = p + ((x1 + x2 + 3791) >> 4);
-
   /* Assign compensated pressure value */
-  *pressure = compp;
+  *pressure = computePressure(up, computeB5(ut));
 }
 
 /**************************************************************************/
@@ -218,8 +309,7 @@ void Adafruit_BMP085_Unified::getPressure(float *pressure)
 /**************************************************************************/
 void Adafruit_BMP085_Unified::getTemperature(float *temp)
 {
-  int32_t UT, X1, X2, B5;     // following ds convention
-  float t;
+  int32_t UT;     // following ds convention
 
   readRawTemperature(&UT);
 
@@ -232,14 +322,7 @@ void Adafruit_BMP085_Unified::getTemperature(float *temp)
     _bmp085_coeffs.md = 2868;
   #endif
 
-  // step 1
-  X1 = (UT - (int32_t)_bmp085_coeffs.ac6) * ((int32_t)_bmp085_coeffs.ac5) / pow(2,15);
-  X2 = ((int32_t)_bmp085_coeffs.mc * pow(2,11)) / (X1+(int32_t)_bmp085_coeffs.md);
-  B5 = X1 + X2;
-  t = (B5+8)/pow(2,4);
-  t /= 10;
-
-  *temp = t;
+  *temp = ((computeB5(UT) + 8) >> 4) / 10.0F;
 }
 
 /**************************************************************************/
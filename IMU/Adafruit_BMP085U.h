@@ -67,6 +67,15 @@
     } bmp085_mode_t;
 /*=========================================================================*/
 
+/*=========================================================================
+    CONVERSION STATE, for update()
+    -----------------------------------------------------------------------*/
+    #define BMP085_IDLE                   (0)
+    #define BMP085_TEMPERATURE            (1)   // temperature conversion running
+    #define BMP085_PRESSURE               (2)   // pressure conversion running
+    #define BMP085_TEMPERATURE_MS         (5)   // 4.5ms conversion
+/*=========================================================================*/
+
 /*=========================================================================
     CALIBRATION DATA
     -----------------------------------------------------------------------*/
@@ -101,8 +110,21 @@ class Adafruit_BMP085_Unified : public Adafruit_Sensor
 	void readRawPressure(int32_t *pressure);
 	void readRawTemperature(int32_t *temperature);
 	void readCoefficients(void);
+    uint8_t update(uint32_t now);
+    inline uint8_t isIdle(void) { return _state == BMP085_IDLE; }
+    inline int16_t getTemperature10(void) { return _temperature; }  // last reading from update, 0.1C
+    inline int32_t getPressurePa(void) { return _pressure; }  // last reading from update, Pa
   private:
     int32_t           _sensorID;
+    uint8_t           _state;
+    uint32_t          _startTime;    // millis the running conversion started
+    int32_t           _b5;           // temperature term for the pressure compensation
+    int16_t           _temperature;
+    int32_t           _pressure;
+    int32_t computeB5(int32_t ut);
+    int32_t computePressure(int32_t up, int32_t b5);
+    int32_t readPressureData(void);
+    uint8_t pressureTime(void);
 };
 
 #endif /* ADAFRUIT_BMP085U_H_ */
\ No newline at end of file
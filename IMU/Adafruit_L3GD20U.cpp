@@ -26,6 +26,7 @@
 /**************************************************************************/
 Adafruit_L3GD20_Unified::Adafruit_L3GD20_Unified() {
   _autoRangeEnabled = false;
+  calibration = NULL;
 }
 
  
@@ -160,6 +161,42 @@ void Adafruit_L3GD20_Unified::enableAutoRange(bool enabled)
   _autoRangeEnabled = enabled;
 }
 
+/**************************************************************************/
+/*! 
+    @brief  Runs at 190Hz into the FIFO in stream mode, with the watermark
+            interrupt on DRDY/INT2, for the IMU interrupt pipeline
+*/
+/**************************************************************************/
+void Adafruit_L3GD20_Unified::enableFIFO(uint8_t watermark)
+{
+  /* DR = 01 190Hz, BW = 00, normal mode, all axes */
+  write8(L3GD20_ADDRESS, GYRO_REGISTER_CTRL_REG1, 0b01001111);
+  /* I2_WTM */
+  write8(L3GD20_ADDRESS, GYRO_REGISTER_CTRL_REG3, 0b00000100);
+  /* FIFO_EN */
+  write8(L3GD20_ADDRESS, GYRO_REGISTER_CTRL_REG5, 0b01000000);
+  /* FM = 010 stream mode, WTM */
+  write8(L3GD20_ADDRESS, GYRO_REGISTER_FIFO_CTRL_REG, 0b01000000 | (watermark & 0x1F));
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Rad/s per count at the current range, for raw FIFO samples
+*/
+/**************************************************************************/
+float Adafruit_L3GD20_Unified::getScale(void)
+{
+  switch(_range)
+  {
+    case GYRO_RANGE_500DPS:
+      return GYRO_SENSITIVITY_500DPS * SENSORS_DPS_TO_RADS;
+    case GYRO_RANGE_2000DPS:
+      return GYRO_SENSITIVITY_2000DPS * SENSORS_DPS_TO_RADS;
+    default:
+      return GYRO_SENSITIVITY_250DPS * SENSORS_DPS_TO_RADS;
+  }
+}
+
 /**************************************************************************/
 /*! 
     @brief  Gets the most recent sensor event
@@ -180,18 +217,14 @@ void Adafruit_L3GD20_Unified::getEvent(sensors_event_t* event)
   {
     event->timestamp = 0;//millis();
  
-    uint8_t xlo = read8(L3GD20_ADDRESS, GYRO_REGISTER_OUT_X_L);
-    uint8_t xhi = read8(L3GD20_ADDRESS, GYRO_REGISTER_OUT_X_H);
-    uint8_t ylo = read8(L3GD20_ADDRESS, GYRO_REGISTER_OUT_Y_L);
-    uint8_t yhi = read8(L3GD20_ADDRESS, GYRO_REGISTER_OUT_Y_H);
-    uint8_t zlo = read8(L3GD20_ADDRESS, GYRO_REGISTER_OUT_Z_L);
-    uint8_t zhi = read8(L3GD20_ADDRESS, GYRO_REGISTER_OUT_Z_H);
-	
-	
+    /* X Y Z low then high in one burst from OUT_X_L */
+    uint8_t raw[6];
+    readBurst(L3GD20_ADDRESS, GYRO_REGISTER_OUT_X_L | GYRO_AUTO_INCREMENT, raw, 6);
+
     /* Shift values to create properly formed integer (low byte first) */
-    event->gyro.x = (int16_t)(xlo | (xhi << 8));
-    event->gyro.y = (int16_t)(ylo | (yhi << 8));
-    event->gyro.z = (int16_t)(zlo | (zhi << 8));
+    event->gyro.x = (int16_t)(raw[0] | (raw[1] << 8));
+    event->gyro.y = (int16_t)(raw[2] | (raw[3] << 8));
+    event->gyro.z = (int16_t)(raw[4] | (raw[5] << 8));
     
     /* Make sure the sensor isn't saturating if auto-ranging is enabled */
     if (!_autoRangeEnabled)
@@ -240,6 +273,14 @@ void Adafruit_L3GD20_Unified::getEvent(sensors_event_t* event)
       }
     }
   }
+
+  /* Bias removal, after the saturation check on the raw counts */
+  if (calibration)
+  {
+    event->gyro.x -= calibration->gyroBias[0];
+    event->gyro.y -= calibration->gyroBias[1];
+    event->gyro.z -= calibration->gyroBias[2];
+  }
   
   /* Compensate values depending on the resolution */
   switch(_range)
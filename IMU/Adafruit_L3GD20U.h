@@ -19,6 +19,7 @@
 #include "../Arduino.h"
 
 #include "Adafruit_Sensor.h"
+#include "IMUCalibration.h"
 #include "../TwoWire.h"
 
 /*=========================================================================
@@ -31,6 +32,7 @@
     #define GYRO_SENSITIVITY_250DPS  (0.00875F)    // Roughly 22/256 for fixed point match
     #define GYRO_SENSITIVITY_500DPS  (0.0175F)     // Roughly 45/256
     #define GYRO_SENSITIVITY_2000DPS (0.070F)      // Roughly 18/256
+    #define GYRO_AUTO_INCREMENT      (0x80)        // register MSB for burst reads
 /*=========================================================================*/
 
 /*=========================================================================
@@ -84,9 +86,12 @@ class Adafruit_L3GD20_Unified : public Adafruit_Sensor
     uint8_t L3GD20_ADDRESS; //  (0x6B)        // 1101011
 	uint8_t L3GD20_ID;      // (0b11010111)  // was bits 1:0 = 00? Datasheet says this means SDO pin connected?
     Adafruit_L3GD20_Unified();
+    IMUCalibration* calibration;  // bias removed from each read, NULL for raw
 
     bool begin           ( gyroRange_t rng = GYRO_RANGE_250DPS );
     void enableAutoRange ( bool enabled );
+    void enableFIFO      ( uint8_t watermark );
+    float getScale       ( void );
     void getEvent        ( sensors_event_t* );
     void getSensor       ( sensor_t* );
 
@@ -35,19 +35,14 @@ static float _lsm303Mag_Gauss_LSB_Z  = 980.0F;   // Varies with gain
 /**************************************************************************/
 void Adafruit_LSM303_Accel_Unified::read()
 {
-  // Read the accelerometer
-  
-    uint8_t xlo = read8((byte)LSM303_ADDRESS_ACCEL,(byte)LSM303_REGISTER_ACCEL_OUT_X_L_A) | 0x80; //s two compliment
-    uint8_t xhi = read8((byte)LSM303_ADDRESS_ACCEL,(byte)LSM303_REGISTER_ACCEL_OUT_X_H_A) | 0x80;
-    uint8_t ylo = read8((byte)LSM303_ADDRESS_ACCEL,(byte)LSM303_REGISTER_ACCEL_OUT_Y_L_A) | 0x80;
-    uint8_t yhi = read8((byte)LSM303_ADDRESS_ACCEL,(byte)LSM303_REGISTER_ACCEL_OUT_Y_H_A) | 0x80;
-    uint8_t zlo = read8((byte)LSM303_ADDRESS_ACCEL,(byte)LSM303_REGISTER_ACCEL_OUT_Z_L_A) | 0x80;
-    uint8_t zhi = read8((byte)LSM303_ADDRESS_ACCEL,(byte)LSM303_REGISTER_ACCEL_OUT_Z_H_A) | 0x80; 
-	 
+  // Read the accelerometer, X Y Z low then high in one burst from OUT_X_L_A
+  uint8_t raw[6];
+  readBurst((byte)LSM303_ADDRESS_ACCEL, (byte)(LSM303_REGISTER_ACCEL_OUT_X_L_A | LSM303_AUTO_INCREMENT), raw, 6);
+
   // Shift values to create properly formed integer (low byte first)
-  _accelData.x = (int16_t)(xlo | (xhi << 8)) >> 4;
-  _accelData.y = (int16_t)(ylo | (yhi << 8)) >> 4;
-  _accelData.z = (int16_t)(zlo | (zhi << 8)) >> 4;
+  _accelData.x = (int16_t)(raw[0] | (raw[1] << 8)) >> 4;
+  _accelData.y = (int16_t)(raw[2] | (raw[3] << 8)) >> 4;
+  _accelData.z = (int16_t)(raw[4] | (raw[5] << 8)) >> 4;
 }
 
  
@@ -84,6 +79,24 @@ bool Adafruit_LSM303_Accel_Unified::begin()
   return true;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Runs at 200Hz into the FIFO in stream mode, with the watermark
+            interrupt on INT1, for the IMU interrupt pipeline
+*/
+/**************************************************************************/
+void Adafruit_LSM303_Accel_Unified::enableFIFO(uint8_t watermark)
+{
+  // AODR = 0110 (200 Hz ODR), all axes
+  write8(LSM303_ADDRESS_ACCEL, LSM303_REGISTER_ACCEL_CTRL_REG1_A, 0x67);
+  // I1_WTM1
+  write8(LSM303_ADDRESS_ACCEL, LSM303_REGISTER_ACCEL_CTRL_REG3_A, 0x04);
+  // FIFO_EN
+  write8(LSM303_ADDRESS_ACCEL, LSM303_REGISTER_ACCEL_CTRL_REG5_A, 0x40);
+  // FM = 10 stream mode, FTH
+  write8(LSM303_ADDRESS_ACCEL, LSM303_REGISTER_ACCEL_FIFO_CTRL_REG_A, 0x80 | (watermark & 0x1F));
+}
+
 /**************************************************************************/
 /*! 
     @brief  Gets the most recent sensor event
@@ -136,18 +149,14 @@ void Adafruit_LSM303_Accel_Unified::getSensor(sensor_t *sensor) {
 /**************************************************************************/
 void Adafruit_LSM303_Mag_Unified::read()
 {
-  // Read the magnetometer  
-    uint8_t xlo = read8((byte)LSM303_ADDRESS_MAG,(byte)LSM303_REGISTER_MAG_OUT_X_L_M) | 0x80; //s two compliment
-    uint8_t xhi = read8((byte)LSM303_ADDRESS_MAG,(byte)LSM303_REGISTER_MAG_OUT_X_H_M) | 0x80;
-    uint8_t ylo = read8((byte)LSM303_ADDRESS_MAG,(byte)LSM303_REGISTER_MAG_OUT_Y_L_M) | 0x80;
-    uint8_t yhi = read8((byte)LSM303_ADDRESS_MAG,(byte)LSM303_REGISTER_MAG_OUT_Y_H_M) | 0x80;
-    uint8_t zlo = read8((byte)LSM303_ADDRESS_MAG,(byte)LSM303_REGISTER_MAG_OUT_Z_L_M) | 0x80;
-    uint8_t zhi = read8((byte)LSM303_ADDRESS_MAG,(byte)LSM303_REGISTER_MAG_OUT_Z_H_M) | 0x80; 
-	  
-  // Shift values to create properly formed integer (low byte first)
-  _magData.x = (int16_t)(xlo | ((int16_t)xhi << 8));
-  _magData.y = (int16_t)(ylo | ((int16_t)yhi << 8));
-  _magData.z = (int16_t)(zlo | ((int16_t)zhi << 8));
+  // Read the magnetometer, X Z Y high then low in one burst from OUT_X_H_M
+  uint8_t raw[6];
+  readBurst((byte)LSM303_ADDRESS_MAG, (byte)LSM303_REGISTER_MAG_OUT_X_H_M, raw, 6);
+
+  // Shift values to create properly formed integer (high byte first)
+  _magData.x = (int16_t)(raw[1] | ((int16_t)raw[0] << 8));
+  _magData.y = (int16_t)(raw[5] | ((int16_t)raw[4] << 8));
+  _magData.z = (int16_t)(raw[3] | ((int16_t)raw[2] << 8));
   
   // ToDo: Calculate orientation
   _magData.orientation = 0.0;
@@ -165,6 +174,7 @@ void Adafruit_LSM303_Mag_Unified::read()
 Adafruit_LSM303_Mag_Unified::Adafruit_LSM303_Mag_Unified(int32_t sensorID) {
   _sensorID = sensorID;
   _autoRangeEnabled = false;
+  calibration = NULL;
 }
 
 /***************************************************************************
@@ -190,6 +200,44 @@ bool Adafruit_LSM303_Mag_Unified::begin()
   return true;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Runs at 220Hz, DRDY falls on each new sample until it is read,
+            for the IMU interrupt pipeline
+*/
+/**************************************************************************/
+void Adafruit_LSM303_Mag_Unified::enableDataReady(void)
+{
+  // DO = 111 (220 Hz ODR)
+  write8(LSM303_ADDRESS_MAG, LSM303_REGISTER_MAG_CRA_REG_M, 0x1C);
+}
+
+/**************************************************************************/
+/*!
+    @brief  m/s^2 per count of the 12 bit accel, for raw samples
+*/
+/**************************************************************************/
+float Adafruit_LSM303_Accel_Unified::getScale(void)
+{
+  return _lsm303Accel_MG_LSB * SENSORS_GRAVITY_STANDARD;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Microtesla per count at the current gain, for raw samples,
+            the Z axis has its own
+*/
+/**************************************************************************/
+float Adafruit_LSM303_Mag_Unified::getScaleXY(void)
+{
+  return SENSORS_GAUSS_TO_MICROTESLA / _lsm303Mag_Gauss_LSB_XY;
+}
+
+float Adafruit_LSM303_Mag_Unified::getScaleZ(void)
+{
+  return SENSORS_GAUSS_TO_MICROTESLA / _lsm303Mag_Gauss_LSB_Z;
+}
+
 /**************************************************************************/
 /*! 
     @brief  Enables or disables auto-ranging
@@ -320,6 +368,14 @@ void Adafruit_LSM303_Mag_Unified::getEvent(sensors_event_t *event) {
       }
     }
   }
+
+  /* Hard and soft iron correction, after the saturation check on the raw counts */
+  if (calibration)
+  {
+    _magData.x = imuCalibrate((int16_t)_magData.x, calibration->magOffset[0], calibration->magScale[0]);
+    _magData.y = imuCalibrate((int16_t)_magData.y, calibration->magOffset[1], calibration->magScale[1]);
+    _magData.z = imuCalibrate((int16_t)_magData.z, calibration->magOffset[2], calibration->magScale[2]);
+  }
   
   event->version   = sizeof(sensors_event_t);
   event->sensor_id = _sensorID;
@@ -17,6 +17,7 @@
 
 #include "../Arduino.h"
 #include "Adafruit_Sensor.h"
+#include "IMUCalibration.h"
 #include "../TwoWire.h"
 
 /*=========================================================================
@@ -127,6 +128,12 @@
     #define LSM303_ID                     (0b11010100)
 /*=========================================================================*/
 
+/*=========================================================================
+    BURST READS
+    -----------------------------------------------------------------------*/
+    #define LSM303_AUTO_INCREMENT         (0x80)  // accel register MSB, the mag auto increments anyway
+/*=========================================================================*/
+
 /* Unified sensor driver for the accelerometer */
 class Adafruit_LSM303_Accel_Unified : public Adafruit_Sensor
 {
@@ -134,6 +141,8 @@ class Adafruit_LSM303_Accel_Unified : public Adafruit_Sensor
     Adafruit_LSM303_Accel_Unified(int32_t sensorID = -1);
   
     bool begin(void);
+    void enableFIFO(uint8_t watermark);
+    float getScale(void);
     void getEvent(sensors_event_t*);
     void getSensor(sensor_t*);
 
@@ -149,9 +158,13 @@ class Adafruit_LSM303_Mag_Unified : public Adafruit_Sensor
 {
   public:
     Adafruit_LSM303_Mag_Unified(int32_t sensorID = -1);
+    IMUCalibration* calibration;  // hard and soft iron applied to each read, NULL for raw
   
     bool begin(void);
     void enableAutoRange(bool enable);
+    void enableDataReady(void);
+    float getScaleXY(void);
+    float getScaleZ(void);
     void setMagGain(lsm303MagGain gain);
     void getEvent(sensors_event_t*);
     void getSensor(sensor_t*);
@@ -142,8 +142,8 @@ class Adafruit_Sensor {
 
   // These must be defined by the subclass
   virtual void enableAutoRange(bool enabled) {};
-  virtual void getEvent(sensors_event_t*);
-  virtual void getSensor(sensor_t*);
+  virtual void getEvent(sensors_event_t*) = 0;
+  virtual void getSensor(sensor_t*) = 0;
   /*************************************************************************
   * Write a byte to register at address
   *************************************************************************/
@@ -160,13 +160,8 @@ class Adafruit_Sensor {
   *************************************************************************/
   virtual byte read8(byte address, byte reg)
   {
-	byte value;
-	Wire.beginTransmission(address);
-	Wire.send(reg);
-	Wire.endTransmission();
-	Wire.requestFrom(address, (byte)1);
-	value = Wire.receive(); 
-	Wire.endTransmission();
+	byte value = 0;
+	Wire.readRegisters(address, reg, &value, 1);
 	return value;
   }
   /*************************************************************************
@@ -174,14 +169,16 @@ class Adafruit_Sensor {
   **************************************************************************/
   virtual uint16_t read16(byte address, byte reg)
   {
-	uint16_t value;
-	Wire.beginTransmission(address);
-	Wire.send(reg);
-	Wire.endTransmission();
-	Wire.requestFrom(address, (byte)2);
-	value = (Wire.receive() << 8) | Wire.receive(); 
-	Wire.endTransmission();
-	return value;
+	uint8_t value[2];
+	Wire.readRegisters(address, reg, value, 2);
+	return ((uint16_t)value[0] << 8) | value[1];
+  }
+  /*************************************************************************
+    Reads length consecutive registers from reg in one I2C transaction
+  **************************************************************************/
+  uint8_t readBurst(byte address, byte reg, uint8_t* data, uint8_t length)
+  {
+	return Wire.readRegisters(address, reg, data, length);
   }
 
  private:
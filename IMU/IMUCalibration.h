@@ -0,0 +1,34 @@
+/*
+ * IMUCalibration.h
+ * Correction coefficients for the raw IMU counts, kept in EEPROM by ConfigurationStore.
+ * The gyro bias is subtracted. The mag hard iron offset is subtracted and the difference scaled per axis for the soft iron,
+ * in fixed point with IMU_CAL_ONE as 1, so a sample costs a subtract, a 16x16 multiply and a shift per axis in the TWI interrupt.
+ * The offsets come from M21, the mag from the min and max of each axis while the robot is turned through every heading and tilt,
+ * the gyro from the mean at rest.
+ * Created: 10/18/2026 6:12:40 PM
+ *  Author: jg
+ */
+#ifndef IMUCALIBRATION_H_
+#define IMUCALIBRATION_H_
+#include <inttypes.h>
+
+#define IMU_CAL_SHIFT 12
+#define IMU_CAL_ONE (1 << IMU_CAL_SHIFT)
+
+// Calibration being collected
+#define IMU_CAL_NONE 0
+#define IMU_CAL_MAG 1
+#define IMU_CAL_GYRO 2
+
+struct IMUCalibration {
+	int16_t gyroBias[3]; // counts
+	int16_t magOffset[3]; // hard iron, counts
+	int16_t magScale[3]; // soft iron, IMU_CAL_ONE is 1
+};
+
+static inline int16_t imuCalibrate(int16_t raw, int16_t offset, int16_t scale)
+{
+	return (int16_t)((((int32_t)raw - offset) * scale) >> IMU_CAL_SHIFT);
+}
+
+#endif /* IMUCALIBRATION_H_ */
@@ -0,0 +1,159 @@
+/*
+ * IMUInterruptService.cpp
+ * Data ready to ring buffer for one IMU sensor, see IMUInterruptService.h
+ * Created: 4/22/2014 6:32:40 PM
+ * Author: jg
+ */
+#include "IMUInterruptService.h"
+#include "PitchRollHeading.h"
+#include "../TwoWire.h"
+#include "../WTime.h"
+
+/*
+* sourceReg 0 for a sensor with no FIFO, which is read one sample per interrupt. period is the FIFO sample period in microseconds.
+*/
+IMUInterruptService::IMUInterruptService(PitchRollHeading* imu, uint8_t address, uint8_t type, uint8_t dataReg, uint8_t sourceReg, uint32_t period)
+	: TWIService(address)
+{
+	this->imu = imu;
+	this->type = type;
+	this->dataReg = dataReg;
+	this->sourceReg = sourceReg;
+	this->period = period;
+	fifo = (sourceReg != 0);
+	state = IMU_IDLE;
+	rearm = 0;
+	retry = 0;
+	pending = 0;
+	errors = 0;
+	calibration = NULL;
+}
+/*
+* Queue a register read into raw, interrupt context
+*/
+void IMUInterruptService::queueRead(uint8_t reg, uint8_t length)
+{
+	transaction.address = device;
+	transaction.type = TWI_XFER_REGISTER_READ;
+	transaction.reg = reg;
+	transaction.data = raw;
+	transaction.length = length;
+	transaction.service = this;
+	if( Wire.queueTransaction(&transaction) ) {
+		++errors;
+		state = IMU_IDLE;
+		retry = 1;
+	}
+}
+/*
+* Counts from the 6 output bytes, the accel is 12 bits left justified and the mag is big endian in X Z Y order.
+* The gyro bias and the mag hard and soft iron are taken out here, in fixed point, if there is a calibration.
+*/
+void IMUInterruptService::decode(uint8_t* data, IMUSample* sample)
+{
+	sample->type = type;
+	switch(type) {
+		case SENSOR_TYPE_MAGNETIC_FIELD:
+			sample->x = (int16_t)(data[1] | ((int16_t)data[0] << 8));
+			sample->z = (int16_t)(data[3] | ((int16_t)data[2] << 8));
+			sample->y = (int16_t)(data[5] | ((int16_t)data[4] << 8));
+			if( calibration ) {
+				sample->x = imuCalibrate(sample->x, calibration->magOffset[0], calibration->magScale[0]);
+				sample->y = imuCalibrate(sample->y, calibration->magOffset[1], calibration->magScale[1]);
+				sample->z = imuCalibrate(sample->z, calibration->magOffset[2], calibration->magScale[2]);
+			}
+			break;
+		case SENSOR_TYPE_ACCELEROMETER:
+			sample->x = (int16_t)(data[0] | (data[1] << 8)) >> 4;
+			sample->y = (int16_t)(data[2] | (data[3] << 8)) >> 4;
+			sample->z = (int16_t)(data[4] | (data[5] << 8)) >> 4;
+			break;
+		default:
+			sample->x = (int16_t)(data[0] | (data[1] << 8));
+			sample->y = (int16_t)(data[2] | (data[3] << 8));
+			sample->z = (int16_t)(data[4] | (data[5] << 8));
+			if( calibration ) {
+				sample->x -= calibration->gyroBias[0];
+				sample->y -= calibration->gyroBias[1];
+				sample->z -= calibration->gyroBias[2];
+			}
+			break;
+	}
+}
+/*
+* Pin change, start a drain, or note that another is wanted if one is running
+*/
+void IMUInterruptService::service(void)
+{
+	if( state != IMU_IDLE ) {
+		rearm = 1;
+		return;
+	}
+	rearm = 0;
+	retry = 0;
+	if( fifo ) {
+		state = IMU_STATUS;
+		queueRead(sourceReg, 1);
+	} else {
+		state = IMU_DATA;
+		pending = 1;
+		sampleTime = micros();
+		queueRead(dataReg, 6);
+	}
+}
+/*
+* A read is done. After the source read the waiting samples are read, after the samples the source is read again
+* until the FIFO is empty. Then the pipeline idles, or runs again if an interrupt came in while busy.
+*/
+void IMUInterruptService::onComplete(TWITransaction* transaction)
+{
+	if( transaction->status != TWI_SUCCESS ) {
+		++errors;
+		state = IMU_IDLE;
+		retry = 1;
+		return;
+	}
+	if( state == IMU_STATUS ) {
+		uint8_t src = raw[0];
+		uint8_t count = (src & IMU_FIFO_OVRN) ? 32 : (src & IMU_FIFO_FSS);
+		if( (src & IMU_FIFO_EMPTY) || !count ) {
+			state = IMU_IDLE;
+			if( rearm )
+				service();
+			return;
+		}
+		// newest sample now, the rest a period apart before it
+		sampleTime = micros() - (uint32_t)(count - 1) * period;
+		pending = count > IMU_FIFO_BURST ? IMU_FIFO_BURST : count;
+		state = IMU_DATA;
+		queueRead(dataReg, pending * 6);
+		return;
+	}
+	IMUSample sample;
+	for(uint8_t i = 0; i < pending; i++) {
+		decode(raw + (i * 6), &sample);
+		sample.timestamp = sampleTime;
+		sampleTime += period;
+		imu->pushSample(&sample);
+	}
+	if( fifo ) {
+		state = IMU_STATUS;
+		queueRead(sourceReg, 1);
+		return;
+	}
+	state = IMU_IDLE;
+	if( rearm )
+		service();
+}
+/*
+* Main loop, after a failed read the line stays asserted, the FIFO over its watermark or the mag data ready low, and no
+* edge comes to run the pipeline again. The drain is started over here, from the source read, or the data read for the mag.
+*/
+void IMUInterruptService::retryRead(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	if( retry && state == IMU_IDLE )
+		service();
+	SREG = oldSREG;
+}
@@ -1,9 +1,17 @@
 /*
  * IMUInterruptService.h
- * General interrupt service servicing IMU interrupt events from gyro, magnetometer, accelerometer
+ * Interrupt pipeline for one IMU sensor. The data ready or FIFO watermark pin change interrupt queues an I2C read
+ * with TwoWire::queueTransaction and returns, the rest runs from the TWI interrupt in onComplete.
+ * For the gyro and accel the FIFO source register is read for the samples waiting, which are then read in bursts
+ * of up to IMU_FIFO_BURST samples and the source read again until the FIFO is empty, so the watermark output drops
+ * and the next watermark gives a fresh edge. The mag has no FIFO and each sample is read on its data ready.
+ * Samples go into the timestamped ring buffer of PitchRollHeading for the fusion stage. FIFO samples are stamped back
+ * from the time the source register is read at the output data rate period, the mag at its interrupt.
+ * A failed read, or one the full TWI queue refused, leaves the interrupt line asserted with no new edge to come, so it is
+ * retried from the main loop by updateFusion through retryRead, which starts the drain over from the source or data read.
  * Created: 4/22/2014 6:32:40 PM
  * Author: jg
- */ 
+ */
 
 #ifndef IMUINTERRUPTSERVICE_H_
 #define IMUINTERRUPTSERVICE_H_
@@ -13,27 +21,61 @@
 #include "../WInterruptService.h"
 #include "../Arduino.h"
 #include "../pins_arduino.h"
-#include "PitchRollHeading.h"
+#include "../Configuration_adv.h"
+#include "../TWIService.h"
 #include "Adafruit_Sensor.h"
+#include "IMUCalibration.h"
 
-class IMUInterruptService: public InterruptService {
-	private:
+// IMUInterruptService state
+#define IMU_IDLE 0
+#define IMU_STATUS 1 // FIFO source read on the bus
+#define IMU_DATA 2 // samples read on the bus
 
-	public:
-	PitchRollHeading* imu;
-	sensors_vec_t orientation;
-	IMUInterruptService(PitchRollHeading* imu) { this->imu = imu; }
-	//Pin Change Interrupt Service Routine.
-	void IMUInterruptService::service(void)
-	{
-		if( imu->interruptsActive) {
-			orientation = imu->getPitchRollHeading();
-		}
-	}
-	
-	sensors_vec_t getOrientation() { return orientation; }
+// FIFO source register bits, same on the L3GD20 and LSM303 accel
+#define IMU_FIFO_OVRN 0x40
+#define IMU_FIFO_EMPTY 0x20
+#define IMU_FIFO_FSS 0x1F
 
+/*
+* One raw sample in sensor counts, type is SENSOR_TYPE_ACCELEROMETER, SENSOR_TYPE_GYROSCOPE or SENSOR_TYPE_MAGNETIC_FIELD
+*/
+struct IMUSample {
+	uint32_t timestamp; // micros
+	uint8_t type;
+	int16_t x;
+	int16_t y;
+	int16_t z;
 };
 
+class PitchRollHeading;
+
+class IMUInterruptService: public InterruptService, public TWIService {
+	private:
+	PitchRollHeading* imu;
+	uint8_t type;
+	uint8_t fifo; // sensor has a FIFO to drain
+	uint8_t sourceReg; // FIFO source register
+	uint8_t dataReg; // first output register, with the auto increment bit where needed
+	uint32_t period; // microseconds between FIFO samples
+	volatile uint8_t state;
+	volatile uint8_t rearm; // interrupt came in while busy
+	volatile uint8_t retry; // a read failed, start over from the main loop
+	uint8_t pending; // samples in the read on the bus
+	uint32_t sampleTime; // timestamp of the next sample
+	uint8_t raw[6 * IMU_FIFO_BURST];
+	TWITransaction transaction;
+	void queueRead(uint8_t reg, uint8_t length);
+	void decode(uint8_t* data, IMUSample* sample);
+	public:
+	uint16_t errors; // I2C failures, the read is dropped and retried by retryRead
+	IMUCalibration* calibration; // applied to gyro and mag samples as they are decoded, NULL for raw
+	IMUInterruptService(PitchRollHeading* imu, uint8_t address, uint8_t type, uint8_t dataReg, uint8_t sourceReg = 0, uint32_t period = 0);
+	// data ready or watermark pin change
+	void service(void);
+	// TWI interrupt, a read is done
+	void onComplete(TWITransaction* transaction);
+	// main loop, start the pipeline again after a failed read
+	void retryRead(void);
+};
 
-#endif /* IMUINTERRUPTSERVICE_H_ */
\ No newline at end of file
+#endif /* IMUINTERRUPTSERVICE_H_ */
@@ -0,0 +1,141 @@
+/*
+ * MahonyFilter.cpp
+ * Quaternion attitude from gyro, accel and mag, see MahonyFilter.h
+ * Created: 10/18/2026 4:05:12 PM
+ *  Author: jg
+ */
+#include <math.h>
+#include "MahonyFilter.h"
+
+MahonyFilter::MahonyFilter(float kp, float ki)
+{
+	twoKp = 2.0f * kp;
+	twoKi = 2.0f * ki;
+	reset();
+}
+/*
+* Level, facing north, no bias
+*/
+void MahonyFilter::reset(void)
+{
+	q0 = 1.0f;
+	q1 = q2 = q3 = 0.0f;
+	integralFBx = integralFBy = integralFBz = 0.0f;
+}
+/*
+* Rotate the quaternion by the corrected rates over dt, q' = 0.5 * q * w, and renormalize
+*/
+void MahonyFilter::integrate(float gx, float gy, float gz, float dt)
+{
+	gx *= 0.5f * dt;
+	gy *= 0.5f * dt;
+	gz *= 0.5f * dt;
+	float qa = q0, qb = q1, qc = q2;
+	q0 += (-qb * gx - qc * gy - q3 * gz);
+	q1 += (qa * gx + qc * gz - q3 * gy);
+	q2 += (qa * gy - qb * gz + q3 * gx);
+	q3 += (qa * gz + qb * gy - qc * gx);
+	float recipNorm = 1.0f / sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+	q0 *= recipNorm;
+	q1 *= recipNorm;
+	q2 *= recipNorm;
+	q3 *= recipNorm;
+}
+/*
+* One step with gyro, accel and mag. The field is rotated to earth, its horizontal part taken as north,
+* and the error is the cross product of measured and predicted gravity plus that of measured and predicted north.
+*/
+void MahonyFilter::update(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, float dt)
+{
+	if( mx == 0.0f && my == 0.0f && mz == 0.0f ) {
+		updateIMU(gx, gy, gz, ax, ay, az, dt);
+		return;
+	}
+	if( !(ax == 0.0f && ay == 0.0f && az == 0.0f) ) {
+		float recipNorm = 1.0f / sqrt(ax * ax + ay * ay + az * az);
+		ax *= recipNorm;
+		ay *= recipNorm;
+		az *= recipNorm;
+		recipNorm = 1.0f / sqrt(mx * mx + my * my + mz * mz);
+		mx *= recipNorm;
+		my *= recipNorm;
+		mz *= recipNorm;
+		float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+		float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+		float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+		// earth frame field, north in x and down in z
+		float hx = 2.0f * (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+		float hy = 2.0f * (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+		float bx = sqrt(hx * hx + hy * hy);
+		float bz = 2.0f * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2));
+		// predicted gravity and field in the body frame
+		float vx = q1q3 - q0q2;
+		float vy = q0q1 + q2q3;
+		float vz = q0q0 - 0.5f + q3q3;
+		float wx = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+		float wy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+		float wz = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2);
+		float ex = (ay * vz - az * vy) + (my * wz - mz * wy);
+		float ey = (az * vx - ax * vz) + (mz * wx - mx * wz);
+		float ez = (ax * vy - ay * vx) + (mx * wy - my * wx);
+		if( twoKi > 0.0f ) {
+			integralFBx += twoKi * ex * dt;
+			integralFBy += twoKi * ey * dt;
+			integralFBz += twoKi * ez * dt;
+			gx += integralFBx;
+			gy += integralFBy;
+			gz += integralFBz;
+		}
+		gx += twoKp * ex;
+		gy += twoKp * ey;
+		gz += twoKp * ez;
+	}
+	integrate(gx, gy, gz, dt);
+}
+/*
+* One step with gyro and accel, roll and pitch are held by gravity, heading is gyro only
+*/
+void MahonyFilter::updateIMU(float gx, float gy, float gz, float ax, float ay, float az, float dt)
+{
+	if( !(ax == 0.0f && ay == 0.0f && az == 0.0f) ) {
+		float recipNorm = 1.0f / sqrt(ax * ax + ay * ay + az * az);
+		ax *= recipNorm;
+		ay *= recipNorm;
+		az *= recipNorm;
+		float vx = q1 * q3 - q0 * q2;
+		float vy = q0 * q1 + q2 * q3;
+		float vz = q0 * q0 - 0.5f + q3 * q3;
+		float ex = (ay * vz - az * vy);
+		float ey = (az * vx - ax * vz);
+		float ez = (ax * vy - ay * vx);
+		if( twoKi > 0.0f ) {
+			integralFBx += twoKi * ex * dt;
+			integralFBy += twoKi * ey * dt;
+			integralFBz += twoKi * ez * dt;
+			gx += integralFBx;
+			gy += integralFBy;
+			gz += integralFBz;
+		}
+		gx += twoKp * ex;
+		gy += twoKp * ey;
+		gz += twoKp * ez;
+	}
+	integrate(gx, gy, gz, dt);
+}
+/*
+* Euler angles from the quaternion, aerospace sequence, in degrees
+*/
+void MahonyFilter::getEuler(sensors_vec_t* orientation)
+{
+	float sinp = 2.0f * (q0 * q2 - q3 * q1);
+	if( sinp > 1.0f )
+		sinp = 1.0f;
+	if( sinp < -1.0f )
+		sinp = -1.0f;
+	orientation->roll = atan2(2.0f * (q0 * q1 + q2 * q3), 1.0f - 2.0f * (q1 * q1 + q2 * q2)) * 180.0f / M_PI;
+	orientation->pitch = asin(sinp) * 180.0f / M_PI;
+	float heading = atan2(2.0f * (q0 * q3 + q1 * q2), 1.0f - 2.0f * (q2 * q2 + q3 * q3)) * 180.0f / M_PI;
+	if( heading < 0.0f )
+		heading += 360.0f;
+	orientation->heading = heading;
+}
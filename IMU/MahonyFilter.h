@@ -0,0 +1,31 @@
+/*
+ * MahonyFilter.h
+ * Mahony's nonlinear complementary filter on SO(3), attitude as a unit quaternion. Each step integrates the gyro rates
+ * corrected by the cross product of the measured gravity and north directions with those the quaternion predicts,
+ * proportional and integral, so the accel and mag pull the gyro integration back and the integral term learns the gyro bias.
+ * Accel and mag only need the right direction, they are normalized. With no mag the heading free runs on the gyro.
+ * Created: 10/18/2026 4:05:12 PM
+ *  Author: jg
+ */
+#ifndef MAHONYFILTER_H_
+#define MAHONYFILTER_H_
+#include "Adafruit_Sensor.h"
+
+class MahonyFilter {
+	private:
+	float twoKp; // 2 * proportional gain
+	float twoKi; // 2 * integral gain
+	float integralFBx, integralFBy, integralFBz; // integral error, the gyro bias estimate
+	void integrate(float gx, float gy, float gz, float dt);
+	public:
+	float q0, q1, q2, q3; // attitude, body to earth
+	MahonyFilter(float kp, float ki);
+	void reset(void);
+	// gyro in rad/s, accel and mag in any units, dt in seconds
+	void update(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, float dt);
+	void updateIMU(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+	// roll, pitch in degrees, heading 0-360 degrees
+	void getEuler(sensors_vec_t* orientation);
+};
+
+#endif /* MAHONYFILTER_H_ */
@@ -14,37 +14,338 @@ PitchRollHeading::PitchRollHeading() {
 		mag   = new Adafruit_LSM303_Mag_Unified(LSM303_ADDRESS_MAG);
 		bmp   = new Adafruit_BMP085_Unified(BMP085_ADDRESS);
 		gyro  = new Adafruit_L3GD20_Unified();
-		//interruptsActive = false;
-		// set up pin change interrupts
-		//gyroInt = new PCInterrupts();
-		//accelInt = new PCInterrupts();
-		//magInt = new PCInterrupts();
-		//imuService = new IMUInterruptService(this);
-		//gyroIntPin = new Digital(67); // pin 67 for now, put in configs later
-		//accelIntPin = new Digital(68);
-		//magIntPin = new Digital(52);
-		//gyroIntPin->pinMode(INPUT);
-		//accelIntPin->pinMode(INPUT);
-		//magIntPin->pinMode(INPUT);
-		//gyroInt->attachInterrupt(gyroIntPin->pin,imuService,CHANGE);
-		//accelInt->attachInterrupt(accelIntPin->pin,imuService,CHANGE);
-		//magInt->attachInterrupt(magIntPin->pin,imuService,CHANGE);
+		interruptsActive = false;
+		baroActive = false;
+		baroReady = 0;
+		seaLevelPressure = SENSORS_PRESSURE_SEALEVELHPA;
+		sampleHead = sampleTail = 0;
+		sampleOverruns = 0;
+		gyroService = accelService = magService = NULL;
+		fusion = new MahonyFilter(IMU_FUSION_KP, IMU_FUSION_KI);
+		fusionReady = 0;
+		fusionTime = 0;
+		calibration = NULL;
+		calMode = IMU_CAL_NONE;
+		lastAccel.type = lastMag.type = lastGyro.type = 0;
 		initSensors();
+		gyroScale = gyro->getScale();
+		accelScale = accel->getScale();
+		magScaleXY = mag->getScaleXY();
+		magScaleZ = mag->getScaleZ();
+}
+/*
+* Switch the gyro and accel to FIFO watermark interrupts and the mag to data ready, and attach the pin change
+* interrupts to the pipeline of each. Each is run once to drain anything already waiting, as a FIFO
+* already over its watermark gives no edge.
+*/
+void PitchRollHeading::startInterrupts(void)
+{
+		if( interruptsActive )
+			return;
+		gyro->enableFIFO(IMU_FIFO_WATERMARK);
+		accel->enableFIFO(IMU_FIFO_WATERMARK);
+		mag->enableDataReady();
+		gyroService = new IMUInterruptService(this, gyro->L3GD20_ADDRESS, SENSOR_TYPE_GYROSCOPE,
+			GYRO_REGISTER_OUT_X_L | GYRO_AUTO_INCREMENT, GYRO_REGISTER_FIFO_SRC_REG, IMU_GYRO_PERIOD);
+		accelService = new IMUInterruptService(this, LSM303_ADDRESS_ACCEL, SENSOR_TYPE_ACCELEROMETER,
+			LSM303_REGISTER_ACCEL_OUT_X_L_A | LSM303_AUTO_INCREMENT, LSM303_REGISTER_ACCEL_FIFO_SRC_REG_A, IMU_ACCEL_PERIOD);
+		magService = new IMUInterruptService(this, LSM303_ADDRESS_MAG, SENSOR_TYPE_MAGNETIC_FIELD, LSM303_REGISTER_MAG_OUT_X_H_M);
+		applyCalibration(calMode);
+		gyroIntPin = new Digital(IMU_GYRO_INT_PIN);
+		accelIntPin = new Digital(IMU_ACCEL_INT_PIN);
+		magIntPin = new Digital(IMU_MAG_INT_PIN);
+		gyroIntPin->pinMode(INPUT);
+		accelIntPin->pinMode(INPUT);
+		magIntPin->pinMode(INPUT);
+		gyroInt = new PCInterrupts();
+		accelInt = new PCInterrupts();
+		magInt = new PCInterrupts();
+		gyroInt->attachInterrupt(gyroIntPin->pin, gyroService, RISING);
+		accelInt->attachInterrupt(accelIntPin->pin, accelService, RISING);
+		magInt->attachInterrupt(magIntPin->pin, magService, FALLING);
+		interruptsActive = true;
+		uint8_t oldSREG = SREG;
+		cli();
+		gyroService->service();
+		accelService->service();
+		magService->service();
+		SREG = oldSREG;
+}
+/*
+* Add a sample, from the TWI interrupt. When full the oldest is dropped, the fusion stage wants the newest.
+*/
+void PitchRollHeading::pushSample(IMUSample* sample)
+{
+		uint8_t next = (sampleHead + 1) & (IMU_SAMPLE_BUFFER - 1);
+		if( next == sampleTail ) {
+			sampleTail = (sampleTail + 1) & (IMU_SAMPLE_BUFFER - 1);
+			++sampleOverruns;
+		}
+		samples[sampleHead] = *sample;
+		sampleHead = next;
+}
+/*
+* Take the oldest sample, returns 0 if there are none
+*/
+uint8_t PitchRollHeading::getSample(IMUSample* sample)
+{
+		uint8_t oldSREG = SREG;
+		cli();
+		if( sampleHead == sampleTail ) {
+			SREG = oldSREG;
+			return 0;
+		}
+		*sample = samples[sampleTail];
+		sampleTail = (sampleTail + 1) & (IMU_SAMPLE_BUFFER - 1);
+		SREG = oldSREG;
+		return 1;
+}
+/*
+* Drain the ring buffer, main loop. Accel and mag samples are kept as the latest, each gyro sample steps the filter
+* over the time since the previous gyro sample, so the filter runs at the gyro rate. Gyro samples before the first accel
+* sample are dropped. Accel units don't matter to the filter, only direction, but the mag Z axis is scaled
+* apart from X and Y. A gap of more than a few periods, from a dropped read, is taken as one period.
+* A pipeline whose read failed is started again first, its interrupt line gives no new edge.
+* Returns the number of gyro samples fused.
+*/
+uint8_t PitchRollHeading::updateFusion(void)
+{
+		IMUSample sample;
+		uint8_t fused = 0;
+		if( interruptsActive ) {
+			gyroService->retryRead();
+			accelService->retryRead();
+			magService->retryRead();
+		}
+		while( getSample(&sample) ) {
+			if( calMode )
+				collectCalibration(&sample);
+			switch(sample.type) {
+				case SENSOR_TYPE_ACCELEROMETER:
+					lastAccel = sample;
+					break;
+				case SENSOR_TYPE_MAGNETIC_FIELD:
+					lastMag = sample;
+					break;
+				case SENSOR_TYPE_GYROSCOPE: {
+					lastGyro = sample;
+					if( !lastAccel.type )
+						break;
+					uint32_t elapsed = sample.timestamp - fusionTime;
+					if( !fusionReady || elapsed > 4 * IMU_GYRO_PERIOD )
+						elapsed = IMU_GYRO_PERIOD;
+					fusionTime = sample.timestamp;
+					float dt = (float)elapsed * 1e-6f;
+					float gx = sample.x * gyroScale;
+					float gy = sample.y * gyroScale;
+					float gz = sample.z * gyroScale;
+					if( lastMag.type )
+						fusion->update(gx, gy, gz, lastAccel.x, lastAccel.y, lastAccel.z,
+							lastMag.x * magScaleXY, lastMag.y * magScaleXY, lastMag.z * magScaleZ, dt);
+					else
+						fusion->updateIMU(gx, gy, gz, lastAccel.x, lastAccel.y, lastAccel.z, dt);
+					fusionReady = 1;
+					++fused;
+					break;
+				}
+				default:
+					break;
+			}
+		}
+		return fused;
+}
+/*
+* Roll, pitch and heading in degrees from the filter quaternion
+*/
+void PitchRollHeading::getOrientation(sensors_vec_t* orientation)
+{
+		fusion->getEuler(orientation);
+}
+/*
+* Latest sample drained by updateFusion, scaled, returns 0 if the sensor has not delivered one
+*/
+uint8_t PitchRollHeading::getVector(uint8_t type, sensors_vec_t* vec)
+{
+		switch(type) {
+			case SENSOR_TYPE_ACCELEROMETER:
+				if( !lastAccel.type )
+					return 0;
+				vec->x = lastAccel.x * accelScale;
+				vec->y = lastAccel.y * accelScale;
+				vec->z = lastAccel.z * accelScale;
+				return 1;
+			case SENSOR_TYPE_GYROSCOPE:
+				if( !lastGyro.type )
+					return 0;
+				vec->x = lastGyro.x * gyroScale;
+				vec->y = lastGyro.y * gyroScale;
+				vec->z = lastGyro.z * gyroScale;
+				return 1;
+			case SENSOR_TYPE_MAGNETIC_FIELD:
+				if( !lastMag.type )
+					return 0;
+				vec->x = lastMag.x * magScaleXY;
+				vec->y = lastMag.y * magScaleXY;
+				vec->z = lastMag.z * magScaleZ;
+				return 1;
+			default:
+				return 0;
+		}
+}
+/*
+* Check the BMP085 is there and read its calibration, once
+*/
+boolean PitchRollHeading::startBarometer(void)
+{
+		if( !baroActive )
+			baroActive = bmp->begin();
+		return baroActive;
+}
+/*
+* Main loop, advance the BMP085 conversions, a new cycle every IMU_BARO_PERIOD ms. When a cycle is done the
+* altitude is worked out against seaLevelPressure and 1 returned.
+*/
+uint8_t PitchRollHeading::updateBarometer(uint32_t now)
+{
+		if( !baroActive )
+			return 0;
+		if( bmp->isIdle() ) {
+			if( baroReady && (now - baroTime) < IMU_BARO_PERIOD )
+				return 0;
+			baroTime = now;
+		}
+		if( !bmp->update(now) )
+			return 0;
+		baroTemperature = bmp->getTemperature10() / 10.0F;
+		baroPressure = bmp->getPressurePa() / 100.0F;
+		baroAltitude = bmp->pressureToAltitude(seaLevelPressure, baroPressure, baroTemperature);
+		baroReady = 1;
+		return 1;
+}
+/*
+* Last reading from updateBarometer, returns 0 if there is none yet
+*/
+uint8_t PitchRollHeading::getBarometer(float* altitude, float* temperature, float* pressure)
+{
+		if( !baroReady )
+			return 0;
+		*altitude = baroAltitude;
+		*temperature = baroTemperature;
+		*pressure = baroPressure;
+		return 1;
+}
+/*
+* Coefficients for the driver reads and the interrupt pipeline, NULL for raw counts
+*/
+void PitchRollHeading::setCalibration(IMUCalibration* cal)
+{
+		calibration = cal;
+		applyCalibration(calMode);
+}
+/*
+* Point the drivers and services at the coefficients, except the sensor given, which reads raw
+*/
+void PitchRollHeading::applyCalibration(uint8_t raw)
+{
+		uint8_t oldSREG = SREG;
+		cli();
+		gyro->calibration = (raw == IMU_CAL_GYRO) ? NULL : calibration;
+		mag->calibration = (raw == IMU_CAL_MAG) ? NULL : calibration;
+		if( gyroService )
+			gyroService->calibration = gyro->calibration;
+		if( magService )
+			magService->calibration = mag->calibration;
+		// corrected samples still waiting would spoil the collection
+		if( raw )
+			sampleTail = sampleHead;
+		SREG = oldSREG;
+}
+/*
+* Start collecting raw samples of the mag, while the robot is turned through every heading and tilt,
+* or of the gyro, at rest. Fusion carries on with the raw samples meanwhile.
+*/
+void PitchRollHeading::startCalibration(uint8_t mode)
+{
+		calMode = mode;
+		calCount = 0;
+		for(uint8_t i = 0; i < 3; i++) {
+			calMin[i] = 32767;
+			calMax[i] = -32768;
+			calSum[i] = 0;
+		}
+		applyCalibration(mode);
+}
+/*
+* From updateFusion, range of the mag on each axis or sum of the gyro
+*/
+void PitchRollHeading::collectCalibration(IMUSample* sample)
+{
+		int16_t v[3] = { sample->x, sample->y, sample->z };
+		if( calMode == IMU_CAL_MAG && sample->type == SENSOR_TYPE_MAGNETIC_FIELD ) {
+			for(uint8_t i = 0; i < 3; i++) {
+				if( v[i] < calMin[i] )
+					calMin[i] = v[i];
+				if( v[i] > calMax[i] )
+					calMax[i] = v[i];
+			}
+			++calCount;
+		} else if( calMode == IMU_CAL_GYRO && sample->type == SENSOR_TYPE_GYROSCOPE && calCount < 0xFFFF ) {
+			for(uint8_t i = 0; i < 3; i++)
+				calSum[i] += v[i];
+			++calCount;
+		}
+}
+/*
+* The mag offset is the middle of the range on each axis. The soft iron scale brings the half range of each axis,
+* in microtesla as the Z axis has its own gain, to the mean of the three. The gyro bias is the mean.
+* The coefficients go into those set by setCalibration and are applied from here on.
+*/
+uint8_t PitchRollHeading::finishCalibration(void)
+{
+		uint8_t mode = calMode;
+		uint8_t ok = 0;
+		calMode = IMU_CAL_NONE;
+		if( calibration && mode == IMU_CAL_MAG ) {
+			float radius[3];
+			float mean = 0;
+			ok = 1;
+			for(uint8_t i = 0; i < 3; i++) {
+				int32_t half = ((int32_t)calMax[i] - calMin[i]) / 2;
+				if( half < IMU_CAL_MAG_RADIUS )
+					ok = 0;
+				radius[i] = half * (i == 2 ? magScaleZ : magScaleXY);
+				mean += radius[i] / 3;
+			}
+			// a scale past the fixed point range is a bad collection
+			for(uint8_t i = 0; i < 3; i++)
+				if( mean > 7.0f * radius[i] )
+					ok = 0;
+			if( ok ) {
+				for(uint8_t i = 0; i < 3; i++) {
+					calibration->magOffset[i] = (int16_t)(((int32_t)calMax[i] + calMin[i]) / 2);
+					calibration->magScale[i] = (int16_t)(IMU_CAL_ONE * mean / radius[i] + 0.5f);
+				}
+			}
+		} else if( calibration && mode == IMU_CAL_GYRO && calCount >= IMU_CAL_GYRO_SAMPLES ) {
+			for(uint8_t i = 0; i < 3; i++)
+				calibration->gyroBias[i] = (int16_t)(calSum[i] / (int32_t)calCount);
+			ok = 1;
+		}
+		applyCalibration(IMU_CAL_NONE);
+		return ok;
 }
 
 void PitchRollHeading::initSensors()
 {
-		//volatile int a  = accel->begin();
-		volatile int b = mag->begin();
-		//volatile int c = gyro->begin();
+		accel->begin();
+		mag->begin();
+		gyro->begin();
 		//gyro->enableAutoRange(true);
 		//volatile int d = bmp->begin();
-		//interruptsActive = true; // from now on IMUInterruptService can call getPichRollHeading		
 }
 
 sensors_vec_t PitchRollHeading::getPitchRollHeading(void)
 {
-	interruptsActive = false;
 	sensors_event_t accel_event;
 	sensors_event_t mag_event;
 	sensors_event_t bmp_event;
@@ -14,10 +14,46 @@
 #include "../WInterruptService.h"
 #include "../WDigital.h"
 #include "Adafruit_10DOF.h"
+#include "IMUInterruptService.h"
+#include "MahonyFilter.h"
+
+// Quantities streamed by M20, bits of its Q
+#define IMU_ORIENTATION 1 // quaternion, roll, pitch, heading
+#define IMU_ACCEL 2 // m/s^2
+#define IMU_GYRO 4 // rad/s
+#define IMU_MAG 8 // microtesla
+#define IMU_BARO 16 // altitude, temperature, pressure from the BMP085
 
 class PitchRollHeading {
+	private:
+	IMUSample samples[IMU_SAMPLE_BUFFER]; // ring buffer filled by the interrupt pipeline
+	volatile uint8_t sampleHead;
+	volatile uint8_t sampleTail;
+	float gyroScale; // rad/s per count
+	float accelScale; // m/s^2 per count
+	float magScaleXY, magScaleZ; // microtesla per count
+	IMUSample lastAccel; // latest accel and mag, applied with each gyro sample
+	IMUSample lastMag;
+	IMUSample lastGyro;
+	uint32_t fusionTime; // timestamp of the last gyro sample fused
+	uint32_t baroTime; // millis the last barometer cycle started
+	uint8_t baroReady; // a barometer cycle has finished
+	float baroAltitude, baroTemperature, baroPressure;
+	IMUCalibration* calibration; // coefficients applied to the samples
+	uint8_t calMode; // calibration being collected
+	int16_t calMin[3]; // mag range
+	int16_t calMax[3];
+	int32_t calSum[3]; // gyro sum
+	uint16_t calCount;
+	void applyCalibration(uint8_t raw);
+	void collectCalibration(IMUSample* sample);
 	public:
-	InterruptService*		imuService;
+	MahonyFilter* fusion;
+	uint8_t fusionReady; // a gyro sample has been fused with an accel sample
+	IMUInterruptService* gyroService;
+	IMUInterruptService* accelService;
+	IMUInterruptService* magService;
+	volatile uint16_t sampleOverruns; // samples dropped from a full buffer
 	InterruptsBase *gyroInt;
 	InterruptsBase *accelInt;
 	InterruptsBase *magInt;
@@ -25,8 +61,9 @@ class PitchRollHeading {
 	Digital* accelIntPin;
 	Digital* magIntPin;
 	/* Update this with the correct SLP for accurate altitude measurements */
-	float seaLevelPressure = 0;//SENSORS_PRESSURE_SEALEVELHPA;
+	float seaLevelPressure; // hPa
 	boolean interruptsActive;
+	boolean baroActive; // BMP085 found and calibrated
 	Adafruit_10DOF* dof;
 	Adafruit_LSM303_Accel_Unified* accel;
 	Adafruit_LSM303_Mag_Unified* mag;
@@ -43,6 +80,44 @@ void initSensors();
     Get the roll/pitch/heading/altitude/temperature
 **************************************************************************/
 sensors_vec_t getPitchRollHeading(void);
+
+/*************************************************************************
+    Run the sensors into the ring buffer from their data ready interrupts
+**************************************************************************/
+void startInterrupts(void);
+void pushSample(IMUSample* sample);
+uint8_t getSample(IMUSample* sample);
+inline uint8_t samplesWaiting(void) { return (sampleHead - sampleTail) & (IMU_SAMPLE_BUFFER - 1); }
+
+/*************************************************************************
+    Run the waiting samples through the filter, and the fused result
+**************************************************************************/
+uint8_t updateFusion(void);
+void getOrientation(sensors_vec_t* orientation);
+inline uint32_t getFusionTime(void) { return fusionTime; }
+
+/*************************************************************************
+    Latest sample of a sensor type in SI units, 0 if none yet
+**************************************************************************/
+uint8_t getVector(uint8_t type, sensors_vec_t* vec);
+
+/*************************************************************************
+    BMP085 altitude in m, temperature in C, pressure in hPa, converted
+    from the main loop without waiting
+**************************************************************************/
+boolean startBarometer(void);
+uint8_t updateBarometer(uint32_t now);
+uint8_t getBarometer(float* altitude, float* temperature, float* pressure);
+
+/*************************************************************************
+    Gyro bias and mag hard/soft iron. setCalibration gives the coefficients to
+    apply, startCalibration collects raw samples of one sensor, finishCalibration
+    computes its coefficients into those given, 0 if too few samples or too little range
+**************************************************************************/
+void setCalibration(IMUCalibration* cal);
+void startCalibration(uint8_t mode);
+uint8_t finishCalibration(void);
+inline uint8_t getCalibrationMode(void) { return calMode; }
 };
 
 #endif /* PITCHROLLHEADING_H_ */
\ No newline at end of file
@@ -0,0 +1,57 @@
+/*
+ * IsrProfile.cpp
+ * Interrupt time instrumentation, see IsrProfile.h
+ * Created: 10/18/2026 8:41:15 PM
+ *  Author: jg
+ */
+#include "IsrProfile.h"
+
+#ifdef ISR_PROFILE
+#include <avr/interrupt.h>
+#include "WHardwareTimer.h"
+
+volatile IsrProfile isrProfile[ISR_PROFILE_VECTORS];
+/*
+* Claim the profile timer for the whole of its time and run it free in normal mode with no prescale.
+* Returns the claim status, TIMER_CLAIM_CONFLICT if the timer is already in use, in which case nothing is changed
+* and the profile stays at zero.
+*/
+uint8_t isrProfileInit(void)
+{
+	uint8_t status = ISR_PROFILE_TIMER.claim(STATE_OVFL, TIMER_OWNER_PROFILE, 0, CLOCK_NO_PRESCALE);
+	if( status == TIMER_CLAIM_CONFLICT )
+		return status;
+	ISR_PROFILE_TIMER.setClockSource(CLOCK_STOP);
+	ISR_PROFILE_TIMER.setMode(0);
+	ISR_PROFILE_TIMER.setCounter(0);
+	ISR_PROFILE_TIMER.setClockSource(CLOCK_NO_PRESCALE);
+	isrProfileReset();
+	return status;
+}
+/*
+* Copy one vector out from under the interrupts
+*/
+void isrProfileGet(uint8_t vector, IsrProfile* profile)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	profile->count = isrProfile[vector].count;
+	profile->cycles = isrProfile[vector].cycles;
+	profile->maxCycles = isrProfile[vector].maxCycles;
+	profile->maxLate = isrProfile[vector].maxLate;
+	SREG = oldSREG;
+}
+
+void isrProfileReset(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	for(uint8_t i = 0; i < ISR_PROFILE_VECTORS; i++) {
+		isrProfile[i].count = 0;
+		isrProfile[i].cycles = 0;
+		isrProfile[i].maxCycles = 0;
+		isrProfile[i].maxLate = ISR_PROFILE_NO_LATE;
+	}
+	SREG = oldSREG;
+}
+#endif
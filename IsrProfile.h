@@ -0,0 +1,78 @@
+/*
+ * IsrProfile.h
+ * Optional interrupt time instrumentation, compiled in with ISR_PROFILE in Configuration_adv.h.
+ * Instrumented vectors open an ISR_PROFILE_SCOPE with their vector number, which reads a 16 bit timer running
+ * free at the CPU clock on entry and on every way out, and adds the count, the cycles and the longest run to that vector.
+ * The register saves of the ISR prologue and epilogue fall outside the scope, so add about 40 cycles for a vector that calls out.
+ * The longest run of any vector bounds how late every other interrupt can be serviced. Runs of more than 65535 cycles,
+ * 4ms, wrap. The timer compare vectors open an ISR_PROFILE_LATE_SCOPE instead, which also samples how late the vector
+ * was entered, the count of its own timer at entry less the compare value, and keeps the largest. The latency is in ticks of that
+ * timer, multiply by its prescale for cycles. In CTC the counter has cleared at the compare, so a count below it is taken as
+ * ticks since the clear. Reported and reset by M707.
+ * Created: 10/18/2026 8:41:15 PM
+ *  Author: jg
+ */
+#ifndef ISRPROFILE_H_
+#define ISRPROFILE_H_
+#include <inttypes.h>
+#include <avr/io.h>
+#include "Configuration_adv.h"
+
+#ifdef ISR_PROFILE
+// vector numbers run 1 to 56 on the 2560
+#define ISR_PROFILE_VECTORS 57
+
+// maxLate of a vector with no latency sample
+#define ISR_PROFILE_NO_LATE 0xFFFF
+
+struct IsrProfile {
+	uint32_t count;
+	uint32_t cycles;
+	uint16_t maxCycles;
+	uint16_t maxLate; // timer ticks, ISR_PROFILE_NO_LATE if not sampled
+};
+
+extern volatile IsrProfile isrProfile[ISR_PROFILE_VECTORS];
+
+static inline void isrProfileRecord(uint8_t vector, uint16_t cycles)
+{
+	volatile IsrProfile* p = &isrProfile[vector];
+	++p->count;
+	p->cycles += cycles;
+	if( cycles > p->maxCycles )
+		p->maxCycles = cycles;
+}
+
+static inline void isrProfileLate(uint8_t vector, uint16_t late)
+{
+	volatile IsrProfile* p = &isrProfile[vector];
+	if( p->maxLate == ISR_PROFILE_NO_LATE || late > p->maxLate )
+		p->maxLate = late;
+}
+
+class IsrProfileScope {
+	private:
+	uint8_t vector;
+	uint16_t start;
+	public:
+	inline IsrProfileScope(uint8_t vector) { this->vector = vector; start = ISR_PROFILE_TCNT; }
+	// count is read as the argument is evaluated, ahead of the profile timer
+	inline IsrProfileScope(uint8_t vector, uint16_t count, uint16_t match) {
+		this->vector = vector;
+		start = ISR_PROFILE_TCNT;
+		isrProfileLate(vector, count >= match ? count - match : count + 1);
+	}
+	inline ~IsrProfileScope() { isrProfileRecord(vector, (uint16_t)(ISR_PROFILE_TCNT - start)); }
+};
+
+#define ISR_PROFILE_SCOPE(vector) IsrProfileScope _isrProfileScope(vector);
+#define ISR_PROFILE_LATE_SCOPE(vector, count, match) IsrProfileScope _isrProfileScope(vector, count, match);
+uint8_t isrProfileInit(void);
+void isrProfileGet(uint8_t vector, IsrProfile* profile);
+void isrProfileReset(void);
+#else
+#define ISR_PROFILE_SCOPE(vector)
+#define ISR_PROFILE_LATE_SCOPE(vector, count, match)
+#endif
+
+#endif /* ISRPROFILE_H_ */
@@ -0,0 +1,77 @@
+/*
+ * LoopProfile.cpp
+ * Main loop instrumentation, see LoopProfile.h
+ * Created: 10/18/2026 9:52:06 PM
+ *  Author: jg
+ */
+#include "LoopProfile.h"
+
+#ifdef LOOP_PROFILE
+#include <string.h>
+
+LoopProfile loopProfile;
+/*
+* Called at the top of each pass with micros(), the first pass after a reset only marks the time
+*/
+void loopProfilePeriod(uint32_t now)
+{
+	if( loopProfile.loopTime ) {
+		uint32_t period = now - loopProfile.loopTime;
+		uint32_t bound = period >> LOOP_PROFILE_BUCKET_SHIFT;
+		uint8_t bucket = 0;
+		while( bound && bucket < LOOP_PROFILE_BUCKETS - 1 ) {
+			bound >>= 1;
+			++bucket;
+		}
+		++loopProfile.periods[bucket];
+		++loopProfile.loops;
+		if( period > loopProfile.maxPeriod )
+			loopProfile.maxPeriod = period;
+	}
+	loopProfile.loopTime = now;
+}
+/*
+* Add a run of a G or M code, the slot of the code is found by a linear search of the few there are
+*/
+void loopProfileCode(char letter, int code, uint32_t elapsed)
+{
+	CodeProfile* slot = NULL;
+	for(int i = 0; i < LOOP_PROFILE_CODES; i++) {
+		CodeProfile* p = &loopProfile.codes[i];
+		if( !p->letter ) {
+			p->letter = letter;
+			p->code = code;
+			p->minMicros = elapsed;
+			slot = p;
+			break;
+		}
+		if( p->letter == letter && p->code == (uint16_t)code ) {
+			slot = p;
+			break;
+		}
+	}
+	if( !slot ) {
+		++loopProfile.untracked;
+		return;
+	}
+	++slot->count;
+	slot->micros += elapsed;
+	if( elapsed < slot->minMicros )
+		slot->minMicros = elapsed;
+	if( elapsed > slot->maxMicros )
+		slot->maxMicros = elapsed;
+}
+
+void loopProfileInactivity(uint32_t elapsed)
+{
+	++loopProfile.inactivityCount;
+	loopProfile.inactivityMicros += elapsed;
+	if( elapsed > loopProfile.inactivityMax )
+		loopProfile.inactivityMax = elapsed;
+}
+
+void loopProfileReset(void)
+{
+	memset(&loopProfile, 0, sizeof(LoopProfile));
+}
+#endif
@@ -0,0 +1,49 @@
+/*
+ * LoopProfile.h
+ * Main loop instrumentation, compiled in with LOOP_PROFILE in Configuration_adv.h.
+ * The loop records its period from one pass to the next in a histogram of power of 2 buckets, process_commands records the
+ * microseconds each G and M code took against the code, and manage_inactivity its own time, all from micros() at 4us resolution.
+ * The first LOOP_PROFILE_CODES distinct codes seen get a slot, the runs of any other are counted as untracked.
+ * Reported and reset by M708 with the byte counts of the serial ports.
+ * Created: 10/18/2026 9:52:06 PM
+ *  Author: jg
+ */
+#ifndef LOOPPROFILE_H_
+#define LOOPPROFILE_H_
+#include <inttypes.h>
+#include "Configuration_adv.h"
+
+#ifdef LOOP_PROFILE
+// bucket n counts loop periods under 64us << n, the last bucket all the longer ones
+#define LOOP_PROFILE_BUCKET_SHIFT 6
+
+struct CodeProfile {
+	char letter; // G or M, 0 for a free slot
+	uint16_t code;
+	uint32_t count;
+	uint32_t micros;
+	uint32_t minMicros;
+	uint32_t maxMicros;
+};
+
+struct LoopProfile {
+	uint32_t loopTime; // micros() at the start of the last pass, 0 before the first
+	uint32_t loops;
+	uint32_t maxPeriod;
+	uint32_t periods[LOOP_PROFILE_BUCKETS];
+	uint32_t inactivityCount;
+	uint32_t inactivityMicros;
+	uint32_t inactivityMax;
+	uint32_t untracked;
+	CodeProfile codes[LOOP_PROFILE_CODES];
+};
+
+extern LoopProfile loopProfile;
+
+void loopProfilePeriod(uint32_t now);
+void loopProfileCode(char letter, int code, uint32_t elapsed);
+void loopProfileInactivity(uint32_t elapsed);
+void loopProfileReset(void);
+#endif
+
+#endif /* LOOPPROFILE_H_ */
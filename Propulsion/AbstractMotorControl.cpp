@@ -25,6 +25,8 @@
 */
 
 #include "AbstractMotorControl.h"
+#include "../pins.h"
+#include "../Configuration_adv.h"
 
 /*
 * Link ultrasonic sensor to controller. Modify element in ultrasonicIndex array to point to Ultrasonic object.
@@ -52,6 +54,9 @@ void AbstractMotorControl::linkDistanceSensor(Ultrasonic** us, uint8_t upin, uin
 */
 bool AbstractMotorControl::checkUltrasonicShutdown() {
 		bool shutdown = false;
+		// a synchronized command is being applied with interrupts off, the ranging follows in manage_inactivity
+		if( syncCommand )
+			return shutdown;
 		for(int i = 0; i < 10; i++)
 			if( motorSpeed[i] != 0 ) {
 				break;
@@ -81,10 +86,22 @@ bool AbstractMotorControl::checkUltrasonicShutdown() {
 		return shutdown;
 }
 
+/*
+* An encoder on an INTn pin is counted in its own vector with the edge selected in hardware,
+* any other goes through the shared pin change dispatch.
+*/
 void AbstractMotorControl::createEncoder(uint8_t channel, uint8_t encode_pin) {
 		wheelEncoderService[channel-1] = new CounterInterruptService(maxMotorDuration[channel-1]);
-		wheelEncoder[channel-1] = new PCInterrupts();
-		wheelEncoder[channel-1]->attachInterrupt(encode_pin, wheelEncoderService[channel-1], CHANGE);
+		encoderPin[channel-1] = encode_pin;
+		int8_t intNum = digitalPinToInterrupt(encode_pin);
+		if( intNum != NOT_AN_INTERRUPT ) {
+			Interrupts* ext = new Interrupts();
+			ext->attachCounter(intNum, wheelEncoderService[channel-1], CHANGE);
+			wheelEncoder[channel-1] = ext;
+		} else {
+			wheelEncoder[channel-1] = new PCInterrupts();
+			wheelEncoder[channel-1]->attachInterrupt(encode_pin, wheelEncoderService[channel-1], CHANGE);
+		}
 }
 /*
 * If we are using an encoder check the interval since last command.
@@ -128,7 +145,201 @@ void AbstractMotorControl::resetEncoders(void) {
 }
 
 void AbstractMotorControl::resetSpeeds(void) {
-	for(int i = 0; i < 10; i++) motorSpeed[i] = 0; // all channels down
+	for(int i = 0; i < 10; i++) {
+		motorSpeed[i] = 0; // all channels down
+		targetSpeed[i] = 0; // and no ramp resumes after the stop
+		powerLimit[i] = 1000; // and the next start is not held back by the last current limit
+	}
+}
+/*
+* Command a target power for the channel. If no slew rate is set for the channel it is applied immediately
+* through commandMotorPower, otherwise it is saved and updateMotorRamp moves the channel toward it.
+* ch - channel 1-10
+* p - target power -1000 to 1000
+*/
+int AbstractMotorControl::commandMotorTarget(uint8_t ch, int16_t p) {
+	if( !motorAccel[ch-1] && !motorDecel[ch-1] ) {
+		targetSpeed[ch-1] = p;
+		return commandMotorPower(ch, p);
+	}
+	// if the channel was idle, the ramp interval starts now, otherwise keep accumulating from the last step
+	if( motorSpeed[ch-1] == targetSpeed[ch-1] )
+		rampTime[ch-1] = millis();
+	targetSpeed[ch-1] = p;
+	// the new command starts the encoder interval, the ramp steps do not
+	resetEncoders();
+	return 0;
+}
+/*
+* Command channels 1 to nch from the array of powers as one synchronized update, as from G6.
+* The caller holds interrupts off across all the controllers involved so the PWM updates land in the same timer period,
+* so the ultrasonic ranging, which can block for the echo timeout, is skipped here and done on the following manage_inactivity.
+* A ramped channel only takes its target here. The ramps started together share the same start time, millis does not advance
+* with interrupts off, and updateMotorRamp writes the steps due on a poll together, so channels with the same rates stay in step.
+* Returns the status of the first channel that failed, the remaining channels are still commanded.
+* nch - number of channels in p
+* p - array of target power -1000 to 1000, element 0 is channel 1
+*/
+int AbstractMotorControl::commandMotorTargets(uint8_t nch, int16_t* p) {
+	int status = 0;
+	int result;
+	syncCommand = true;
+	for(uint8_t i = 0; i < nch; i++) {
+		if( (result = commandMotorTarget(i+1, p[i])) && !status )
+			status = result;
+	}
+	syncCommand = false;
+	return status;
+}
+/*
+* Step each channel that is not at its target toward it, limited by the accel or decel rate and the
+* time elapsed since the last step. Steps smaller than one power unit are accumulated until one is due, and the ramp time only
+* advances by the time the whole units took, so the fraction carries to the next step and the ramp keeps its rate at any poll interval.
+* A decelerating step stops at zero so the reversal picks up the acceleration rate.
+* The steps due on this poll are worked out first and then written together, on a PWM driven controller in one critical section
+* as G6 writes them, with the ranging deferred to manage_inactivity. A smart controller needs interrupts for its UART.
+* now - current time base millis
+*/
+void AbstractMotorControl::updateMotorRamp(uint32_t now) {
+	int16_t next[10];
+	uint16_t due = 0;
+	for(int i = 0; i < 10; i++) {
+		int cur = motorSpeed[i];
+		int tgt = targetSpeed[i];
+		if( cur == tgt )
+			continue;
+		if( MOTORSHUTDOWN ) {
+			targetSpeed[i] = cur;
+			continue;
+		}
+		bool decel = (cur > 0 && tgt < cur) || (cur < 0 && tgt > cur);
+		uint16_t rate = decel ? motorDecel[i] : motorAccel[i];
+		long power = tgt;
+		if( rate ) {
+			long step = ((uint32_t)rate * (now - rampTime[i])) / 1000;
+			if( !step )
+				continue;
+			rampTime[i] += (uint32_t)step * 1000 / rate;
+			if( tgt > cur ) {
+				power = cur + step;
+				if( power > tgt ) power = tgt;
+			} else {
+				power = cur - step;
+				if( power < tgt ) power = tgt;
+			}
+			if( decel && ((cur > 0 && power < 0) || (cur < 0 && power > 0)) )
+				power = 0;
+		}
+		next[i] = (int16_t)power;
+		due |= 1 << i;
+	}
+	if( !due )
+		return;
+	if( isSmartController() ) {
+		writeRampSteps(next, due);
+		return;
+	}
+	uint8_t oldSREG = SREG;
+	cli();
+	syncCommand = true;
+	writeRampSteps(next, due);
+	syncCommand = false;
+	SREG = oldSREG;
+}
+/*
+* Write the ramp steps of the channels in the due mask.
+* A failed command abandons the ramp, the emergency stop, if issued, has already reset the targets,
+* so a channel whose target now matches its speed is left where the stop put it.
+* next - power by channel index, due - mask of channel indexes to write
+*/
+void AbstractMotorControl::writeRampSteps(int16_t* next, uint16_t due) {
+	rampCommand = true;
+	for(int i = 0; i < 10; i++) {
+		if( !(due & (1 << i)) || targetSpeed[i] == motorSpeed[i] )
+			continue;
+		if( commandMotorPower(i+1, next[i]) )
+			targetSpeed[i] = motorSpeed[i];
+	}
+	rampCommand = false;
+}
+
+/*
+* Attach an ADC current sense input to the channel.
+* ch - channel 1-10
+* pin - analog input pin 54-69
+* offset - ADC counts at zero current, nonzero for bidirectional hall sensors centered at half supply
+* scale - milliamps per ADC count
+*/
+void AbstractMotorControl::createCurrentSense(uint8_t ch, uint8_t pin, int16_t offset, uint16_t scale) {
+	if( !currentSense[ch-1] ) {
+		if( !assignPin(pin) )
+			return;
+		currentSense[ch-1] = new Analog(pin);
+		currentSense[ch-1]->pinMode(INPUT);
+	}
+	currentOffset[ch-1] = offset;
+	currentScale[ch-1] = scale;
+}
+/*
+* Read the channel current sense, magnitude in amps * 10, the same units the smart controller reports.
+* One conversion, about 110 microseconds.
+*/
+int AbstractMotorControl::queryChannelCurrent(uint8_t ch) {
+	if( !currentSense[ch-1] )
+		return -1;
+	int32_t counts = currentSense[ch-1]->analogRead() - currentOffset[ch-1];
+	if( counts < 0 )
+		counts = -counts;
+	return (int)((counts * currentScale[ch-1]) / 100);
+}
+/*
+* Sample the channel currents and adjust the output scale of each channel. Over the channel limit, or over the controller
+* total limit, the scale is cut in proportion to the overcurrent so a stall is pulled back within one sample. Under the
+* limits it recovers by CURRENT_LIMIT_RECOVERY per sample. A channel whose scale changes is recommanded at its saved power.
+*/
+void AbstractMotorControl::updateCurrentLimit(void) {
+	int amps[10];
+	int32_t total = 0;
+	if( MOTORSHUTDOWN )
+		return;
+	for(uint8_t i = 0; i < channels; i++) {
+		if( !currentLimit[i] && !totalCurrentLimit ) {
+			amps[i] = -1;
+			continue;
+		}
+		amps[i] = queryChannelCurrent(i+1);
+		if( amps[i] > 0 )
+			total += amps[i];
+	}
+	for(uint8_t i = 0; i < channels; i++) {
+		uint32_t scale = powerLimit[i];
+		bool over = false;
+		if( currentLimit[i] && amps[i] > currentLimit[i] ) {
+			scale = (scale * currentLimit[i]) / amps[i];
+			over = true;
+		}
+		if( totalCurrentLimit && total > totalCurrentLimit ) {
+			uint32_t tscale = ((uint32_t)powerLimit[i] * totalCurrentLimit) / total;
+			if( tscale < scale )
+				scale = tscale;
+			over = true;
+		}
+		if( !over ) {
+			if( scale >= 1000 )
+				continue;
+			scale += CURRENT_LIMIT_RECOVERY;
+			if( scale > 1000 )
+				scale = 1000;
+		}
+		if( scale == powerLimit[i] )
+			continue;
+		powerLimit[i] = scale;
+		if( motorSpeed[i] ) {
+			rampCommand = true;
+			commandMotorPower(i+1, motorSpeed[i]);
+			rampCommand = false;
+		}
+	}
 }
 
 // virtual destructor
@@ -20,6 +20,20 @@
 * motor integrity affecting values that represent the same speed on different channels.
 * 4) The motorSpeed is indexed by channel and the value is the range that comes from the main controller, before any processing into a timer value.
 * 5) the current direction and default direction have different meanings depending on subclass.
+* 6) Optionally, an acceleration and deceleration slew rate in power units (the -1000 to 1000 range) per second. When set, commandMotorTarget
+* saves the target and updateMotorRamp steps motorSpeed toward it through commandMotorPower so the host
+* can send sparse target commands and still get a smooth ramp. It is polled from manage_inactivity every MOTOR_RAMP_INTERVAL of the
+* time base rather than run from the tick, as a step can be serial I/O to a smart controller, and the steps are sized from the time base
+* so the ramp holds its rate whatever the loop load. A controller that is not connected is not stepped, its ramp picks up where the
+* elapsed time puts it once it is. Only the host command resets the encoder interval, the ramp steps
+* leave it running so the encoder interlock still trips during a ramp. Deceleration applies when the magnitude decreases, including the leg
+* of a reversal toward zero. A rate of 0 is no limit. The steps due on a poll are written together, on a PWM driven controller in one
+* critical section, so the channels a G6 ramps at the same rates stay in step, though the G6 itself only sets their targets.
+* 7) Optionally, a current monitor and limit. Bridge drivers read an ADC channel on a shunt or hall current sensor per channel,
+* smart controllers return their own cached current measurement. updateCurrentLimit, polled every CURRENT_SAMPLE_INTERVAL, compares
+* the channel current and the controller total to the limits and reduces powerLimit, a scale in 1/1000 applied to the output
+* by commandMotorPower while motorSpeed keeps the commanded value, then lets it recover once the current is back under the limit.
+* The switch bridge cannot modulate, so it is monitored but not limited.
 *
 * Types of low level DC drivers supported:
 * HBridge - A low level motor PWM driver that uses 1 enable pin with 2 states (logic high/low), to drive a mortor in the forward or backward direction.
@@ -49,6 +63,9 @@
 #include "../Ultrasonic.h"
 #include "../CounterInterruptService.h"
 #include "../WPCInterrupts.h"
+#include "../WInterrupts.h"
+#include "../WTime.h"
+#include "../WAnalog.h"
 
 class AbstractMotorControl
 {
@@ -69,11 +86,28 @@ protected:
 	uint8_t defaultDirection[10] = {0,0,0,0,0,0,0,0,0,0};
 	uint32_t minMotorPower[10] = {0,0,0,0,0,0,0,0,0,0}; // Offset to add to G5, use with care, meant to compensate for mechanical differences
 	CounterInterruptService* wheelEncoderService[10] = {0,0,0,0,0,0,0,0,0,0}; // encoder service
-	PCInterrupts* wheelEncoder[10] = {0,0,0,0,0,0,0,0,0,0};
+	InterruptsBase* wheelEncoder[10] = {0,0,0,0,0,0,0,0,0,0}; // INTn or pin change by the pin
+	uint8_t encoderPin[10] = {0,0,0,0,0,0,0,0,0,0};
+	Digital* enablePin[10] = {0,0,0,0,0,0,0,0,0,0}; // direction or enable pin by channel, resolved when the channel is created
+	int targetSpeed[10] = {0,0,0,0,0,0,0,0,0,0}; // slew limited target power, same range as motorSpeed
+	uint16_t motorAccel[10] = {0,0,0,0,0,0,0,0,0,0}; // power units per second as magnitude increases, 0 - no limit
+	uint16_t motorDecel[10] = {0,0,0,0,0,0,0,0,0,0}; // power units per second as magnitude decreases, 0 - no limit
+	uint32_t rampTime[10] = {0,0,0,0,0,0,0,0,0,0}; // millis of last ramp step by channel
+	Analog* currentSense[10] = {0,0,0,0,0,0,0,0,0,0}; // ADC current sense input by channel, bridge drivers
+	int16_t currentOffset[10] = {0,0,0,0,0,0,0,0,0,0}; // ADC counts at zero current
+	uint16_t currentScale[10] = {0,0,0,0,0,0,0,0,0,0}; // milliamps per ADC count
+	uint16_t currentLimit[10] = {0,0,0,0,0,0,0,0,0,0}; // amps * 10 by channel, 0 - no limit
+	uint16_t totalCurrentLimit = 0; // amps * 10 for all channels of the controller, 0 - no limit
+	uint16_t powerLimit[10] = {1000,1000,1000,1000,1000,1000,1000,1000,1000,1000}; // output scale in 1/1000 set by the current limit
+	bool syncCommand = false; // set while commandMotorTargets runs in a critical section, ranging deferred to manage_inactivity
+	bool rampCommand = false; // set while the ramp or current limit recommands a channel, the encoder interval is left running
 	int MOTORPOWERSCALE = 0; // Motor scale, divisor for motor power to reduce 0-1000 scale if non zero
 	uint8_t MOTORSHUTDOWN = 0; // Override of motor controls, puts it up on blocks
 	int MAXMOTORPOWER = 255; // Max motor power in PWM final timer units
 	int fault_flag = 0;
+	// scale the output power by the current limit, the commanded power saved in motorSpeed is unaffected
+	int16_t limitPower(uint8_t ch, int16_t p) { return powerLimit[ch-1] >= 1000 ? p : (int16_t)(((int32_t)p * powerLimit[ch-1]) / 1000); }
+	void writeRampSteps(int16_t* next, uint16_t due);
 public:
 	virtual ~AbstractMotorControl();
 	virtual int commandMotorPower(uint8_t ch, int16_t p)=0;//make AbstractMotorControl not instantiable
@@ -82,6 +116,10 @@ public:
 	virtual void getDriverInfo(uint8_t ch, char* outStr)=0;
 	virtual int queryFaultFlag(void)=0;
     virtual int queryStatusFlag(void)=0;
+	// Smart controllers talk over a UART and need interrupts to complete a command
+	virtual bool isSmartController(void) { return false; }
+	// Called every pass of the main loop so controllers with a transport to service can advance it without blocking
+	virtual void pollDevice(uint32_t now) {}
 	void linkDistanceSensor(Ultrasonic** us, uint8_t upin, uint32_t distance, uint8_t facing=1);
 	bool checkUltrasonicShutdown(void);
 	bool checkEncoderShutdown(void);
@@ -102,11 +140,29 @@ public:
 	int getMotorSpeed(uint8_t ch) { return motorSpeed[ch-1]; }
 	uint8_t getCurrentDirection(uint8_t ch) { return currentDirection[ch-1]; }
 	uint8_t getDefaultDirection(uint8_t ch) { return defaultDirection[ch-1]; }
-	PCInterrupts* getWheelEncoder(uint8_t ch) { return wheelEncoder[ch-1]; }
+	InterruptsBase* getWheelEncoder(uint8_t ch) { return wheelEncoder[ch-1]; }
+	uint8_t getEncoderPin(uint8_t ch) { return encoderPin[ch-1]; }
 	CounterInterruptService* getWheelEncoderService(uint8_t ch) { return wheelEncoderService[ch-1]; }
 	void setChannels(uint8_t ch) { channels = ch; }
 	uint8_t getChannels(void) { return channels; }
 	void resetSpeeds(void);
+	int commandMotorTarget(uint8_t ch, int16_t p);
+	int commandMotorTargets(uint8_t nch, int16_t* p);
+	void updateMotorRamp(uint32_t now);
+	int getMotorTarget(uint8_t ch) { return targetSpeed[ch-1]; }
+	void setMotorAccel(uint8_t ch, uint16_t rate) { motorAccel[ch-1] = rate; }
+	void setMotorDecel(uint8_t ch, uint16_t rate) { motorDecel[ch-1] = rate; }
+	uint16_t getMotorAccel(uint8_t ch) { return motorAccel[ch-1]; }
+	uint16_t getMotorDecel(uint8_t ch) { return motorDecel[ch-1]; }
+	void createCurrentSense(uint8_t ch, uint8_t pin, int16_t offset, uint16_t scale);
+	// channel current in amps * 10, -1 if the channel has no current measurement
+	virtual int queryChannelCurrent(uint8_t ch);
+	void updateCurrentLimit(void);
+	void setCurrentLimit(uint8_t ch, uint16_t amps) { currentLimit[ch-1] = amps; }
+	void setTotalCurrentLimit(uint16_t amps) { totalCurrentLimit = amps; }
+	uint16_t getCurrentLimit(uint8_t ch) { return currentLimit[ch-1]; }
+	uint16_t getTotalCurrentLimit(void) { return totalCurrentLimit; }
+	uint16_t getPowerLimit(uint8_t ch) { return powerLimit[ch-1]; }
 	void resetEncoders(void);
 	void setMotorShutdown(void) { commandEmergencyStop(1); MOTORSHUTDOWN = 1;}
 	void setMotorRun(void) { commandEmergencyStop(0); MOTORSHUTDOWN = 0;}
@@ -20,6 +20,17 @@ public:
 	void setMaxMotorPower(int p) { MAXMOTORPOWER = abs(p)/4; }
 	void setMotorPowerScale(int p) { MOTORPOWERSCALE = abs(p)/4;}
 	virtual void resetMaxMotorPower()=0;//set back to the maximum power, subclass sets
+	// Apply the min, max and scale, which are kept in 8 bit timer units, to a 0-1000 power level for a PWM whose
+	// duty is written at the full command resolution against a TOP computed from its frequency
+	int16_t limitLevel(uint8_t ch, int16_t level) {
+		if( level != 0 && level < (int16_t)(minMotorPower[ch-1]*4) )
+			level = minMotorPower[ch-1]*4;
+		if( level > MAXMOTORPOWER*4 )
+			level = MAXMOTORPOWER*4;
+		if( MOTORPOWERSCALE != 0 )
+			level /= MOTORPOWERSCALE;
+		return level;
+	}
 
 }; //AbstractPWMMotorControl
 
@@ -19,6 +19,7 @@ public:
 	void setMinMotorPower(uint8_t ch, uint32_t mpow) {minMotorPower[ch-1] = mpow;}
 	void setMaxMotorPower(int p) {MAXMOTORPOWER = p;}
 	void setMotorPowerScale(int p) {MOTORPOWERSCALE = p;}
+	bool isSmartController(void) { return true; }
 	virtual void resetMaxMotorPower()=0;//set back to the maximum power, subclass sets
 
 }; //AbstractSmartMotorControl
@@ -28,9 +28,7 @@ int HBridgeDriver::commandEmergencyStop(int status)
 	for(int j=0; j < 10; j++) {
 		int pindex = motorDrive[j][0];
 		if(pindex != 255) {
-			ppwms[pindex]->init(ppwms[pindex]->pin);
-			ppwms[pindex]->setPWMPrescale(motorDrive[j][2]);
-			ppwms[pindex]->setPWMResolution(motorDrive[j][3]);
+			// turning off the output needs no timer setup, pwmOff drives the pin low and disconnects the compare output
 			ppwms[pindex]->pwmOff();
 		}
 	}
@@ -47,13 +45,35 @@ int HBridgeDriver::commandEmergencyStop(int status)
 * dir_default - the default direction the motor starts in
 * timer_pre - timer prescale default 1 = no prescale
 * timer_res - timer resolution in bits - default 8
+* frequency - if nonzero, PWM frequency in Hz with TOP computed from it, replacing prescale and resolution, 16 bit timers only
+* phaseCorrect - phase correct instead of fast PWM
+* Returns the timer claim status, TIMER_CLAIM_CONFLICT if the timer of the pin runs another configuration for another owner,
+* in which case the PWM and direction pins are released and the channel is not created. The channel count is only raised
+* once the channel exists, so loops bounded by getChannels never reach a channel without a PWM.
 */ 
-void HBridgeDriver::createPWM(uint8_t channel, uint8_t pin_number, uint8_t dir_pin, uint8_t dir_default, int timer_pre, int timer_res) {
+uint8_t HBridgeDriver::createPWM(uint8_t channel, uint8_t pin_number, uint8_t dir_pin, uint8_t dir_default, int timer_pre, int timer_res, uint32_t frequency, uint8_t phaseCorrect) {
 	// Attempt to assign PWM pin, lock to 8 bits no prescale, mode 2 CTC
-	if( getChannels() < channel ) setChannels(channel);
 	if( assignPin(pin_number) ) {
 		// Set up the digital direction pin
 		if( assignPin(dir_pin) ) {
+			int pindex;
+			for(pindex = 0; pindex < 10; pindex++) {
+				if( !ppwms[pindex] )
+					break;
+			}
+			if( ppwms[pindex] )
+				return TIMER_CLAIM_OK;
+			PWM* ppin = new PWM(pin_number);
+			ppin->init(pin_number);
+			// a drive motor never runs at a configuration it did not ask for
+			uint8_t claim = ppin->claimTimer(TIMER_OWNER_MOTOR, timer_pre, timer_res, frequency, phaseCorrect);
+			if( claim == TIMER_CLAIM_CONFLICT ) {
+				delete ppin;
+				unassignPin(pin_number);
+				unassignPin(dir_pin);
+				return claim;
+			}
+			// the direction pin is only created once the timer is ours, so a rejected channel leaves nothing behind
 			Digital* dpin = new Digital(dir_pin);
 			dpin->pinMode(OUTPUT);
 			for(int i = 0; i < 10; i++) {
@@ -62,13 +82,7 @@ void HBridgeDriver::createPWM(uint8_t channel, uint8_t pin_number, uint8_t dir_p
 					break;
 				}
 			}
-			int pindex;
-			for(pindex = 0; pindex < 10; pindex++) {
-				if( !ppwms[pindex] )
-					break;
-			}
-			if( ppwms[pindex] )
-				return;
+			enablePin[channel-1] = dpin;
 			currentDirection[channel-1] = dir_default;
 			defaultDirection[channel-1] = dir_default;
 			
@@ -76,11 +90,13 @@ void HBridgeDriver::createPWM(uint8_t channel, uint8_t pin_number, uint8_t dir_p
 			motorDrive[channel-1][1] = dir_pin;
 			motorDrive[channel-1][2] = timer_pre;
 			motorDrive[channel-1][3] = timer_res;
-			PWM* ppin = new PWM(pin_number);
 			ppwms[pindex] = ppin;
-			ppwms[pindex]->init(pin_number);
+			if( frequency || phaseCorrect )
+				ppwms[pindex]->setPWMFrequency(frequency, phaseCorrect);
+			if( getChannels() < channel ) setChannels(channel);
 		}
 	}
+	return TIMER_CLAIM_OK;
 }
 /*
 * Command the bridge driver power level. Manage direction pin. If necessary limit min and max power and
@@ -91,41 +107,35 @@ int HBridgeDriver::commandMotorPower(uint8_t motorChannel, int16_t motorPower) {
 		// check shutdown override
 		if( MOTORSHUTDOWN )
 			return 0;
+		// a channel createPWM never set up, or whose timer claim was refused, has no PWM to write
+		if( motorDrive[motorChannel-1][0] == 255 )
+			return 1;
 		int foundPin = 0;
 		motorSpeed[motorChannel-1] = motorPower;
+		motorPower = limitPower(motorChannel, motorPower);
 		// get mapping of channel to pin
 		// see if we need to make a direction change, check array of [PWM pin][dir pin][dir]
 		if( currentDirection[motorChannel-1]) { // if dir 1, we are going what we define as 'forward' 
 			if( motorPower < 0 ) { // and we want to go backward
-				// reverse dir, send dir change to pin
-				for(int i = 0; i < 10; i++) {
-					if(pdigitals[i] && pdigitals[i]->pin == motorDrive[motorChannel-1][1]) {
-							//pdigitals[i]->setPin(motorDrive[motorChannel-1][1]);
-							pdigitals[i]->pinMode(OUTPUT);
-							// default is 0 (LOW), if we changed the direction to reverse wheel rotation call the opposite dir change signal
-							defaultDirection[motorChannel-1] ? pdigitals[i]->digitalWrite(HIGH) : pdigitals[i]->digitalWrite(LOW);
-							currentDirection[motorChannel-1] = 0; // set new direction value
-							motorPower = -motorPower; // absolute val
-							foundPin = 1;
-							break;
-					}
+				// reverse dir, send dir change to pin resolved in createPWM
+				if( enablePin[motorChannel-1] ) {
+					// default is 0 (LOW), if we changed the direction to reverse wheel rotation call the opposite dir change signal
+					enablePin[motorChannel-1]->fastWrite(defaultDirection[motorChannel-1] ? HIGH : LOW);
+					currentDirection[motorChannel-1] = 0; // set new direction value
+					motorPower = -motorPower; // absolute val
+					foundPin = 1;
 				}
 			} else { // wieter weiter
 				foundPin = 1;
 			}
 		} else { // dir is 0
 			if( motorPower > 0 ) { // we are going 'backward' as defined by our initial default direction and we want 'forward'
-				// reverse, send dir change to pin
-				for(int i = 0; i < 10; i++) {
-					if(pdigitals[i] && pdigitals[i]->pin == motorDrive[motorChannel-1][1]) {
-						//pdigitals[i]->setPin(motorDrive[motorChannel-1][1]);
-						pdigitals[i]->pinMode(OUTPUT);
-						// default is 0 (HIGH), if we changed the direction to reverse wheel rotation call the opposite dir change signal
-						defaultDirection[motorChannel-1] ? pdigitals[i]->digitalWrite(LOW) : pdigitals[i]->digitalWrite(HIGH);
-						currentDirection[motorChannel-1] = 1;
-						foundPin = 1;
-						break;
-					}
+				// reverse, send dir change to pin resolved in createPWM
+				if( enablePin[motorChannel-1] ) {
+					// default is 0 (HIGH), if we changed the direction to reverse wheel rotation call the opposite dir change signal
+					enablePin[motorChannel-1]->fastWrite(defaultDirection[motorChannel-1] ? LOW : HIGH);
+					currentDirection[motorChannel-1] = 1;
+					foundPin = 1;
 				}
 			} else { // backward with more backwardness
 				// If less than 0 take absolute value, if zero dont play with sign
@@ -136,6 +146,7 @@ int HBridgeDriver::commandMotorPower(uint8_t motorChannel, int16_t motorPower) {
 		if(!foundPin) {
 			return commandEmergencyStop(2);
 		}	
+		int16_t level = motorPower; // 0-1000, for a PWM running at a set frequency
 		// scale motor power from 0-1000 to our 0-255 8 bit timer val
 		motorPower /= 4;
 		if( motorPower != 0 && motorPower < minMotorPower[motorChannel-1])
@@ -146,8 +157,9 @@ int HBridgeDriver::commandMotorPower(uint8_t motorChannel, int16_t motorPower) {
 		if( MOTORPOWERSCALE != 0 )
 				motorPower /= MOTORPOWERSCALE;
 		//
-		// Reset encoders on new speed setting
-		resetEncoders();
+		// Reset encoders on new speed setting, not on a ramp step
+		if( !rampCommand )
+			resetEncoders();
 		// If we have a linked distance sensor. check range and possibly skip
 		// If we are setting power 0, we are stopping anyway
 		if( !checkUltrasonicShutdown()) {
@@ -157,12 +169,12 @@ int HBridgeDriver::commandMotorPower(uint8_t motorChannel, int16_t motorPower) {
 			int timer_res = motorDrive[motorChannel-1][3]; // timer resolution in bits from M3
 			// element 0 of motorDrive has index to PWM array
 			int pindex = motorDrive[motorChannel-1][0];
-			// writing power 0 sets mode 0 and timer turnoff
-			ppwms[pindex]->init(ppwms[pindex]->pin);
-			ppwms[pindex]->setPWMPrescale(timer_pre);
-			ppwms[pindex]->setPWMResolution(timer_res);
+			// writing power 0 sets mode 0 and timer turnoff, otherwise the timer is only reprogrammed if prescale or resolution changed
 			//ppwms[pindex]->attachInterrupt(motorDurationService[motorChannel-1]);// last param TRUE indicates an overflow interrupt
-			ppwms[pindex]->pwmWrite(motorPower, timer_mode);
+			if( ppwms[pindex]->frequency )
+				ppwms[pindex]->pwmWriteDuty(limitLevel(motorChannel, level), 1000, timer_mode);
+			else
+				ppwms[pindex]->pwmWrite(motorPower, timer_pre, timer_res, timer_mode);
 		}
 		fault_flag = 0;
 		return 0;
@@ -1,7 +1,7 @@
 #include "../Arduino.h"
 #include "RoboteqDevice.h"
 #include "../HardwareSerial/HardwareSerial.h"
-#include <util\delay.h>
+#include "../WTime.h"
 
 
 char* chomp(char* s) {
@@ -14,6 +14,11 @@ char* chomp(char* s) {
 RoboteqDevice::RoboteqDevice(HardwareSerial *serial) :AbstractSmartMotorControl(1000) {
 	m_Timeout = ROBOTEQ_DEFAULT_TIMEOUT;
 	setChannels(2);
+	firmware[0] = '\0';
+	memset(cacheFlags, 0, ROBOTEQ_TRANSACTIONS);
+	memset(queryTime, 0, sizeof(queryTime));
+	memset(&status, 0, sizeof(RoboteqStatus));
+	inFlightKey[0] = '\0';
 	m_Serial = serial;
 	m_Serial->begin(115200);
 }
@@ -22,27 +27,249 @@ RoboteqDevice::RoboteqDevice(HardwareSerial *serial) :AbstractSmartMotorControl(
 void RoboteqDevice::setTimeout(uint16_t timeout) {
 	m_Timeout = timeout;
 }
+/*
+* Advance the transport. Called every pass of manage_inactivity so it must never wait on the controller.
+* The receive side is drained first so a reply arriving this pass frees the line for the next transaction.
+* A transaction that draws no reply within ROBOTEQ_RESPONSE_TIMEOUT is dropped, and if nothing at all has been
+* heard for m_Timeout the controller is marked disconnected. With nothing queued a probe is sent every
+* ROBOTEQ_PING_INTERVAL, the ACK keeps the cached connection status current.
+*/
+void RoboteqDevice::pollDevice(uint32_t now) {
+	if (this->m_Serial == NULL)
+		return;
+	parseResponse(now);
+	if( inFlight && (now - inFlightTime) >= ROBOTEQ_RESPONSE_TIMEOUT ) {
+		if( inFlightId > ROBOTEQ_PING && inFlightId < ROBOTEQ_TRANSACTIONS )
+			cacheFlags[inFlightId] &= ~(ROBOTEQ_CACHE_PENDING_SLOT << (inFlightCh > 0 ? inFlightCh-1 : 0));
+		inFlight = false;
+		rxIndex = 0;
+	}
+	if( connected && (now - lastReply) >= m_Timeout )
+		connected = false;
+	if( inFlight )
+		return;
+	if( txCount == 0 ) {
+		if( (now - lastPing) < ROBOTEQ_PING_INTERVAL )
+			return;
+		lastPing = now;
+		m_Serial->write(ROBOTEQ_QUERY_CHAR);
+		inFlightId = ROBOTEQ_PING;
+		inFlightCh = 0;
+		inFlightKey[0] = '\0';
+	} else {
+		RoboteqTransaction* t = &txQueue[txHead];
+		// the UART transmit buffer holds the whole line, write does not wait unless it is full
+		m_Serial->write((const uint8_t*)t->text, strlen(t->text));
+		inFlightId = t->id;
+		inFlightCh = t->ch;
+		// a query is answered by a line keyed with the query name, ?BA 1 by BA=
+		uint8_t k = 0;
+		if( t->text[0] == '?' ) {
+			const char* q = t->text+1;
+			while( k < ROBOTEQ_KEY_SIZE-1 && *q != ' ' && *q != '\r' && *q != '\0' )
+				inFlightKey[k++] = *q++;
+		}
+		inFlightKey[k] = '\0';
+		txHead = (txHead + 1) % ROBOTEQ_QUEUE_SIZE;
+		--txCount;
+	}
+	inFlight = true;
+	inFlightTime = now;
+	rxIndex = 0;
+}
+/*
+* Receive state machine. Consume whatever the UART has buffered, assembling lines in buffer until a carriage return.
+* The controller echoes each command and query before answering, lines starting with a command or query prefix are echoes
+* and are discarded. A + or - completes a command, KEY=value[:value] completes the query in flight when the key matches.
+* While streaming, the controller pushes its query history unsolicited and those lines go to the status frame.
+* The ACK to a probe arrives as a single character without a line terminator.
+*/
+void RoboteqDevice::parseResponse(uint32_t now) {
+	while( m_Serial->available() > 0 ) {
+		uint8_t inByte = m_Serial->read();
+		if( inByte == ROBOTEQ_ACK_CHAR ) {
+			connected = true;
+			lastReply = now;
+			if( inFlight && inFlightId == ROBOTEQ_PING )
+				inFlight = false;
+			continue;
+		}
+		if( inByte == '\n' )
+			continue;
+		if( inByte != '\r' ) {
+			if( rxIndex < ROBOTEQ_BUFFER_SIZE-1 )
+				buffer[rxIndex++] = inByte;
+			continue;
+		}
+		buffer[rxIndex] = '\0';
+		uint8_t len = rxIndex;
+		rxIndex = 0;
+		if( len == 0 )
+			continue;
+		char* line = (char*)buffer;
+		if( line[0] == '!' || line[0] == '?' || line[0] == '^' || line[0] == '%' || line[0] == '#' )
+			continue; // echo
+		connected = true;
+		lastReply = now;
+		if( line[0] == '+' || line[0] == '-' ) {
+			if( !inFlight )
+				continue; // reply to a transaction we already gave up on
+			lastCommandStatus = (line[0] == '+') ? ROBOTEQ_OK : ROBOTEQ_BAD_COMMAND;
+			if( inFlightId > ROBOTEQ_PING ) // a query the controller rejected
+				cacheFlags[inFlightId] &= ~(ROBOTEQ_CACHE_PENDING_SLOT << (inFlightCh > 0 ? inFlightCh-1 : 0));
+			inFlight = false;
+			continue;
+		}
+		char* val = strchr(line, '=');
+		if( val == NULL )
+			continue;
+		*val++ = '\0';
+		bool streamed = streaming && parseTelemetry(line, val, now);
+		if( !inFlight || strcmp(line, inFlightKey) != 0 )
+			continue;
+		if( inFlightId == ROBOTEQ_Q_FIRMWARE ) {
+			strncpy(firmware, val, ROBOTEQ_FIRMWARE_SIZE-1);
+			firmware[ROBOTEQ_FIRMWARE_SIZE-1] = '\0';
+			cacheFlags[inFlightId] |= 0x01;
+		} else if( !streamed && inFlightId > ROBOTEQ_PING ) {
+			// per channel queries land in the channel slot, channel-less queries may return a value per channel
+			uint8_t slot = (inFlightCh > 0) ? inFlightCh-1 : 0;
+			while( slot < 2 ) {
+				storeQuery(inFlightId, slot, strtol(val, &val, 10), now);
+				if( inFlightCh > 0 || *val != ':' )
+					break;
+				++val;
+				++slot;
+			}
+		}
+		if( inFlightId > ROBOTEQ_PING )
+			cacheFlags[inFlightId] &= ~(ROBOTEQ_CACHE_PENDING_SLOT << (inFlightCh > 0 ? inFlightCh-1 : 0));
+		inFlight = false;
+	}
+}
+/*
+* Parse one line of the streamed query history into the status frame, and into the query cache so the query methods
+* see it. Returns false if the key is not one of ours, a query issued while streaming is appended to the history by the
+* controller and its repeats are only taken as the reply to that query.
+*/
+bool RoboteqDevice::parseTelemetry(const char *key, char *val, uint32_t now) {
+	int32_t v[3];
+	uint8_t n = 0;
+	while( n < 3 ) {
+		v[n++] = strtol(val, &val, 10);
+		if( *val != ':' )
+			break;
+		++val;
+	}
+	if( !strcmp(key, "A") ) {
+		for(uint8_t i = 0; i < n && i < 2; i++) {
+			status.motorAmps[i] = v[i];
+			storeQuery(ROBOTEQ_Q_MOTOR_AMPS, i, v[i], now);
+		}
+	} else if( !strcmp(key, "BA") ) {
+		for(uint8_t i = 0; i < n && i < 2; i++) {
+			status.batteryAmps[i] = v[i];
+			storeQuery(ROBOTEQ_Q_BATTERY_AMPS, i, v[i], now);
+		}
+	} else if( !strcmp(key, "S") ) {
+		for(uint8_t i = 0; i < n && i < 2; i++) {
+			status.speed[i] = v[i];
+			storeQuery(ROBOTEQ_Q_SPEED, i, v[i], now);
+		}
+	} else if( !strcmp(key, "V") ) {
+		// V=<internal/motor>:<battery>:<5V output>
+		if( n < 2 )
+			return false;
+		status.motorVolts = v[0];
+		status.batteryVolts = v[1];
+		storeQuery(ROBOTEQ_Q_MOTOR_VOLTS, 0, v[0], now);
+		storeQuery(ROBOTEQ_Q_BATTERY_VOLTS, 0, v[1], now);
+	} else if( !strcmp(key, "FF") ) {
+		status.faultFlags = v[0];
+		storeQuery(ROBOTEQ_Q_FAULT, 0, v[0], now);
+	} else if( !strcmp(key, "FS") ) {
+		// last in the history, the frame is complete
+		status.statusFlags = v[0];
+		storeQuery(ROBOTEQ_Q_STATUS, 0, v[0], now);
+		status.timestamp = now;
+		statusReady = true;
+	} else {
+		return false;
+	}
+	return true;
+}
 
-int RoboteqDevice::isConnected() {
+void RoboteqDevice::storeQuery(uint8_t id, uint8_t slot, int32_t val, uint32_t now) {
+	queryCache[id][slot] = val;
+	queryTime[id][slot] = now;
+	cacheFlags[id] |= (1 << slot);
+}
+/*
+* Clear the controller query history, enter the status queries and start the repeat. The whole sequence is queued
+* at once or not at all.
+*/
+int RoboteqDevice::startTelemetry(uint16_t interval) {
+	static const char* const streamQueries[ROBOTEQ_STREAM_QUERIES] = { "?A\r", "?BA\r", "?V\r", "?S\r", "?FF\r", "?FS\r" };
+	if( interval == 0 )
+		return stopTelemetry();
 	if (this->m_Serial == NULL)
-		return 0;
-	m_Serial->write(ROBOTEQ_QUERY_CHAR);
-	m_Serial->flush();
-	uint8_t inByte;
-	for(int i = 0; i < 10; i++) {
-		if (m_Serial->available() > 0) {
-			while(m_Serial->available() > 0) {
-				inByte = m_Serial->read();
-				if (inByte == ROBOTEQ_ACK_CHAR) {
-						return 1;
-				}
+		return ROBOTEQ_ERROR;
+	if( txCount + ROBOTEQ_STREAM_QUERIES + 2 > ROBOTEQ_QUEUE_SIZE )
+		return ROBOTEQ_BUFFER_OVER;
+	enqueue("# C\r", ROBOTEQ_CMD, 0);
+	for(uint8_t i = 0; i < ROBOTEQ_STREAM_QUERIES; i++)
+		enqueue(streamQueries[i], ROBOTEQ_CMD, 0);
+	sprintf(command, "# %u\r", interval);
+	enqueue(command, ROBOTEQ_CMD, 0);
+	streaming = true;
+	statusReady = false;
+	return ROBOTEQ_OK;
+}
+/*
+* Stop the repeat and clear the history, the query methods go back to polling.
+*/
+int RoboteqDevice::stopTelemetry(void) {
+	if (this->m_Serial == NULL)
+		return ROBOTEQ_ERROR;
+	if( txCount + 2 > ROBOTEQ_QUEUE_SIZE )
+		return ROBOTEQ_BUFFER_OVER;
+	enqueue("#\r", ROBOTEQ_CMD, 0);
+	enqueue("# C\r", ROBOTEQ_CMD, 0);
+	streaming = false;
+	statusReady = false;
+	return ROBOTEQ_OK;
+}
+/*
+* Place a line on the transmit queue. An unsent motor command for the same channel is overwritten rather than
+* queued behind, so a burst of power changes never backs up and the controller always gets the latest.
+*/
+int RoboteqDevice::enqueue(const char *text, uint8_t id, uint8_t ch) {
+	if (this->m_Serial == NULL)
+		return ROBOTEQ_ERROR;
+	if( strlen(text) >= ROBOTEQ_COMMAND_BUFFER_SIZE )
+		return ROBOTEQ_BAD_COMMAND;
+	RoboteqTransaction* t = NULL;
+	if( id == ROBOTEQ_CMD_GO ) {
+		for(uint8_t i = 0; i < txCount; i++) {
+			RoboteqTransaction* q = &txQueue[(txHead + i) % ROBOTEQ_QUEUE_SIZE];
+			if( q->id == ROBOTEQ_CMD_GO && q->ch == ch ) {
+				t = q;
+				break;
 			}
 		}
-		_delay_ms(10);
 	}
-	// timeout
-	return 0;
+	if( t == NULL ) {
+		if( txCount >= ROBOTEQ_QUEUE_SIZE )
+			return ROBOTEQ_BUFFER_OVER;
+		t = &txQueue[(txHead + txCount) % ROBOTEQ_QUEUE_SIZE];
+		++txCount;
+	}
+	strcpy(t->text, text);
+	t->id = id;
+	t->ch = ch;
+	return ROBOTEQ_OK;
 }
+
 /*
 * Command the motor to spin. May reset current direction. Encoders reset regardless if present. Checks for ultrasonic shutdown if present.
 * ch - channel. max is controller dependent
@@ -67,8 +294,9 @@ int RoboteqDevice::commandMotorPower(uint8_t ch, int16_t p) {
 			currentDirection[ch-1] = 0; // set new direction value
 	else // dir is 1 forward
 			currentDirection[ch-1] = 1;		
-	// New command resets encoder count
-	resetEncoders();
+	// New command resets encoder count, a ramp step does not
+	if( !rampCommand )
+		resetEncoders();
 	// if power 0, we are stopping anyway
 	if( checkUltrasonicShutdown() )
 		return ROBOTEQ_OK;
@@ -81,6 +309,7 @@ int RoboteqDevice::commandMotorPower(uint8_t ch, int16_t p) {
 		else
 			p = -minMotorPower[ch-1];
 	}
+	p = limitPower(ch, p);
 	if( abs(p) > MAXMOTORPOWER ) { // cap it at max
 		if(p > 0)
 			p = MAXMOTORPOWER;
@@ -93,7 +322,7 @@ int RoboteqDevice::commandMotorPower(uint8_t ch, int16_t p) {
 	}
 	sprintf(command, "!G %02d %d\r", ch, p);
 	fault_flag = 0;
-	return this->sendCommand(command);
+	return this->sendCommand(command, ROBOTEQ_CMD_GO, ch);
 
 }
 /*
@@ -102,9 +331,16 @@ int RoboteqDevice::commandMotorPower(uint8_t ch, int16_t p) {
 int RoboteqDevice::commandEmergencyStop(int status)
 {
 	//sprintf(command, "!EX\r");
+	// anything still waiting to go out is stale now, the stops go out next. A discarded query clears its pending bit
+	// so the next read of that value queues a fresh refresh.
+	for(uint8_t i = 0; i < txCount; i++) {
+		RoboteqTransaction* t = &txQueue[(txHead + i) % ROBOTEQ_QUEUE_SIZE];
+		cacheFlags[t->id] &= ~(ROBOTEQ_CACHE_PENDING_SLOT << (t->ch > 0 ? t->ch-1 : 0));
+	}
+	txCount = 0;
 	for(int ch = 0; ch < getChannels(); ch++) {
 		sprintf(command, "!G %02d %d\r", ch+1, 0);
-		this->sendCommand(command);
+		this->sendCommand(command, ROBOTEQ_CMD_GO, ch+1);
 	}
 	fault_flag = 16;
 	resetSpeeds();
@@ -134,16 +370,9 @@ int RoboteqDevice::commandBrushlessCounter(void) {
 int RoboteqDevice::queryFaultFlag() {
 	// Query: ?FF
 	// Response: FF=<status>
-	int fault = -1;
-	memset(buffer, NULL, ROBOTEQ_BUFFER_SIZE);
-	int res = 0;
-	if ((res = this->sendQuery("?FF\r", (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-		return res;
-	if (res < 4)
-		return ROBOTEQ_BAD_RESPONSE;
-	// Parse Response
-	if (sscanf((char*)buffer, "FF=%i", &fault) < 1)
-		return ROBOTEQ_BAD_RESPONSE;
+	int fault = cachedQuery(ROBOTEQ_Q_FAULT, 0, "?FF\r");
+	if( fault < 0 ) // nothing heard yet, report only our own
+		return fault_flag;
 	return fault | fault_flag;
 }
 /*
@@ -159,47 +388,47 @@ int RoboteqDevice::queryFaultFlag() {
 int RoboteqDevice::queryStatusFlag() {
 	// Query: ?FS
 	// Response: FS=<status>
-	int status = -1;
-	memset(buffer, NULL, ROBOTEQ_BUFFER_SIZE);
-	int res;
-	if ((res = this->sendQuery("?FS\r", (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 4)
-	return ROBOTEQ_BAD_RESPONSE;
-	// Parse Response
-	if (sscanf((char*)buffer, "FS=%i", &status) < 1)
-	return ROBOTEQ_BAD_RESPONSE;
-	return status;
+	return cachedQuery(ROBOTEQ_Q_STATUS, 0, "?FS\r");
 }
-
+/*
+* Copy the firmware id from the last reply, ROBOTEQ_TIMEOUT until one has arrived.
+*/
 int RoboteqDevice::queryFirmware(char* buf, size_t bufSize) {
 	// Query: ?FID
 	// Response: FID=<firmware>
 	memset(buf, NULL, bufSize);
-	return this->sendQuery("?FID\r", (uint8_t*)buf, 100);
-	// TODO: Parse response
+	if( !(cacheFlags[ROBOTEQ_Q_FIRMWARE] & 0x01) ) {
+		cachedQuery(ROBOTEQ_Q_FIRMWARE, 0, "?FID\r");
+		return ROBOTEQ_TIMEOUT;
+	}
+	strncpy(buf, firmware, bufSize-1);
+	return strlen(buf);
 }
 
 int RoboteqDevice::queryMotorPower(uint8_t ch) {
 	// Query: ?M [ch]
 	// Response: M=<motor power>
-	int p;
-	int res;
-
-	// Build Query Command
 	sprintf(command, "?M %i\r", ch);
+	return cachedQuery(ROBOTEQ_Q_MOTOR_POWER, ch, command);
+}
 
-	// Send Query
-	if ((res = this->sendQuery("?BA\r", (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 4)
-	return ROBOTEQ_BAD_RESPONSE;
-
-	// Parse Response
-	if (sscanf((char*)buffer, "M=%i", &p) < 1) {
-		return ROBOTEQ_BAD_RESPONSE;
-	}
-	return p;
+int RoboteqDevice::queryMotorAmps(uint8_t ch) {
+	// Query: ?A [ch]
+	// Response: A=<ch*10>
+	sprintf(command, "?A %i\r", ch);
+	return cachedQuery(ROBOTEQ_Q_MOTOR_AMPS, ch, command);
+}
+/*
+* Magnitude of the cached motor amps, the sign of regeneration does not matter to the limit.
+*/
+int RoboteqDevice::queryChannelCurrent(uint8_t ch) {
+	if( ch < 1 || ch > 2 )
+		return -1;
+	sprintf(command, "?A %i\r", ch);
+	sendQuery(ROBOTEQ_Q_MOTOR_AMPS, ch, command);
+	if( !(cacheFlags[ROBOTEQ_Q_MOTOR_AMPS] & (1 << (ch-1))) )
+		return -1;
+	return abs(queryCache[ROBOTEQ_Q_MOTOR_AMPS][ch-1]);
 }
 /*
 * total amperage at both channels totaled
@@ -207,77 +436,38 @@ int RoboteqDevice::queryMotorPower(uint8_t ch) {
 int RoboteqDevice::queryBatteryAmps(void) {
 	// Query: ?BA
 	// Response: BA=<ch1*10>:<ch2*10>
-	int ch1, ch2;
-	int res;
-
-	// Send Query
-	if ((res = this->sendQuery("?BA\r", (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 4)
-	return ROBOTEQ_BAD_RESPONSE;
-
-	// Parse Response
-	if (sscanf((char*)buffer, "BA=%i:%i", &ch1, &ch2) < 2) {
-		return ROBOTEQ_BAD_RESPONSE;
-	}
-
+	int ch1 = cachedQuery(ROBOTEQ_Q_BATTERY_AMPS, 0, "?BA\r");
+	if( ch1 < 0 )
+		return ch1;
+	if( !(cacheFlags[ROBOTEQ_Q_BATTERY_AMPS] & 0x02) )
+		return ch1;
 	// Return total amps (ch1 + ch2)
-	return ch1+ch2;
+	return ch1 + queryCache[ROBOTEQ_Q_BATTERY_AMPS][1];
 }
-
+/*
+* Served from the same ?BA reply as the total, which carries every channel.
+*/
 int RoboteqDevice::queryBatteryAmps(uint8_t ch) {
-	// Query: ?BA [ch]
-	// Response: BA=<ch*10>
-	int amps;
-	int res;
-
-	// Build Query Command
-	sprintf(command, "?BA %i\r", ch);
-
-	// Send Query
-	if ((res = this->sendQuery(command, (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 4)
-	return ROBOTEQ_BAD_RESPONSE;
-
-	// Parse Response
-	if (sscanf((char*)buffer, "BA=%i", &amps) < 1) {
-		return ROBOTEQ_BAD_RESPONSE;
-	}
-
-	return amps;
+	// Query: ?BA
+	// Response: BA=<ch1*10>:<ch2*10>
+	if( ch < 1 || ch > 2 )
+		return ROBOTEQ_BAD_COMMAND;
+	cachedQuery(ROBOTEQ_Q_BATTERY_AMPS, 0, "?BA\r");
+	if( !(cacheFlags[ROBOTEQ_Q_BATTERY_AMPS] & (1 << (ch-1))) )
+		return ROBOTEQ_TIMEOUT;
+	return queryCache[ROBOTEQ_Q_BATTERY_AMPS][ch-1];
 }
 
 int RoboteqDevice::queryBatteryVoltage(void) {
 	// Query: ?V 2 (2 = main battery voltage)
 	// Response: V=<voltage>*10
-	int voltage = -1;
-	memset(buffer, NULL, ROBOTEQ_BUFFER_SIZE);
-	int res;
-	if ((res = this->sendQuery("?V 2\r", (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 4)
-	return ROBOTEQ_BAD_RESPONSE;
-	// Parse Response
-	if (sscanf((char*)buffer, "V=%i", &voltage) != 1)
-	return ROBOTEQ_BAD_RESPONSE;
-	return voltage;
+	return cachedQuery(ROBOTEQ_Q_BATTERY_VOLTS, 0, "?V 2\r");
 }
 
 int RoboteqDevice::queryMotorVoltage(void) {
 	// Query: ?V 1 (1 = main motor voltage)
 	// Response: V=<voltage>*10
-	int voltage = -1;
-	memset(buffer, NULL, ROBOTEQ_BUFFER_SIZE);
-	int res;
-	if ((res = this->sendQuery("?V 1\r", (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 4)
-	return ROBOTEQ_BAD_RESPONSE;
-	// Parse Response
-	if (sscanf((char*)buffer, "V=%i", &voltage) != 1)
-	return ROBOTEQ_BAD_RESPONSE;
-	return voltage;
+	return cachedQuery(ROBOTEQ_Q_MOTOR_VOLTS, 0, "?V 1\r");
 }
 /*
 * Encoder speed in RPM
@@ -286,23 +476,8 @@ int RoboteqDevice::queryMotorVoltage(void) {
 int RoboteqDevice::queryEncoderSpeed(uint8_t ch){
 	// Query: ?S [ch]
 	// Response: S=[speed]
-	int speed;
-	int res;
-
-	// Build Query Command
 	sprintf(command, "?S %i\r", ch);
-
-	// Send Query
-	if ((res = this->sendQuery(command, (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 3)
-	return ROBOTEQ_BAD_RESPONSE;
-
-	// Parse Response
-	if (sscanf((char*)buffer, "S=%i", &speed) < 1) {
-		return ROBOTEQ_BAD_RESPONSE;
-	}
-	return speed;
+	return cachedQuery(ROBOTEQ_Q_SPEED, ch, command);
 }
 /*
 * Returns the measured motor speed as a ratio of the Max RPM configuration parameter 
@@ -310,23 +485,8 @@ int RoboteqDevice::queryEncoderSpeed(uint8_t ch){
 int RoboteqDevice::queryEncoderRelativeSpeed(uint8_t ch) {
 	// Query: ?SR [ch]
 	// Response: SR=[speed]
-	int speed;
-	int res;
-
-	// Build Query Command
 	sprintf(command, "?SR %i\r", ch);
-
-	// Send Query
-	if ((res = this->sendQuery(command, (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 3)
-	return ROBOTEQ_BAD_RESPONSE;
-
-	// Parse Response
-	if (sscanf((char*)buffer, "SR=%i", &speed) < 1) {
-		return ROBOTEQ_BAD_RESPONSE;
-	}
-	return speed;
+	return cachedQuery(ROBOTEQ_Q_SPEED_RELATIVE, ch, command);
 }
 /*
 * On brushless motor controllers, returns the running total of Hall sensor transition value as
@@ -334,50 +494,20 @@ int RoboteqDevice::queryEncoderRelativeSpeed(uint8_t ch) {
 * counts.
 */
 int RoboteqDevice::queryBrushlessCounter(uint8_t ch) {
-	// Query: ?CB [ch]
-	// Response: CB=[speed]
-	int speed;
-	int res;
-
-	// Build Query Command
+	// Query: ?C [ch]
+	// Response: C=[speed]
 	sprintf(command, "?C %i\r", ch);
-	
-	// Send Query
-	if ((res = this->sendQuery(command, (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 3)
-	return ROBOTEQ_BAD_RESPONSE;
-
-	// Parse Response
-	if (sscanf((char*)buffer, "C=%i", &speed) < 1) {
-		return ROBOTEQ_BAD_RESPONSE;
-	}
-	return speed;
+	return cachedQuery(ROBOTEQ_Q_COUNTER, ch, command);
 }
 /*
 * On brushless motor controllers, returns the number of Hall sensor transition value that
 * have been measured from the last time this query was made.
 */
 int RoboteqDevice::queryBrushlessCounterRelative(uint8_t ch) {
-	// Query: ?CBR [ch]
-	// Response: CBR=[speed]
-	int speed;
-	int res;
-
-	// Build Query Command
+	// Query: ?CR [ch]
+	// Response: CR=[speed]
 	sprintf(command, "?CR %i\r", ch);
-
-	// Send Query
-	if ((res = this->sendQuery(command, (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 3)
-	return ROBOTEQ_BAD_RESPONSE;
-
-	// Parse Response
-	if (sscanf((char*)buffer, "CR=%i", &speed) < 1) {
-		return ROBOTEQ_BAD_RESPONSE;
-	}
-	return speed;
+	return cachedQuery(ROBOTEQ_Q_COUNTER_RELATIVE, ch, command);
 }
 /*
 * To report RPM accurately, the correct number of motor poles must be
@@ -386,23 +516,8 @@ int RoboteqDevice::queryBrushlessCounterRelative(uint8_t ch) {
 int RoboteqDevice::queryBrushlessSpeed(uint8_t ch) {
 	// Query: ?BS [ch]
 	// Response: BS=[speed]
-	int speed;
-	int res;
-
-	// Build Query Command
 	sprintf(command, "?BS %i\r", ch);
-
-	// Send Query
-	if ((res = this->sendQuery(command, (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 3)
-	return ROBOTEQ_BAD_RESPONSE;
-
-	// Parse Response
-	if (sscanf((char*)buffer, "BS=%i", &speed) < 1) {
-		return ROBOTEQ_BAD_RESPONSE;
-	}
-	return speed;
+	return cachedQuery(ROBOTEQ_Q_BL_SPEED, ch, command);
 }
 /*
 * On brushless motor controllers, returns the measured motor speed as a ratio of the Max RPM configuration parameter
@@ -410,23 +525,8 @@ int RoboteqDevice::queryBrushlessSpeed(uint8_t ch) {
 int RoboteqDevice::queryBrushlessSpeedRelative(uint8_t ch) {
 	// Query: ?BSR [ch]
 	// Response: BSR=[speed]
-	int speed;
-	int res;
-
-	// Build Query Command
 	sprintf(command, "?BSR %i\r", ch);
-
-	// Send Query
-	if ((res = this->sendQuery(command, (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 3)
-	return ROBOTEQ_BAD_RESPONSE;
-
-	// Parse Response
-	if (sscanf((char*)buffer, "BSR=%i", &speed) < 1) {
-		return ROBOTEQ_BAD_RESPONSE;
-	}
-	return speed;
+	return cachedQuery(ROBOTEQ_Q_BL_SPEED_RELATIVE, ch, command);
 }
 
 /*
@@ -435,23 +535,7 @@ int RoboteqDevice::queryBrushlessSpeedRelative(uint8_t ch) {
 int RoboteqDevice::queryTime() {
 	// Query: ?TM
 	// Response: TM=[time]
-	int speed;
-	int res;
-
-	// Build Query Command
-	sprintf(command, "?TM\r");
-
-	// Send Query
-	if ((res = this->sendQuery(command, (uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE)) < 0)
-	return res;
-	if (res < 3)
-	return ROBOTEQ_BAD_RESPONSE;
-
-	// Parse Response
-	if (sscanf((char*)buffer, "TM=%i", &speed) < 1) {
-		return ROBOTEQ_BAD_RESPONSE;
-	}
-	return speed;
+	return cachedQuery(ROBOTEQ_Q_TIME, 0, "?TM\r");
 }
 
 int RoboteqDevice::setEncoderPulsePerRotation(uint8_t ch, uint16_t ppr) {
@@ -465,7 +549,7 @@ int RoboteqDevice::getEncoderPulsePerRotation(uint8_t ch) {
 }
 
 int RoboteqDevice::setMotorAmpLimit(uint8_t ch, uint16_t a){
-	sprintf(command, "^ALIM %i %i", ch, a);
+	sprintf(command, "^ALIM %i %i\r", ch, a);
 	return this->sendCommand(command);
 }
 
@@ -484,87 +568,44 @@ int RoboteqDevice::saveConfiguration(void) {
 	return this->sendCommand(command);
 }
 
-int RoboteqDevice::sendCommand(const char *command) {
-	return this->sendCommand(command, strlen(command));
+/*
+* Queue a command, the + or - reply is reflected later in getLastCommandStatus.
+*/
+int RoboteqDevice::sendCommand(const char *command, uint8_t id, uint8_t ch) {
+	return enqueue(command, id, ch);
 }
-
-int RoboteqDevice::sendCommand(const char *command, size_t commandSize) {
-	if (this->m_Serial == NULL)
-		return ROBOTEQ_ERROR;
-
-	if(commandSize <= 0 || commandSize >= ROBOTEQ_COMMAND_BUFFER_SIZE)
-	{
+/*
+* Queue a query unless one for the same value is already waiting or the cached value is fresher than ROBOTEQ_QUERY_INTERVAL.
+*/
+int RoboteqDevice::sendQuery(uint8_t id, uint8_t ch, const char *query) {
+	uint8_t slot = (ch > 0) ? ch-1 : 0;
+	if( slot > 1 )
 		return ROBOTEQ_BAD_COMMAND;
-	}
-		
-	for(int i = 0 ; i < commandSize; i++) {
-		this->m_Serial->write(*(command+i));
-		this->m_Serial->flush();
-		_delay_ms(1);
-		this->m_Serial->read(); // absorb echo
-	}
-	//this->m_Serial->flush();
-	
-	int res = this->readResponse((uint8_t*)buffer, ROBOTEQ_BUFFER_SIZE);
-
-	if (res < 1)
-		return ROBOTEQ_BAD_RESPONSE;
-
-	// Check Command Status
-	if (strncmp((char*)buffer, "+", 1) == 0) {
+	if( cacheFlags[id] & (ROBOTEQ_CACHE_PENDING_SLOT << slot) )
 		return ROBOTEQ_OK;
-	} else {
-		return ROBOTEQ_BAD_COMMAND;
-	}
-}
-
-int RoboteqDevice::sendQuery(const char *query, uint8_t *buf, size_t bufSize) {
-	return this->sendQuery(query, strlen(query), buf, bufSize);
-}
-
-int RoboteqDevice::sendQuery(const char *query, size_t querySize, uint8_t *buf, size_t bufSize) {
-	if (this->m_Serial == NULL)
-	return ROBOTEQ_ERROR;
-
-	// Write Query to Serial
-	//this->m_Serial->write((uint8_t*)query, querySize);
-	for(int i = 0 ; i < querySize; i++) {
-		this->m_Serial->write(*(query+i));
-		this->m_Serial->flush();
-		_delay_ms(1);
-		this->m_Serial->read(); // absorb echo
+	if( streaming && (ROBOTEQ_STREAM_IDS & (1UL << id)) )
+		return ROBOTEQ_OK; // kept current by the stream
+	uint32_t now = millis();
+	if( (cacheFlags[id] & (1 << slot)) && (now - queryTime[id][slot]) < ROBOTEQ_QUERY_INTERVAL )
+		return ROBOTEQ_OK;
+	int res = enqueue(query, id, ch);
+	if( res == ROBOTEQ_OK ) {
+		cacheFlags[id] |= (ROBOTEQ_CACHE_PENDING_SLOT << slot);
+		queryTime[id][slot] = now;
 	}
-	//this->m_Serial->flush();
-
-	// Read Serial until timeout or newline
-	return (this->readResponse(buf, bufSize));
+	return res;
 }
 /*
-* read the expected response; iterate 10 times, waiting 100 ms per, on the available read buffer > 0
+* Request a refresh of the value and return what we have, ROBOTEQ_TIMEOUT if no reply has been received yet.
 */
-int RoboteqDevice::readResponse(uint8_t *buf, size_t bufferSize) {
-	uint8_t inByte;
-	size_t index = 0;
-
-	for(int i = 0; i < 10; i++) {
-		if (m_Serial->available() > 0) {
-			while(m_Serial->available() > 0) {
-				inByte = m_Serial->read();
-				buf[index++] = inByte;
-				if (index > bufferSize) {
-					// out of buffer space
-					return ROBOTEQ_BUFFER_OVER;
-				}
-				if (inByte == 0x0D) {
-					return index;
-				}
-		
-			}
-		}
-		_delay_ms(10);
-	}
-	// timeout
-	return ROBOTEQ_TIMEOUT;
+int RoboteqDevice::cachedQuery(uint8_t id, uint8_t ch, const char *query) {
+	int res = sendQuery(id, ch, query);
+	if( res == ROBOTEQ_BAD_COMMAND )
+		return res;
+	uint8_t slot = (ch > 0) ? ch-1 : 0;
+	if( !(cacheFlags[id] & (1 << slot)) )
+		return ROBOTEQ_TIMEOUT;
+	return queryCache[id][slot];
 }
 
 void RoboteqDevice::getDriverInfo(uint8_t ch, char* outStr) {
@@ -35,19 +35,117 @@
 #define ROBOTEQ_STATUS_STALL        0x10
 #define ROBOTEQ_STATUS_LIMIT        0x20
 #define ROBOTEQ_SCRIPT_RUN          0x80
+
+#define ROBOTEQ_QUEUE_SIZE          12   // transactions waiting to be sent, enough for the telemetry setup sequence
+#define ROBOTEQ_RESPONSE_TIMEOUT    50   // ms to wait for the reply to a transaction before it is dropped
+#define ROBOTEQ_PING_INTERVAL       250  // ms between connection probes when the line is idle
+#define ROBOTEQ_QUERY_INTERVAL      100  // ms minimum between refreshes of the same cached query
+
+// Transaction ids. Commands expect a + or - reply, queries update the cached value with the same id.
+#define ROBOTEQ_CMD                 0
+#define ROBOTEQ_CMD_GO              1
+#define ROBOTEQ_PING                2
+#define ROBOTEQ_Q_FAULT             3
+#define ROBOTEQ_Q_STATUS            4
+#define ROBOTEQ_Q_BATTERY_VOLTS     5
+#define ROBOTEQ_Q_MOTOR_VOLTS       6
+#define ROBOTEQ_Q_BATTERY_AMPS      7
+#define ROBOTEQ_Q_MOTOR_AMPS        8
+#define ROBOTEQ_Q_MOTOR_POWER       9
+#define ROBOTEQ_Q_SPEED             10
+#define ROBOTEQ_Q_SPEED_RELATIVE    11
+#define ROBOTEQ_Q_COUNTER           12
+#define ROBOTEQ_Q_COUNTER_RELATIVE  13
+#define ROBOTEQ_Q_BL_SPEED          14
+#define ROBOTEQ_Q_BL_SPEED_RELATIVE 15
+#define ROBOTEQ_Q_TIME              16
+#define ROBOTEQ_Q_FIRMWARE          17
+#define ROBOTEQ_TRANSACTIONS        18
+
+// per query cache flags, valid bits 0-1 and pending bits 2-3 for the two channel slots
+#define ROBOTEQ_CACHE_PENDING_SLOT  0x04
+
+#define ROBOTEQ_FIRMWARE_SIZE       32
+#define ROBOTEQ_KEY_SIZE            4
+
+// Queries placed in the controller query history for telemetry streaming, refreshed by the stream rather than polled
+#define ROBOTEQ_STREAM_QUERIES      6
+#define ROBOTEQ_STREAM_IDS          ((1UL<<ROBOTEQ_Q_FAULT)|(1UL<<ROBOTEQ_Q_STATUS)|(1UL<<ROBOTEQ_Q_BATTERY_VOLTS)|(1UL<<ROBOTEQ_Q_MOTOR_VOLTS)|\
+									(1UL<<ROBOTEQ_Q_BATTERY_AMPS)|(1UL<<ROBOTEQ_Q_MOTOR_AMPS)|(1UL<<ROBOTEQ_Q_SPEED))
+
+/*
+* Controller status assembled from the streamed query history. Values are as the controller reports them,
+* amps and volts * 10, speed in RPM. The frame is complete when the last query in the history, FS, arrives.
+*/
+typedef struct RoboteqStatus {
+	int16_t motorAmps[2];
+	int16_t batteryAmps[2];
+	int16_t speed[2];
+	int16_t motorVolts;
+	int16_t batteryVolts;
+	uint8_t faultFlags;
+	uint8_t statusFlags;
+	uint32_t timestamp; // millis when the frame completed
+} RoboteqStatus;
+
+/*
+* One queued line to the controller. The id determines how the reply is handled, ch is the 1 based channel
+* for per channel queries and motor commands, 0 if the line is not channel specific.
+*/
+typedef struct {
+	char text[ROBOTEQ_COMMAND_BUFFER_SIZE];
+	uint8_t id;
+	uint8_t ch;
+} RoboteqTransaction;
+
 /*
 * Uses HardwareSerial on the designated UART, presumably with an RS232 converter, to communicate with RobotEQ controllers.
 * Tested on VBL2360 but should be universal.
+* The transport never blocks. Commands and queries are placed on a transmit queue and pollDevice, called each pass of
+* manage_inactivity, sends them one transaction at a time and runs the receive side as a state machine over whatever
+* the UART has buffered. Query methods return the cached result of the last reply and queue a refresh, so the values
+* lag by at most a query interval. Connection status is cached from the ACK to a periodic probe and from any reply.
 */
 class RoboteqDevice : public AbstractSmartMotorControl {
 	private:
 		char command[ROBOTEQ_COMMAND_BUFFER_SIZE];
 		uint8_t buffer[ROBOTEQ_BUFFER_SIZE];
+		// transmit queue
+		RoboteqTransaction txQueue[ROBOTEQ_QUEUE_SIZE];
+		uint8_t txHead = 0;
+		uint8_t txCount = 0;
+		// the one transaction on the wire awaiting its reply
+		bool inFlight = false;
+		uint8_t inFlightId = 0;
+		uint8_t inFlightCh = 0;
+		uint32_t inFlightTime = 0;
+		char inFlightKey[ROBOTEQ_KEY_SIZE];
+		// receive line state
+		uint8_t rxIndex = 0;
+		// connection state
+		bool connected = false;
+		uint32_t lastReply = 0;
+		uint32_t lastPing = 0;
+		// query cache by transaction id and channel slot, with the valid bits per slot and a pending bit while a refresh is queued
+		int32_t queryCache[ROBOTEQ_TRANSACTIONS][2];
+		uint32_t queryTime[ROBOTEQ_TRANSACTIONS][2];
+		uint8_t cacheFlags[ROBOTEQ_TRANSACTIONS];
+		char firmware[ROBOTEQ_FIRMWARE_SIZE];
+		int lastCommandStatus = ROBOTEQ_OK;
+		// telemetry streaming
+		bool streaming = false;
+		bool statusReady = false;
+		RoboteqStatus status;
     // Constructors
     public:
 	    RoboteqDevice() : AbstractSmartMotorControl(1000) {
 				m_Timeout = ROBOTEQ_DEFAULT_TIMEOUT;
 				setChannels(2);
+				firmware[0] = '\0';
+				memset(cacheFlags, 0, ROBOTEQ_TRANSACTIONS);
+				memset(queryTime, 0, sizeof(queryTime));
+				memset(&status, 0, sizeof(RoboteqStatus));
+				inFlightKey[0] = '\0';
 				m_Serial = &Serial2;
 				//m_Serial->begin(115200); must do this later in setup as this is default ctor and static initializer too early
 		}
@@ -55,11 +153,47 @@ class RoboteqDevice : public AbstractSmartMotorControl {
 		~RoboteqDevice();
 		void resetMaxMotorPower() { MAXMOTORPOWER = 1000; }
         /*
-         * check if controller is connected
+         * check if controller is connected, from the cached state maintained by pollDevice
+         *
+         * @return 1 if connected
+         */
+        int isConnected(void) { return connected; }
+
+        /*
+         * advance the transport, drain the receive buffer, time out a lost reply, probe the connection when idle
+         * and put the next queued transaction on the wire. Never blocks.
          *
-         * @return ROBOTEQ_OK if connected
+         * @param now time base millis
          */
-        int isConnected(void);
+        void pollDevice(uint32_t now);
+
+        /*
+         * status of the last command reply
+         *
+         * @return ROBOTEQ_OK if the controller answered + or ROBOTEQ_BAD_COMMAND if -
+         */
+        int getLastCommandStatus(void) { return lastCommandStatus; }
+
+        /*
+         * Have the controller push the fault, status, amps, volts and speed queries every interval using its
+         * query history (# C, the queries, then # <ms>). The pushed lines are parsed as they arrive into the
+         * status frame and the query cache, so the matching query methods stop polling.
+         *
+         * @param interval ms between repeats, 0 to stop streaming
+         * @return ROBOTEQ_OK if queued, ROBOTEQ_BUFFER_OVER if the transmit queue cannot take the sequence
+         */
+        int startTelemetry(uint16_t interval);
+
+        int stopTelemetry(void);
+
+        bool isStreaming(void) { return streaming; }
+
+        /*
+         * @return true once per completed status frame since the last call
+         */
+        bool statusFrameReady(void) { bool r = statusReady; statusReady = false; return r; }
+
+        RoboteqStatus* getStatus(void) { return &status; }
 
         //*********************************************************************
         // Commands
@@ -107,6 +241,14 @@ class RoboteqDevice : public AbstractSmartMotorControl {
          */
         int queryMotorAmps(uint8_t ch);
 
+        /*
+         * channel current for the on-board current limit, from the cached motor amps
+         *
+         * @param ch channel
+         * @return magnitude of motor amps * 10, -1 until the first reply
+         */
+        int queryChannelCurrent(uint8_t ch);
+
         /*
          * query battery amps
          * 
@@ -268,13 +410,19 @@ class RoboteqDevice : public AbstractSmartMotorControl {
     // Private Methods
     private:
 
-        int sendQuery(const char *query, uint8_t *buf, size_t bufSize);
-        int sendQuery(const char *query, size_t querySize, uint8_t *buf, size_t bufSize);
+        int sendQuery(uint8_t id, uint8_t ch, const char *query);
+
+        int cachedQuery(uint8_t id, uint8_t ch, const char *query);
+
+        int sendCommand(const char *command, uint8_t id = ROBOTEQ_CMD, uint8_t ch = 0);
+
+        int enqueue(const char *text, uint8_t id, uint8_t ch);
+
+        void parseResponse(uint32_t now);
 
-        int sendCommand(const char *command);
-        int sendCommand(const char *command, size_t commandSize);
+        bool parseTelemetry(const char *key, char *val, uint32_t now);
 
-        int readResponse(uint8_t *buf, size_t bufSize);
+        void storeQuery(uint8_t id, uint8_t slot, int32_t val, uint32_t now);
 
     // Private Data
     private:
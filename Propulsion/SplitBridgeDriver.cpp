@@ -52,15 +52,12 @@ int SplitBridgeDriver::commandEmergencyStop(int status)
 {
 	HBridgeDriver::commandEmergencyStop(status);
 	for(int j=0; j < 10; j++) {
-		int pindex = motorDrive[j][1];
-		if(pindex != 255) {
-			pdigitals[pindex]->digitalWrite(LOW);
+		if( enablePin[j] ) {
+			enablePin[j]->fastWrite(LOW);
 		}
-		pindex = motorDriveB[j][0];
+		int pindex = motorDriveB[j][0];
 		if(pindex != 255) {
-			ppwms[pindex]->init(ppwms[pindex]->pin);
-			ppwms[pindex]->setPWMPrescale(motorDrive[j][2]);
-			ppwms[pindex]->setPWMResolution(motorDrive[j][3]);
+			// turning off the output needs no timer setup, pwmOff drives the pin low and disconnects the compare output
 			ppwms[pindex]->pwmOff();
 		}
 	}
@@ -78,38 +75,45 @@ int SplitBridgeDriver::commandEmergencyStop(int status)
 * dir_default - the default direction the motor starts in
 * timer_pre - timer prescale default 1 = no prescale
 * timer_res - timer resolution in bits - default 8
+* frequency - if nonzero, PWM frequency in Hz with TOP computed from it, replacing prescale and resolution, 16 bit timers only
+* phaseCorrect - phase correct instead of fast PWM
+* Returns the timer claim status, TIMER_CLAIM_CONFLICT if the timer of either pin runs another configuration for another owner,
+* in which case both pins, and the enable pin if this call created it, are released and the channel is not created.
+* The channel count is only raised once the channel exists.
 */
-void SplitBridgeDriver::createPWM(uint8_t channel, uint8_t pin_numberA, uint8_t pin_numberB, uint8_t enable_pin, uint8_t dir_default, int timer_pre, int timer_res) {
+uint8_t SplitBridgeDriver::createPWM(uint8_t channel, uint8_t pin_numberA, uint8_t pin_numberB, uint8_t enable_pin, uint8_t dir_default, int timer_pre, int timer_res, uint32_t frequency, uint8_t phaseCorrect) {
 	// Attempt to assign PWM pin, lock to 8 bits no prescale, mode 2 CTC
-	if( getChannels() < channel ) setChannels(channel);
 	if( assignPin(pin_numberA) && assignPin(pin_numberB)) {
 		// Set up the digital direction pin
 		int foundPin = 0;
 			// Set up the digital enable pin, we want to be able to re-use these pins for multiple channels on 1 controller
+			Digital* dpin = NULL;
+			int dslot = -1; // slot in pdigitals of an enable pin created here, released again if the timer is refused
 			if( assignPin(enable_pin) ) {
-				Digital* dpin = new Digital(enable_pin);
+				dpin = new Digital(enable_pin);
 				dpin->pinMode(OUTPUT);
 				for(int i = 0; i < 10; i++) {
 					if(!pdigitals[i]) {
 						pdigitals[i] = dpin;
+						dslot = i;
 						foundPin = 1;
 						break;
 					}
 				}
 				if(!foundPin) {
 					delete dpin;
-					return; // no slots?
+					return TIMER_CLAIM_OK; // no slots?
 				}
 			} else { // cant assign, it may be already assigned
 				for(int i = 0; i < 10; i++) {
-					if(pdigitals[i]->pin == enable_pin) {
-						//dpin = pdigitals[i];
+					if(pdigitals[i] && pdigitals[i]->pin == enable_pin) {
+						dpin = pdigitals[i];
 						foundPin = 1;
 						break;
 					}
 				}
 				if(!foundPin) {
-					return; // slots full...
+					return TIMER_CLAIM_OK; // slots full...
 				}
 			}
 		
@@ -119,12 +123,33 @@ void SplitBridgeDriver::createPWM(uint8_t channel, uint8_t pin_numberA, uint8_t
 				break;
 			}
 			if( ppwms[pindex] || ppwms[pindex+1])
-				return;
+				return TIMER_CLAIM_OK;
+			PWM* ppinA = new PWM(pin_numberA);
+			ppinA->init(pin_numberA);
+			PWM* ppinB = new PWM(pin_numberB);
+			ppinB->init(pin_numberB);
+			// a drive motor never runs at a configuration it did not ask for
+			uint8_t claim = ppinA->claimTimer(TIMER_OWNER_MOTOR, timer_pre, timer_res, frequency, phaseCorrect);
+			if( claim != TIMER_CLAIM_CONFLICT )
+				claim = ppinB->claimTimer(TIMER_OWNER_MOTOR, timer_pre, timer_res, frequency, phaseCorrect);
+			if( claim == TIMER_CLAIM_CONFLICT ) {
+				delete ppinA;
+				delete ppinB;
+				unassignPin(pin_numberA);
+				unassignPin(pin_numberB);
+				if( dslot >= 0 ) {
+					pdigitals[dslot] = 0;
+					delete dpin;
+					unassignPin(enable_pin);
+				}
+				return claim;
+			}
 			currentDirection[channel-1] = dir_default;
 			defaultDirection[channel-1] = dir_default;
 			
 			motorDrive[channel-1][0] = pindex;
 			motorDrive[channel-1][1] = enable_pin;
+			enablePin[channel-1] = dpin;
 			motorDrive[channel-1][2] = timer_pre;
 			motorDrive[channel-1][3] = timer_res;
 			//
@@ -133,13 +158,15 @@ void SplitBridgeDriver::createPWM(uint8_t channel, uint8_t pin_numberA, uint8_t
 			motorDriveB[channel-1][1] = dir_default;
 			motorDriveB[channel-1][2] = timer_pre;
 			motorDriveB[channel-1][3] = timer_res;
-			PWM* ppinA = new PWM(pin_numberA);
 			ppwms[pindex] = ppinA;
-			ppwms[pindex]->init(pin_numberA);
-			PWM* ppinB = new PWM(pin_numberB);
 			ppwms[pindex+1] = ppinB;
-			ppwms[pindex+1]->init(pin_numberB);
+			if( frequency || phaseCorrect ) {
+				ppwms[pindex]->setPWMFrequency(frequency, phaseCorrect);
+				ppwms[pindex+1]->setPWMFrequency(frequency, phaseCorrect);
+			}
+			if( getChannels() < channel ) setChannels(channel);
 	}
+	return TIMER_CLAIM_OK;
 }
 
 /*
@@ -150,17 +177,17 @@ int SplitBridgeDriver::commandMotorPower(uint8_t motorChannel, int16_t motorPowe
 	// check shutdown override
 	if( MOTORSHUTDOWN )
 		return 0;
+	// a channel createPWM never set up, or whose timer claim was refused, has no PWM to write
+	if( motorDrive[motorChannel-1][0] == 255 )
+		return 1;
 	int foundPin = 0;
+	motorSpeed[motorChannel-1] = motorPower;
+	motorPower = limitPower(motorChannel, motorPower);
 
-	// set enable pin
-	for(int i = 0; i < 10; i++) {
-			if(pdigitals[i] && pdigitals[i]->pin == motorDrive[motorChannel-1][1]) {
-				//pdigitals[i]->setPin(motorDrive[motorChannel-1][1]);
-				pdigitals[i]->pinMode(OUTPUT);
-				pdigitals[i]->digitalWrite(HIGH);
-				foundPin = 1;
-				break;
-			}
+	// set enable pin resolved in createPWM
+	if( enablePin[motorChannel-1] ) {
+		enablePin[motorChannel-1]->fastWrite(HIGH);
+		foundPin = 1;
 	}
 	// get mapping of channel to pin
 	// see if we need to make a direction change, check array of [PWM pin][dir pin][dir]
@@ -188,6 +215,7 @@ int SplitBridgeDriver::commandMotorPower(uint8_t motorChannel, int16_t motorPowe
 	if(!foundPin) {
 		return commandEmergencyStop(4);
 	}
+	int16_t level = motorPower; // 0-1000, for a PWM running at a set frequency
 	// scale motor power from 0-1000 to our 0-255 8 bit timer val
 	motorPower /= 4;
 	// scale motor power from 0-1000 to our 0-255 8 bit timer val
@@ -199,8 +227,9 @@ int SplitBridgeDriver::commandMotorPower(uint8_t motorChannel, int16_t motorPowe
 	if( MOTORPOWERSCALE != 0 )
 		motorPower /= MOTORPOWERSCALE;
 	//
-	// Reset encoders on new speed setting
-	resetEncoders();
+	// Reset encoders on new speed setting, not on a ramp step
+	if( !rampCommand )
+		resetEncoders();
 	// If we have a linked distance sensor. check range and possibly skip
 	// If we are setting power 0, we are stopping anyway
 	if( !checkUltrasonicShutdown()) {
@@ -212,12 +241,12 @@ int SplitBridgeDriver::commandMotorPower(uint8_t motorChannel, int16_t motorPowe
 		int pindex = motorDrive[motorChannel-1][0];
 		// add the offset to the input pin, which will be 0 or 1 depending on above logic
 		pindex += motorDriveB[motorChannel-1][1];
-		// writing power 0 sets mode 0 and timer turnoff
-		ppwms[pindex]->init(ppwms[pindex]->pin);
-		ppwms[pindex]->setPWMPrescale(timer_pre);
-		ppwms[pindex]->setPWMResolution(timer_res);
+		// writing power 0 sets mode 0 and timer turnoff, otherwise the timer is only reprogrammed if prescale or resolution changed
 		//ppwms[pindex]->attachInterrupt(motorDurationService[motorChannel-1]);// last param TRUE indicates an overflow interrupt
-		ppwms[pindex]->pwmWrite(motorPower, timer_mode);
+		if( ppwms[pindex]->frequency )
+			ppwms[pindex]->pwmWriteDuty(limitLevel(motorChannel, level), 1000, timer_mode);
+		else
+			ppwms[pindex]->pwmWrite(motorPower, timer_pre, timer_res, timer_mode);
 	}
 	fault_flag = 0;
 	return 0;
@@ -36,7 +36,7 @@ public:
 	SplitBridgeDriver() : HBridgeDriver(){};
 	~SplitBridgeDriver();
 	int commandEmergencyStop(int status);
-	void createPWM(uint8_t channel, uint8_t pin_numberA, uint8_t pin_numberB, uint8_t enb_pin, uint8_t dir_default, int timer_pre, int timer_res);
+	uint8_t createPWM(uint8_t channel, uint8_t pin_numberA, uint8_t pin_numberB, uint8_t enb_pin, uint8_t dir_default, int timer_pre, int timer_res, uint32_t frequency = 0, uint8_t phaseCorrect = 0);
 	int commandMotorPower(uint8_t motorChannel, int16_t motorPower);
 	uint8_t getMotorPWMPinB(uint8_t channel) { return motorDriveB[channel-1][0]; }
 	void getDriverInfo(uint8_t ch, char* outStr);
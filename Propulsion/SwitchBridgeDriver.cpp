@@ -34,11 +34,11 @@ int SwitchBridgeDriver::commandEmergencyStop(int status)
 	for(int j=0; j < 10; j++) {
 		int pindex = motorDrive[j][0];
 		if(pindex != 255) {
-			pdigitals[pindex]->digitalWrite(LOW);
+			pdigitals[pindex]->fastWrite(LOW);
 		}
 		pindex = motorDriveB[j][0];
 		if(pindex != 255) {
-				pdigitals[pindex]->digitalWrite(LOW);
+				pdigitals[pindex]->fastWrite(LOW);
 		}
 	}
 	fault_flag = 16;
@@ -61,8 +61,9 @@ void SwitchBridgeDriver::createDigital(uint8_t channel, uint8_t pin_numberA, uin
 		// Set up the digital direction pin
 			int foundPin = 0;
 			// Set up the digital enable pin, we want to be able to re-use these pins for multiple channels on 1 controller
+			Digital* dpin = NULL;
 			if( assignPin(enable_pin) ) {
-				Digital* dpin = new Digital(enable_pin);
+				dpin = new Digital(enable_pin);
 				dpin->pinMode(OUTPUT);
 				for(int i = 0; i < 10; i++) {
 					if(!pdigitals[i]) {
@@ -77,8 +78,8 @@ void SwitchBridgeDriver::createDigital(uint8_t channel, uint8_t pin_numberA, uin
 				}
 			} else { // cant assign, it may be already assigned
 				for(int i = 0; i < 10; i++) {
-					if(pdigitals[i]->pin == enable_pin) {
-						//dpin = pdigitals[i];
+					if(pdigitals[i] && pdigitals[i]->pin == enable_pin) {
+						dpin = pdigitals[i];
 						foundPin = 1;
 						break;
 					}
@@ -100,6 +101,7 @@ void SwitchBridgeDriver::createDigital(uint8_t channel, uint8_t pin_numberA, uin
 			
 			motorDrive[channel-1][0] = pindex;
 			motorDrive[channel-1][1] = enable_pin;
+			enablePin[channel-1] = dpin;
 			//
 			motorDriveB[channel-1][0] = pindex+1;
 			// determines which input pin PWM signal goes to, motorDrive[0] or motorDriveB[0], which is at pindex, or pindex+1 in ppwms
@@ -123,15 +125,10 @@ int SwitchBridgeDriver::commandMotorPower(uint8_t motorChannel, int16_t motorPow
 		return 0;
 	int foundPin = 0;
 	motorSpeed[motorChannel-1] = motorPower; //why? +/-
-	// set enable pin
-	for(int i = 0; i < 10; i++) {
-		if(pdigitals[i] && pdigitals[i]->pin == motorDrive[motorChannel-1][1]) {
-			//pdigitals[i]->setPin(motorDrive[motorChannel-1][1]);
-			pdigitals[i]->pinMode(OUTPUT);
-			pdigitals[i]->digitalWrite(HIGH);
-			foundPin = 1;
-			break;
-		}
+	// set enable pin resolved in createDigital
+	if( enablePin[motorChannel-1] ) {
+		enablePin[motorChannel-1]->fastWrite(HIGH);
+		foundPin = 1;
 	}
 	// get mapping of channel to pin
 	// see if we need to make a direction change, check array of [PWM pin][dir pin][dir]
@@ -160,8 +157,9 @@ int SwitchBridgeDriver::commandMotorPower(uint8_t motorChannel, int16_t motorPow
 		return commandEmergencyStop(6);
 	}
 	//
-	// Reset encoders on new speed setting
-	resetEncoders();
+	// Reset encoders on new speed setting, not on a ramp step
+	if( !rampCommand )
+		resetEncoders();
 	// If we have a linked distance sensor. check range and possibly skip
 	// If we are setting power 0, we are stopping anyway
 	if( !checkUltrasonicShutdown()) {
@@ -170,7 +168,7 @@ int SwitchBridgeDriver::commandMotorPower(uint8_t motorChannel, int16_t motorPow
 		// add the offset to the input pin, which will be 0 or 1 depending on above logic
 		pindex += motorDriveB[motorChannel-1][1];
 		// turn off all pins
-		pdigitals[pindex]->digitalWrite(LOW);
+		pdigitals[pindex]->fastWrite(LOW);
 	}
 	fault_flag = 0;
 	return 0;
@@ -56,6 +56,7 @@
 #include "Ultrasonic.h"
 #include "WAnalog.h"
 #include "WDigital.h"
+#include "IMU/IMUCalibration.h"
 
 #ifndef cbi
 #define cbi(sfr, bit) (_SFR_BYTE(sfr) &= ~_BV(bit))
@@ -80,9 +81,17 @@ void kill();
 void Stop();
 bool IsStopped();
 void refresh_cmd_timeout(void);
-void publishMotorFaultCode(int fault);
+void publishMotorFaultEvent(int slot, uint8_t fault, uint8_t prev, uint32_t now);
 void publishMotorStatCode(int stat);
 void publishBatteryVolts(int volts);
+struct RoboteqStatus;
+class StepperInterruptService;
+void publishControllerTelemetry(int slot, RoboteqStatus* stat);
+void publishStepperComplete(StepperInterruptService* service);
+class PitchRollHeading;
+void publishIMU(PitchRollHeading* prh, uint8_t quantities);
+void publishIMUCalibration(void);
+void startIMU(void);
 void printUltrasonic(Ultrasonic* upin, int index); // index -> ultrasonic array
 void printAnalog(Analog* apin, int index); // index -> analog array
 void printDigital(Digital* dpin, int target); //'target' represents the EXCLUDED value, other than this we get a reading
@@ -110,6 +119,7 @@ FORCE_INLINE void serialprintPGM(const char *str)
 extern int fanSpeed;
 extern unsigned long starttime;
 extern unsigned long stoptime;
+extern IMUCalibration imuCalibration;
 
 
 #endif
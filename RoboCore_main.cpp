@@ -53,6 +53,11 @@
 #include "AbstractPWMControl.h"
 #include "VariablePWMDriver.h"
 #include "AccelStepper.h"
+#include "StepperInterruptService.h"
+#include "IMU/PitchRollHeading.h"
+#include "WTime.h"
+#include "IsrProfile.h"
+#include "LoopProfile.h"
 
 // look here for descriptions of gcodes: http://linuxcnc.org/handbook/gcode/g-code.html, protocol here is different but similar
 // When 'stopped' is true the Gcodes G0-G5 are ignored as a safety interlock.
@@ -76,6 +81,8 @@ static char *strchr_pointer; // just a pointer to find chars in the cmd string l
 //Inactivity shutdown variables
 static unsigned long previous_millis_cmd = 0;
 static unsigned long max_inactive_time = 0;
+static uint32_t motor_ramp_time = 0; // millis of last acceleration ramp step
+static uint32_t current_sample_time = 0; // millis of last current limit sample
 
 unsigned long starttime = 0;
 unsigned long stoptime = 0;
@@ -89,11 +96,23 @@ Analog* apin;
 Digital* dpin;
 PWM* ppin;
 int nread = 0;
-uint32_t micros = 0;
+uint32_t micro_delay = 0;
 int* values;
 String motorCntrlResp;
 int status;
-int fault = 0;
+// Fault bits by controller slot, the last seen for edge detection and every bit seen since the last M17 report
+uint8_t faultState[10] = {0,0,0,0,0,0,0,0,0,0};
+uint8_t faultLatch[10] = {0,0,0,0,0,0,0,0,0,0};
+// Fault messages by bit of the controller fault flags
+const char faultMsg1[] PROGMEM = MSG_MOTORCONTROL_1;
+const char faultMsg2[] PROGMEM = MSG_MOTORCONTROL_2;
+const char faultMsg3[] PROGMEM = MSG_MOTORCONTROL_3;
+const char faultMsg4[] PROGMEM = MSG_MOTORCONTROL_4;
+const char faultMsg5[] PROGMEM = MSG_MOTORCONTROL_5;
+const char faultMsg6[] PROGMEM = MSG_MOTORCONTROL_6;
+const char faultMsg7[] PROGMEM = MSG_MOTORCONTROL_7;
+const char faultMsg8[] PROGMEM = MSG_MOTORCONTROL_8;
+PGM_P const motorFaultMsg[8] PROGMEM = { faultMsg1, faultMsg2, faultMsg3, faultMsg4, faultMsg5, faultMsg6, faultMsg7, faultMsg8 };
 // Dynamically defined ultrasonic rangers
 Ultrasonic* psonics[10]={0,0,0,0,0,0,0,0,0,0};
 // Last distance published per sensor
@@ -106,6 +125,8 @@ int digitalTarget[32];
 Digital* pdigitals[32]={0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
 // PWM control block
 PWM* ppwms[12]={0,0,0,0,0,0,0,0,0,0,0,0};
+// Hardware timers by number, for the allocation report
+HardwareTimer* timers[6]={&Timer0,&Timer1,&Timer2,&Timer3,&Timer4,&Timer5};
 
 uint8_t channel;
   
@@ -119,6 +140,8 @@ uint8_t dir_face;
 uint32_t dist;
 int timer_res = 8; // resolution in bits
 int timer_pre = 1; // 1 is no prescale
+uint32_t timer_freq = 0; // PWM frequency in Hz, 0 uses resolution and prescale
+uint8_t timer_phase = 0; // 1 phase correct PWM
 
 WatchdogTimer* watchdog_timer=NULL;
 
@@ -127,7 +150,23 @@ AbstractMotorControl* motorControl[10]={0,0,0,0,0,0,0,0,0,0};
 AbstractPWMControl* pwmControl[10]={0,0,0,0,0,0,0,0,0,0};
 	
 #define STEPS_PER_TURN 2048 // number of steps in 360deg;	
-AccelStepper* accelStepper;
+// Stepper slots and the interrupt that steps them
+AccelStepper* accelStepper[STEPPER_SLOTS]={0,0,0,0};
+StepperInterruptService* stepperService = NULL;
+int stepperSlot;
+long stepperMove[STEPPER_SLOTS];
+// IMU on the I2C bus, created by the first M20 or M21, the quantities it streams and its calibration
+PitchRollHeading* imu = NULL;
+IMUCalibration imuCalibration;
+uint8_t imuQuantities = IMU_ORIENTATION;
+uint16_t imuInterval = 0;
+uint32_t imuTime = 0;
+// interrupt profile for M707, compiled in with ISR_PROFILE and running once its timer is claimed
+uint8_t isrProfileReady = 0;
+// M709 dry run steppers, integer and float profile, whose step functions never step
+static void profileNoStep(void) {}
+static AccelStepper profileIntegerStepper(profileNoStep, profileNoStep);
+static AccelStepper profileFloatStepper(profileNoStep, profileNoStep);
 //===========================================================================
 //=============================ROUTINES=============================
 //===========================================================================
@@ -223,10 +262,14 @@ void setup()
   //setup_killpin();
   //setup_powerhold();
   sei();
+  timebase_init();
   SERIAL_PORT.begin(BAUDRATE);
   Serial2.begin(BAUDRATE);
   // loads data from EEPROM if available else uses defaults (and resets step acceleration rate)
   Config_RetrieveSettings();
+#ifdef ISR_PROFILE
+  isrProfileReady = (isrProfileInit() != TIMER_CLAIM_CONFLICT);
+#endif
   //Config_PrintSettings();
   //watchdog_init();
 }
@@ -236,12 +279,22 @@ void setup()
 */
 void loop()
 {
+#ifdef LOOP_PROFILE
+  uint32_t now = micros();
+  loopProfilePeriod(now);
+#endif
   get_command();
   if(!comment_mode)
   {
     process_commands();
   }
+#ifdef LOOP_PROFILE
+  now = micros();
+  manage_inactivity();
+  loopProfileInactivity(micros() - now);
+#else
   manage_inactivity();
+#endif
 }
   
 void get_command()
@@ -388,13 +441,22 @@ static inline type array(int axis)          \
 *-----------------------------------------
 */
 void process_commands() { 
+#ifdef LOOP_PROFILE
+  uint32_t start = micros();
+#endif
   if(code_seen('G')) {
 	  int cval = (int)code_value();
 	  processGCode(cval);
+#ifdef LOOP_PROFILE
+	  loopProfileCode('G', cval, micros() - start);
+#endif
   } else {
 	  if(code_seen('M') ) {
 		  int cval = (int)code_value();
 		  processMCode(cval);
+#ifdef LOOP_PROFILE
+		  loopProfileCode('M', cval, micros() - start);
+#endif
 	  } else { // if neither G nor M code
 		   int ibuf = 0;
 		   SERIAL_PGM(MSG_BEGIN);
@@ -444,8 +506,8 @@ void processGCode(int cval) {
 				motorChannel = code_value(); // channel 1,2
 				if(code_seen('P')) {
 					motorPower = code_value(); // motor power -1000,1000
-					fault = 0; // clear fault flag
-					if( (status=motorControl[motorController]->commandMotorPower(motorChannel, motorPower)) ) {
+					faultState[motorController] = 0; // a fault still present after the new command is published again
+					if( (status=motorControl[motorController]->commandMotorTarget(motorChannel, motorPower)) ) {
 							SERIAL_PGM(MSG_BEGIN);
 							SERIAL_PGM(MSG_BAD_MOTOR);
 							SERIAL_PORT.print(status);
@@ -464,7 +526,6 @@ void processGCode(int cval) {
 				} else {// code P or X
 					if(code_seen('X')) {
 						PWMLevel = code_value(); // PWM level -1000,1000, scaled to 0-2000 in PWM controller, as no reverse
-						fault = 0; // clear fault flag
 						// use motor related index and value, as we have them
 						if( (status=pwmControl[motorController]->commandPWMLevel(motorChannel, PWMLevel)) ) {
 							SERIAL_PGM(MSG_BEGIN);
@@ -488,6 +549,72 @@ void processGCode(int cval) {
 	     } // stopped
 	     break;
 	  
+	case 6: // G6 - Synchronized command all channels [Z<controller>] P<channel 1 power> [P<channel 2 power>...] [Z<controller> P<channel 1 power>...]
+		// Each P is the power -1000 to 1000 for the next channel of the current controller, starting at 1, Z selects controller and restarts at channel 1.
+		// All PWM driven channels are applied in one critical section, smart controllers need interrupts for UART and follow immediately.
+		// A channel with an accel or decel rate only takes its target here, the ramps it starts advance together in updateMotorRamp.
+		if(!Stopped) {
+			static int16_t syncPower[10][10]; // kept off the stack, 200 bytes
+			uint8_t syncChannels[10] = {0,0,0,0,0,0,0,0,0,0};
+			motorController = 0;
+			result = 0;
+			// skip past the G6 itself, then walk the Z and P words in order
+			starpos = strchr_pointer + 1;
+			while( *starpos >= '0' && *starpos <= '9' ) ++starpos;
+			while( *starpos ) {
+				if( *starpos == 'Z' ) {
+					motorController = strtol(starpos+1, &starpos, 10);
+					if( motorController < 0 || motorController > 9 || !motorControl[motorController] ) {
+						result = -1;
+						break;
+					}
+					continue;
+				}
+				if( *starpos == 'P' ) {
+					motorPower = strtol(starpos+1, &starpos, 10);
+					if( !motorControl[motorController] || syncChannels[motorController] >= motorControl[motorController]->getChannels() ) {
+						result = -1;
+						break;
+					}
+					syncPower[motorController][syncChannels[motorController]++] = motorPower;
+					continue;
+				}
+				++starpos;
+			}
+			if( !result ) {
+				memset(faultState, 0, sizeof(faultState)); // faults still present after the new command are published again
+				CRITICAL_SECTION_START
+				for(int j = 0; j < 10; j++) {
+					if( syncChannels[j] && !motorControl[j]->isSmartController() ) {
+						if( (status=motorControl[j]->commandMotorTargets(syncChannels[j], syncPower[j])) && !result )
+							result = status;
+					}
+				}
+				CRITICAL_SECTION_END
+				for(int j = 0; j < 10; j++) {
+					if( syncChannels[j] && motorControl[j]->isSmartController() ) {
+						if( (status=motorControl[j]->commandMotorTargets(syncChannels[j], syncPower[j])) && !result )
+							result = status;
+					}
+				}
+			}
+			if( result ) {
+				SERIAL_PGM(MSG_BEGIN);
+				SERIAL_PGM(MSG_BAD_MOTOR);
+				SERIAL_PORT.print(result);
+				SERIAL_PORT.print(' ');
+				SERIAL_PORT.print(motorController);
+				SERIAL_PGMLN(MSG_TERMINATE);
+				SERIAL_PORT.flush();
+			} else {
+				SERIAL_PGM(MSG_BEGIN);
+				SERIAL_PGM("G6");
+				SERIAL_PGMLN(MSG_TERMINATE);
+				SERIAL_PORT.flush();
+			}
+		} // stopped
+		break;
+		
 	case 99: // G99 start watchdog timer. G99 T<time_in_millis> values are 15,30,60,120,250,500,1000,4000,8000 default 4000
 		if( code_seen('T') ) {
 			int time_val = code_value();
@@ -510,7 +637,37 @@ void processGCode(int cval) {
 		SERIAL_PORT.flush();
 		break;
 	
-	case 200: // G200 set up stepper. G200 W<wires else default 4> P<pin 1 default 22> Q<pin 2 default 24> R<pin 3 default 26> S<pin 4 defualt 28> F<pulse width default 20> M<motor speed default 500> A<motor accel def 400>
+	// Steppers occupy slots 0 to STEPPER_SLOTS-1, set up with G200 and moved together by one background step interrupt on STEPPER_TIMER.
+	// G202/G203/G204 start a move and answer at once, the end of the move is published as a stepper frame with the position
+	// of each slot from manage_inactivity once the planner runs dry. A new move is queued behind the one in progress and blends into it,
+	// up to BLOCK_BUFFER_SIZE-1 moves, after which it is refused with MSG_STEPPER_FULL until one completes.
+	case 200: // G200 [Z<slot>] set up stepper. G200 W<wires else default 4> P<pin 1 default 22> Q<pin 2 default 24> R<pin 3 default 26> S<pin 4 defualt 28> F<pulse width default 20, run() only, the step interrupt holds STEPPER_PULSE_WIDTH> M<motor speed default 500> A<motor accel def 400>
+		stepperSlot = 0;
+		if(code_seen('Z')) {
+			stepperSlot = code_value();
+		}
+		if( stepperSlot < 0 || stepperSlot >= STEPPER_SLOTS )
+			break;
+		if( !stepperService ) {
+			// steps are taken in the background by the compare interrupt of STEPPER_TIMER
+			stepperService = new StepperInterruptService(&STEPPER_TIMER);
+			if( stepperService->init() == TIMER_CLAIM_CONFLICT ) {
+				delete stepperService;
+				stepperService = NULL;
+				SERIAL_PGM(MSG_BEGIN);
+				SERIAL_PGM(MSG_STEPPER_TIMER);
+				SERIAL_PGMLN(MSG_TERMINATE);
+				SERIAL_PORT.flush();
+				break;
+			}
+			stepperService->setSteppers((AccelStepper**)&accelStepper);
+		}
+		// replacing a stepper, stop everything dead first as the interrupt may be stepping it
+		if( accelStepper[stepperSlot] ) {
+			stepperService->halt();
+			delete accelStepper[stepperSlot];
+			accelStepper[stepperSlot] = NULL;
+		}
 		int swire;
 		swire = code_seen('W') ? code_value() : 4;
 		int p1,q2,r3,s4;
@@ -518,31 +675,26 @@ void processGCode(int cval) {
 		q2 = code_seen('Q') ? code_value() : 24;
 		r3 = code_seen('R') ? code_value() : 26;
 		s4 = code_seen('S') ? code_value() : 28;
-		accelStepper = new AccelStepper(swire,p1,q2,r3,s4,true);
 		int pulseWidth;
 		int motorSpeed;
 		int motorAccel;
 		pulseWidth = code_seen('F') ? code_value() : 20;
 		motorSpeed = code_seen('M') ? code_value() : 500;
 		motorAccel = code_seen('A') ? code_value() : 400;
-		accelStepper->setMinPulseWidth(pulseWidth); // 20 prevents pulses too quick to be decoded
-		accelStepper->setMaxSpeed(motorSpeed);
-		accelStepper->setSpeed(motorSpeed);
-		accelStepper->setAcceleration(motorAccel);
-		// the following two lines reset "step zero" to the current position
-		accelStepper->setCurrentPosition(accelStepper->currentPosition());
-		accelStepper->runToPosition();
+		accelStepper[stepperSlot] = new AccelStepper(swire,p1,q2,r3,s4,true);
+		accelStepper[stepperSlot]->setMinPulseWidth(pulseWidth); // 20 prevents pulses too quick to be decoded
+		accelStepper[stepperSlot]->setMaxSpeed(motorSpeed);
+		accelStepper[stepperSlot]->setSpeed(motorSpeed);
+		accelStepper[stepperSlot]->setAcceleration(motorAccel);
 		SERIAL_PGM(MSG_BEGIN);
 		SERIAL_PGM("G200");
 		SERIAL_PGMLN(MSG_TERMINATE);
 		SERIAL_PORT.flush();
 		break;
 		
-	case 201: // G201 stepper stop
-		if(accelStepper) {
-			accelStepper->stop();
-			accelStepper->runToPosition();
-			accelStepper->run();
+	case 201: // G201 stepper stop, all slots decelerate and stop together, queued moves are dropped and the move in progress then completes early
+		if(stepperService) {
+			stepperService->stop();
 			SERIAL_PGM(MSG_BEGIN);
 			SERIAL_PGM("G201");
 			SERIAL_PGMLN(MSG_TERMINATE);
@@ -550,47 +702,75 @@ void processGCode(int cval) {
 		}
 		break;
 	
-	case 202: // G202 S<steps>  clockwise
-		int steps;
-		if(accelStepper) {
-			if(code_seen('S'))
-				steps = code_value();
-	        // The two lines that follow allow to send commands in any sequence:
-	        // before execution, a quick stop is performed
-	        //accelStepper->stop(); // Stop as fast as possible: sets new target
-	        //accelStepper->runToPosition(); // Now stopped after quickstop
-	        accelStepper->setCurrentPosition(accelStepper->currentPosition()); // Set step 0 "here"
-	        accelStepper->setSpeed(motorSpeed); // Previous commands have reset the speed
-	        // Since we step forward 2047 steps, current position is starting point of the rotation
-			accelStepper->moveTo(accelStepper->currentPosition()+steps); // 1 turn = 2048 step
-			while (accelStepper->currentPosition() != accelStepper->targetPosition()) {
-				accelStepper->runSpeedToPosition();
-			}
-			//accelStepper->run();
+	// Moves are queued behind any in progress and blend into one another, completion is published when the queue runs dry
+	case 202: // G202 [Z<slot>] S<steps>  clockwise
+	case 203: // G203 [Z<slot>] S<steps>  anti-clockwise
+		if(stepperService) {
+			stepperSlot = 0;
+			if(code_seen('Z')) {
+				stepperSlot = code_value();
+			}
+			if( stepperSlot < 0 || stepperSlot >= STEPPER_SLOTS )
+				break;
+			for(int i = 0; i < STEPPER_SLOTS; i++)
+				stepperMove[i] = 0;
+			stepperMove[stepperSlot] = code_seen('S') ? code_value_long() : 0;
+			if( cval == 203 )
+				stepperMove[stepperSlot] = -stepperMove[stepperSlot];
+			status = stepperService->queueMove(stepperMove);
+			if( status != STEPPER_QUEUED ) {
+				SERIAL_PGM(MSG_BEGIN);
+				if( status == STEPPER_FULL ) {
+					SERIAL_PGM(MSG_STEPPER_FULL);
+				} else {
+					SERIAL_PGM(MSG_BAD_STEPPER);
+					SERIAL_PORT.print(stepperSlot);
+				}
+				SERIAL_PGMLN(MSG_TERMINATE);
+				SERIAL_PORT.flush();
+				break;
+			}
 			SERIAL_PGM(MSG_BEGIN);
-			SERIAL_PGM("G202");
+			SERIAL_PGM(cval == 203 ? "G203" : "G202");
 			SERIAL_PGMLN(MSG_TERMINATE);
 			SERIAL_PORT.flush();
 		}
 		break;
-		
-	case 203: // G203 S<steps>  anti-clockwise
-		if(accelStepper) {
-			if(code_seen('S'))
-				steps = code_value();
-			accelStepper->setCurrentPosition(accelStepper->currentPosition()); // Set step 0 "here"
-			accelStepper->setSpeed(-motorSpeed); // Previous commands have reset the speed
-			// Since we step backward 2047 steps, current position is starting point of the rotation
-			accelStepper->moveTo(accelStepper->currentPosition()-steps); // 1 turn = 2048 step
-			while (accelStepper->currentPosition() != accelStepper->targetPosition()) {
-					accelStepper->runSpeedToPosition();
+	
+	// Coordinated move, the slots start and finish together along a straight line, + clockwise, - anticlockwise.
+	// F and A are the rate and acceleration of the slot with the most steps, by default its own, and are brought down
+	// as needed so no slot exceeds the max speed and acceleration set for it in G200.
+	case 204: // G204 [P<slot 0 steps>] [Q<slot 1 steps>] [R<slot 2 steps>] [S<slot 3 steps>] [F<steps/s>] [A<steps/s/s>]
+		if(stepperService) {
+			stepperMove[0] = code_seen('P') ? code_value_long() : 0;
+			stepperMove[1] = code_seen('Q') ? code_value_long() : 0;
+			stepperMove[2] = code_seen('R') ? code_value_long() : 0;
+			stepperMove[3] = code_seen('S') ? code_value_long() : 0;
+			uint16_t rate, accel;
+			rate = code_seen('F') ? code_value() : 0;
+			accel = code_seen('A') ? code_value() : 0;
+			status = stepperService->queueMove(stepperMove, rate, accel);
+			if( status != STEPPER_QUEUED ) {
+				SERIAL_PGM(MSG_BEGIN);
+				if( status == STEPPER_FULL ) {
+					SERIAL_PGM(MSG_STEPPER_FULL);
+				} else {
+					SERIAL_PGM(MSG_BAD_STEPPER);
+					for(stepperSlot = 0; stepperSlot < STEPPER_SLOTS-1; stepperSlot++)
+						if( stepperMove[stepperSlot] && !accelStepper[stepperSlot] )
+							break;
+					SERIAL_PORT.print(stepperSlot);
+				}
+				SERIAL_PGMLN(MSG_TERMINATE);
+				SERIAL_PORT.flush();
+				break;
 			}
 			SERIAL_PGM(MSG_BEGIN);
-			SERIAL_PGM("G203");
+			SERIAL_PGM("G204");
 			SERIAL_PGMLN(MSG_TERMINATE);
 			SERIAL_PORT.flush();
 		}
-		break;	
+		break;
 		
 	default:
 		int ibuf = 0;
@@ -661,6 +841,8 @@ void processGCode(int cval) {
 	// these 2 parameters you can tune any controller/motor setup properly for forward/back.
 	// Finally, W<encoder pin>  to receive hall wheel sensor signals and
 	// optionally PWM timer setup [R<resolution 8,9,10 bits>] [X<prescale 0-7>].
+	// Or an exact carrier frequency [F<frequency Hz>], which replaces R and X on the 16 bit timers (pins 2,3,5,6,7,8,11,12,44,45,46),
+	// with the duty taken at the full 0-1000 command resolution, and [H1] for phase correct instead of fast PWM.
 	// The Timer mode (0-3) is preset to 2 in the individual driver. Page 129 in datasheet. Technically we are using a 'non PWM'
 	// where the 'compare output mode' is defined by 3 operating modes. Since we are unifying all the timers to use all available PWM
 	// pins, the common mode among them all is the 'non PWM', within which the 3 available operating modes can be chosen from.
@@ -670,9 +852,11 @@ void processGCode(int cval) {
 	// 2 - Clear on match
 	// 3 - Set on match
 	// For motor operation and general purpose PWM, mode 2 the most universally applicable.
-	case 3: // M3 [Z<slot>] P<pin> C<channel> D<direction pin> E<default dir> W<encoder pin> [R<resolution 8,9,10 bits>] [X<prescale 0-7>]
+	case 3: // M3 [Z<slot>] P<pin> C<channel> D<direction pin> E<default dir> W<encoder pin> [R<resolution 8,9,10 bits>] [X<prescale 0-7>] [F<frequency Hz>] [H<1 phase correct>]
 		timer_res = 8; // resolution in bits
 		timer_pre = 1; // 1 is no prescale
+		timer_freq = 0; // 0 uses resolution and prescale
+		timer_phase = 0;
 		pin_number = -1;
 		encode_pin = 0;
 		if(code_seen('Z')) {
@@ -711,7 +895,22 @@ void processGCode(int cval) {
 		if( code_seen('R')) {
 			timer_res = code_value();
 		}
-		((HBridgeDriver*)motorControl[motorController])->createPWM(channel, pin_number, dir_pin, dir_default, timer_pre, timer_res);
+		if( code_seen('F')) {
+			timer_freq = code_value_long();
+		}
+		if( code_seen('H')) {
+			timer_phase = code_value();
+		}
+		// a pin whose timer already runs another configuration for someone else is rejected, see M704
+		status = ((HBridgeDriver*)motorControl[motorController])->createPWM(channel, pin_number, dir_pin, dir_default, timer_pre, timer_res, timer_freq, timer_phase);
+		if( status == TIMER_CLAIM_CONFLICT ) {
+			SERIAL_PGM(MSG_BEGIN);
+			SERIAL_PGM(MSG_TIMER_CONFLICT);
+			SERIAL_PORT.print(pin_number);
+			SERIAL_PGMLN(MSG_TERMINATE);
+			SERIAL_PORT.flush();
+			break;
+		}
 		if(encode_pin) {
 			motorControl[motorController]->createEncoder(channel, encode_pin);
 		}
@@ -726,10 +925,14 @@ void processGCode(int cval) {
 	// Split bridge or 2 half bridge motor controller. Takes 2 inputs: one for forward,called P, one for backward,called Q, then motor channel, 
 	// and then D, an enable pin. Finally, W<encoder pin>  to receive hall wheel sensor signals and 
 	// optionally PWM timer setup [R<resolution 8,9,10 bits>] [X<prescale 0-7>].
+	// Or an exact carrier frequency [F<frequency Hz>], which replaces R and X on the 16 bit timers (pins 2,3,5,6,7,8,11,12,44,45,46),
+	// with the duty taken at the full 0-1000 command resolution, and [H1] for phase correct instead of fast PWM.
 	// Everything derived from HBridgeDriver can be done here.
-	case 4:// M4 [Z<slot>] P<pin> Q<pin> C<channel> D<enable pin> E<default dir> [W<encoder pin>] [R<resolution 8,9,10 bits>] [X<prescale 0-7>]
+	case 4:// M4 [Z<slot>] P<pin> Q<pin> C<channel> D<enable pin> E<default dir> [W<encoder pin>] [R<resolution 8,9,10 bits>] [X<prescale 0-7>] [F<frequency Hz>] [H<1 phase correct>]
 	  timer_res = 8; // resolution in bits
 	  timer_pre = 1; // 1 is no prescale
+	  timer_freq = 0; // 0 uses resolution and prescale
+	  timer_phase = 0;
 	  pin_number = -1;
 	  pin_numberB = -1;
 	  encode_pin = 0;
@@ -774,7 +977,21 @@ void processGCode(int cval) {
 		  if( code_seen('R')) {
 				timer_res = code_value();
 		  }
-		  ((SplitBridgeDriver*)motorControl[motorController])->createPWM(channel, pin_number, pin_numberB, dir_pin, dir_default, timer_pre, timer_res);
+		  if( code_seen('F')) {
+				timer_freq = code_value_long();
+		  }
+		  if( code_seen('H')) {
+				timer_phase = code_value();
+		  }
+		  status = ((SplitBridgeDriver*)motorControl[motorController])->createPWM(channel, pin_number, pin_numberB, dir_pin, dir_default, timer_pre, timer_res, timer_freq, timer_phase);
+		  if( status == TIMER_CLAIM_CONFLICT ) {
+		  	SERIAL_PGM(MSG_BEGIN);
+		  	SERIAL_PGM(MSG_TIMER_CONFLICT);
+		  	SERIAL_PORT.print(pin_number);
+		  	SERIAL_PGMLN(MSG_TERMINATE);
+		  	SERIAL_PORT.flush();
+		  	break;
+		  }
 		  if(encode_pin) {
 			motorControl[motorController]->createEncoder(channel, encode_pin);
 		  }
@@ -943,6 +1160,7 @@ void processGCode(int cval) {
 			if( code_seen('R')) {
 				timer_res = code_value();
 			}
+			// on a timer already in use the channel runs at the configuration in place instead of R and X, see M704
 			((VariablePWMDriver*)pwmControl[PWMDriver])->createPWM(channel, pin_number, enable_pin, timer_pre, timer_res);
 			SERIAL_PGM(MSG_BEGIN);
 			SERIAL_PGM("M9");
@@ -1187,6 +1405,134 @@ void processGCode(int cval) {
 		}
 	  break;
 	  
+	case 14: // M14 [Z<slot>] C<channel> [A<accel>] [D<decel>] - Set acceleration and deceleration slew rate in power units per second for channel, 0 for no limit
+		if(code_seen('Z')) {
+			motorController = code_value();
+		}
+		if( code_seen('C') ) {
+			channel = code_value();
+			if(channel <= 0) {
+				break;
+			}
+			if(motorControl[motorController]) {
+				if(code_seen('A'))
+					motorControl[motorController]->setMotorAccel(channel, code_value());
+				if(code_seen('D'))
+					motorControl[motorController]->setMotorDecel(channel, code_value());
+				SERIAL_PGM(MSG_BEGIN);
+				SERIAL_PGM("M14");
+				SERIAL_PGMLN(MSG_TERMINATE);
+				SERIAL_PORT.flush();
+			}
+		}
+		break;
+		
+	case 15: // M15 [Z<slot>] S<interval> - Stream smart controller telemetry every interval ms as one frame per interval, S0 to stop
+		if(code_seen('Z')) {
+			motorController = code_value();
+		}
+		if( code_seen('S') ) {
+			if( motorControl[motorController] && motorControl[motorController]->isSmartController() ) {
+				if( (status = ((RoboteqDevice*)motorControl[motorController])->startTelemetry(code_value())) ) {
+					SERIAL_PGM(MSG_BEGIN);
+					SERIAL_PGM(MSG_BAD_MOTOR);
+					SERIAL_PORT.print(status);
+					SERIAL_PORT.print(' ');
+					SERIAL_PORT.print(motorController);
+					SERIAL_PGMLN(MSG_TERMINATE);
+				} else {
+					SERIAL_PGM(MSG_BEGIN);
+					SERIAL_PGM("M15");
+					SERIAL_PGMLN(MSG_TERMINATE);
+				}
+				SERIAL_PORT.flush();
+			}
+		}
+		break;
+		
+	case 16: // M16 [Z<slot>] [C<channel>] [P<analog pin>] [O<zero offset>] [S<milliamps per count>] [L<limit>] [T<total limit>] - Current sense and limit, amps * 10, 0 for no limit
+		if(code_seen('Z')) {
+			motorController = code_value();
+		}
+		if( !motorControl[motorController] )
+			break;
+		if( code_seen('C') ) {
+			channel = code_value();
+			if(channel <= 0) {
+				break;
+			}
+			if( code_seen('P') ) {
+				pin_number = code_value();
+				int offset = code_seen('O') ? code_value() : 0;
+				uint16_t scale = code_seen('S') ? code_value() : 1;
+				motorControl[motorController]->createCurrentSense(channel, pin_number, offset, scale);
+			}
+			if( code_seen('L') )
+				motorControl[motorController]->setCurrentLimit(channel, code_value());
+		}
+		if( code_seen('T') )
+			motorControl[motorController]->setTotalCurrentLimit(code_value());
+		SERIAL_PGM(MSG_BEGIN);
+		SERIAL_PGM("M16");
+		SERIAL_PGMLN(MSG_TERMINATE);
+		SERIAL_PORT.flush();
+		break;
+		
+	case 17: // M17 [Z<slot>] - Report every fault latched on the controller since the last M17 and clear the latch
+		if(code_seen('Z')) {
+			motorController = code_value();
+		}
+		publishMotorFaultEvent(motorController, faultLatch[motorController], 0, millis());
+		faultLatch[motorController] = faultState[motorController];
+		SERIAL_PORT.flush();
+		break;
+		
+	case 20: // M20 S<interval> [Q<quantities>] [L<sea level hPa>] - Stream the IMU every interval ms as one frame per interval, S0 to stop
+	// Q is the sum of 1 orientation, 2 accel, 4 gyro, 8 mag, 16 altitude/temperature/pressure, default 1
+		if( code_seen('S') ) {
+			startIMU();
+			imuInterval = code_value();
+			if( code_seen('Q') )
+				imuQuantities = code_value();
+			if( code_seen('L') )
+				imu->seaLevelPressure = code_value();
+			if( (imuQuantities & IMU_BARO) && !imu->startBarometer() ) {
+				SERIAL_PGM(MSG_BEGIN);
+				SERIAL_PGM(MSG_NO_BAROMETER);
+				SERIAL_PGMLN(MSG_TERMINATE);
+				SERIAL_PORT.flush();
+				imuQuantities &= ~IMU_BARO;
+			}
+			imuTime = millis();
+			SERIAL_PGM(MSG_BEGIN);
+			SERIAL_PGM("M20");
+			SERIAL_PGMLN(MSG_TERMINATE);
+			SERIAL_PORT.flush();
+		}
+		break;
+		
+	case 21: // M21 [S<mode>] - IMU calibration, S1 collects the mag while the robot is turned through every heading and tilt,
+	// S2 collects the gyro at rest, S0 computes and applies the coefficients, M500 stores them. Reports the coefficients unless starting
+		startIMU();
+		if( code_seen('S') && code_value() ) {
+			imu->startCalibration(code_value());
+			SERIAL_PGM(MSG_BEGIN);
+			SERIAL_PGM("M21");
+			SERIAL_PGMLN(MSG_TERMINATE);
+			SERIAL_PORT.flush();
+			break;
+		}
+		if( code_seen('S') && !imu->finishCalibration() ) {
+			SERIAL_PGM(MSG_BEGIN);
+			SERIAL_PGM(MSG_IMU_CALIBRATION);
+			SERIAL_PGMLN(MSG_TERMINATE);
+			SERIAL_PORT.flush();
+			break;
+		}
+		publishIMUCalibration();
+		SERIAL_PORT.flush();
+		break;
+		
 	case 33: // M33 [Z<slot>] P<ultrasonic pin> D<min. distance in cm> [E<direction 1- forward facing, 0 - reverse facing sensor>] 
 	// link Motor controller to ultrasonic sensor, the sensor must exist via M301
 		if(code_seen('Z')) {
@@ -1460,6 +1806,8 @@ void processGCode(int cval) {
 				if(ppwms[i] == NULL) {
 					ppin = new PWM(pin_number);
 					ppin->init(pin_number);
+					// on a timer already in use the pin shares the configuration in place and R and X are ignored, see M704
+					ppin->claimTimer(TIMER_OWNER_PWM, timer_pre, timer_res, 0, 0, 1);
 					ppin->setPWMPrescale(timer_pre);
 					ppin->setPWMResolution(timer_res);
 					ppin->pwmWrite(pin_status,timer_mode); // default is 2, clear on match. to turn off, use 0
@@ -1926,7 +2274,7 @@ void processGCode(int cval) {
 		SERIAL_PORT.flush();
 		break;
 		
-	case 704: // Report PWM pins in use
+	case 704: // Report PWM pins in use and the owners and configuration of each timer
 		SERIAL_PGM(MSG_BEGIN);
 		SERIAL_PGM(pwmPinSettingHdr);
 		SERIAL_PGMLN(MSG_DELIMIT);
@@ -1950,9 +2298,28 @@ void processGCode(int cval) {
 						SERIAL_PGM(" ERROR - UNKNOWN");
 						break;
 				}
+				if( ppwms[i]->negotiated )
+					SERIAL_PGM(" SHARED");
 				SERIAL_PORT.println();
 			}
 		}
+		// timer allocation, owner of channels A,B,C and of the timer itself, and the configuration they run
+		for(int i = 0; i < 6; i++) {
+			HardwareTimer* tmr = timers[i];
+			SERIAL_PGM("Timer:");
+			SERIAL_PORT.print(i);
+			SERIAL_PGM(" Owners:");
+			for(int j = 0; j < 4; j++) {
+				SERIAL_PORT.print(' ');
+				SERIAL_PORT.print(tmr->getOwner(j));
+			}
+			SERIAL_PGM(" Mode:");
+			SERIAL_PORT.print(tmr->getClaimMode());
+			SERIAL_PGM(" Prescale:");
+			SERIAL_PORT.print(tmr->getClaimClock());
+			SERIAL_PGM(" Frequency:");
+			SERIAL_PORT.println(tmr->getClaimFrequency());
+		}
 		SERIAL_PGM(MSG_BEGIN);
 		SERIAL_PGM(pwmPinSettingHdr);
 		SERIAL_PGMLN(MSG_TERMINATE);
@@ -1978,7 +2345,7 @@ void processGCode(int cval) {
 						SERIAL_PORT.println(motorControl[j]->getDefaultDirection(i+1));
 						SERIAL_PGM(" Encoder Pin:");
 						if(motorControl[j]->getWheelEncoder(i+1)) {
-							SERIAL_PORT.print(motorControl[j]->getWheelEncoder(i+1)->pin);
+							SERIAL_PORT.print(motorControl[j]->getEncoderPin(i+1));
 							SERIAL_PGM(" Count:");
 							SERIAL_PORT.print(motorControl[j]->getEncoderCount(i+1));
 							SERIAL_PGM(" Duration:");
@@ -2049,6 +2416,187 @@ void processGCode(int cval) {
 		SERIAL_PORT.flush();
 		break;
 		
+	case 707: // M707 [R] - Report the runs, mean and longest cycles of each interrupt vector that ran, by vector number, and the largest entry latency in timer ticks of the timer compare vectors, R resets them
+		if( !isrProfileReady ) {
+			SERIAL_PGM(MSG_BEGIN);
+			SERIAL_PGM(MSG_NO_ISR_PROFILE);
+			SERIAL_PGMLN(MSG_TERMINATE);
+			SERIAL_PORT.flush();
+			break;
+		}
+#ifdef ISR_PROFILE
+		SERIAL_PGM(MSG_BEGIN);
+		SERIAL_PGM(isrProfileHdr);
+		SERIAL_PGMLN(MSG_DELIMIT);
+		for(int i = 1; i < ISR_PROFILE_VECTORS; i++) {
+			IsrProfile prof;
+			isrProfileGet(i, &prof);
+			if( prof.count ) {
+				SERIAL_PGM("Vector:");
+				SERIAL_PORT.print(i);
+				SERIAL_PGM(" Count:");
+				SERIAL_PORT.print(prof.count);
+				SERIAL_PGM(" Mean:");
+				SERIAL_PORT.print(prof.cycles / prof.count);
+				SERIAL_PGM(" Max:");
+				SERIAL_PORT.print(prof.maxCycles);
+				if( prof.maxLate != ISR_PROFILE_NO_LATE ) {
+					SERIAL_PGM(" Late:");
+					SERIAL_PORT.print(prof.maxLate);
+				}
+				SERIAL_PORT.println();
+			}
+		}
+		SERIAL_PGM(MSG_BEGIN);
+		SERIAL_PGM(isrProfileHdr);
+		SERIAL_PGMLN(MSG_TERMINATE);
+		SERIAL_PORT.flush();
+		if( code_seen('R') )
+			isrProfileReset();
+#endif
+		break;
+		
+	case 708: // M708 [R] - Report the loop period histogram, the time of manage_inactivity and of each G and M code run, and the serial byte counts, R resets them
+		SERIAL_PGM(MSG_BEGIN);
+		SERIAL_PGM(loopProfileHdr);
+		SERIAL_PGMLN(MSG_DELIMIT);
+#ifdef LOOP_PROFILE
+		SERIAL_PGM("Loops:");
+		SERIAL_PORT.print(loopProfile.loops);
+		SERIAL_PGM(" Max period:");
+		SERIAL_PORT.println(loopProfile.maxPeriod);
+		for(int i = 0; i < LOOP_PROFILE_BUCKETS; i++) {
+			if( i < LOOP_PROFILE_BUCKETS - 1 ) {
+				SERIAL_PGM("Period under:");
+				SERIAL_PORT.print((1UL << LOOP_PROFILE_BUCKET_SHIFT) << i);
+			} else {
+				SERIAL_PGM("Period over:");
+				SERIAL_PORT.print((1UL << LOOP_PROFILE_BUCKET_SHIFT) << (i - 1));
+			}
+			SERIAL_PGM(" Count:");
+			SERIAL_PORT.println(loopProfile.periods[i]);
+		}
+		SERIAL_PGM("Inactivity Count:");
+		SERIAL_PORT.print(loopProfile.inactivityCount);
+		SERIAL_PGM(" Mean:");
+		SERIAL_PORT.print(loopProfile.inactivityCount ? loopProfile.inactivityMicros / loopProfile.inactivityCount : 0);
+		SERIAL_PGM(" Max:");
+		SERIAL_PORT.println(loopProfile.inactivityMax);
+		for(int i = 0; i < LOOP_PROFILE_CODES && loopProfile.codes[i].letter; i++) {
+			CodeProfile* prof = &loopProfile.codes[i];
+			SERIAL_PGM("Code:");
+			SERIAL_PORT.print(prof->letter);
+			SERIAL_PORT.print(prof->code);
+			SERIAL_PGM(" Count:");
+			SERIAL_PORT.print(prof->count);
+			SERIAL_PGM(" Min:");
+			SERIAL_PORT.print(prof->minMicros);
+			SERIAL_PGM(" Mean:");
+			SERIAL_PORT.print(prof->micros / prof->count);
+			SERIAL_PGM(" Max:");
+			SERIAL_PORT.println(prof->maxMicros);
+		}
+		SERIAL_PGM("Untracked codes:");
+		SERIAL_PORT.println(loopProfile.untracked);
+#endif
+		SERIAL_PGM("Serial RX:");
+		SERIAL_PORT.print(SERIAL_PORT.getRxCount());
+		SERIAL_PGM(" Dropped:");
+		SERIAL_PORT.print(SERIAL_PORT.getRxDropped());
+		SERIAL_PGM(" TX:");
+		SERIAL_PORT.println(SERIAL_PORT.getTxCount());
+		SERIAL_PGM("Serial2 RX:");
+		SERIAL_PORT.print(Serial2.getRxCount());
+		SERIAL_PGM(" Dropped:");
+		SERIAL_PORT.print(Serial2.getRxDropped());
+		SERIAL_PGM(" TX:");
+		SERIAL_PORT.println(Serial2.getTxCount());
+		SERIAL_PGM(MSG_BEGIN);
+		SERIAL_PGM(loopProfileHdr);
+		SERIAL_PGMLN(MSG_TERMINATE);
+		SERIAL_PORT.flush();
+		if( code_seen('R') ) {
+#ifdef LOOP_PROFILE
+			loopProfileReset();
+#endif
+			SERIAL_PORT.resetCounts();
+			Serial2.resetCounts();
+		}
+		break;
+		
+	case 709: // M709 Z<slot> [S<steps default 1000>] - Dry run a move of the stepper in the slot with the integer and the float acceleration
+		// profile, report the steps, the microseconds of computation per step and the move time each plans, and the largest difference
+		// in step interval between them. Interrupts run throughout, so the computation times include them.
+		stepperSlot = code_seen('Z') ? code_value() : 0;
+		if( stepperSlot < 0 || stepperSlot >= STEPPER_SLOTS || !accelStepper[stepperSlot] ) {
+			SERIAL_PGM(MSG_BEGIN);
+			SERIAL_PGM(MSG_BAD_STEPPER);
+			SERIAL_PORT.print(stepperSlot);
+			SERIAL_PGMLN(MSG_TERMINATE);
+			SERIAL_PORT.flush();
+			break;
+		}
+		{
+			long profileSteps = code_seen('S') ? code_value_long() : 1000;
+			AccelStepper* profile[2] = {&profileIntegerStepper, &profileFloatStepper};
+			uint32_t steps[2], computeMicros[2], moveMicros[2];
+			unsigned long interval[2];
+			for(int k = 0; k < 2; k++) {
+				profile[k]->setMaxSpeed(accelStepper[stepperSlot]->maxSpeed());
+				profile[k]->setAcceleration(accelStepper[stepperSlot]->acceleration());
+			}
+			// k 0 integer, 1 float, each timed on its own
+			for(int k = 0; k < 2; k++) {
+				steps[k] = 0;
+				moveMicros[k] = 0;
+				uint32_t start = micros();
+				interval[k] = profile[k]->profileMove(profileSteps, k == 0);
+				while( interval[k] ) {
+					moveMicros[k] += interval[k];
+					++steps[k];
+					interval[k] = profile[k]->profileStep(k == 0);
+				}
+				computeMicros[k] = micros() - start;
+			}
+			// then side by side for the interval difference
+			uint32_t maxDiff = 0, maxDiffStep = 0, step = 0;
+			interval[0] = profile[0]->profileMove(profileSteps, true);
+			interval[1] = profile[1]->profileMove(profileSteps, false);
+			while( interval[0] && interval[1] ) {
+				uint32_t diff = interval[0] > interval[1] ? interval[0] - interval[1] : interval[1] - interval[0];
+				if( diff > maxDiff ) {
+					maxDiff = diff;
+					maxDiffStep = step;
+				}
+				++step;
+				interval[0] = profile[0]->profileStep(true);
+				interval[1] = profile[1]->profileStep(false);
+			}
+			SERIAL_PGM(MSG_BEGIN);
+			SERIAL_PGM(stepperProfileHdr);
+			SERIAL_PGMLN(MSG_DELIMIT);
+			for(int k = 0; k < 2; k++) {
+				if( k == 0 )
+					SERIAL_PGM("Integer Steps:");
+				else
+					SERIAL_PGM("Float Steps:");
+				SERIAL_PORT.print(steps[k]);
+				SERIAL_PGM(" Compute per step:");
+				SERIAL_PORT.print(steps[k] ? computeMicros[k] / steps[k] : 0);
+				SERIAL_PGM(" Move:");
+				SERIAL_PORT.println(moveMicros[k]);
+			}
+			SERIAL_PGM("Max interval difference:");
+			SERIAL_PORT.print(maxDiff);
+			SERIAL_PGM(" Step:");
+			SERIAL_PORT.println(maxDiffStep);
+			SERIAL_PGM(MSG_BEGIN);
+			SERIAL_PGM(stepperProfileHdr);
+			SERIAL_PGMLN(MSG_TERMINATE);
+			SERIAL_PORT.flush();
+		}
+		break;
+		
 	case 798: // M798 Z<motor control> [X] Report controller status for given controller. If X, slot is PWM
 		char* buf;
 		SERIAL_PGM(MSG_BEGIN);
@@ -2149,14 +2697,14 @@ void processGCode(int cval) {
 		if( code_seen('S') ) {
 			nread = code_value();
 		}
-		micros = 0;
+		micro_delay = 0;
 		if( code_seen('M')) {
-			micros = (uint32_t)code_value();
+			micro_delay = (uint32_t)code_value();
 		}
 		values = new int(nread);
 		for(int i = 0; i < nread; i++) {
 			*(values+i) = apin->analogRead();
-			for(int j = 0; j < micros; j++) _delay_us(1);
+			for(int j = 0; j < micro_delay; j++) _delay_us(1);
 		}
 		SERIAL_PGM(MSG_BEGIN);
 		SERIAL_PGM(analogPinHdr);
@@ -2223,21 +2771,60 @@ void FlushSerialRequestResend()
 * ---------------------------------------------------
 */
 void manage_inactivity() {
+  // step the acceleration ramps at a fixed interval from the time base
+  uint32_t now = millis();
+  bool ramp = (now - motor_ramp_time) >= MOTOR_RAMP_INTERVAL;
+  if( ramp )
+	motor_ramp_time = now;
+  bool sample = (now - current_sample_time) >= CURRENT_SAMPLE_INTERVAL;
+  if( sample )
+	current_sample_time = now;
   // check motor controllers
   for(int j =0; j < 10; j++) {
 	  if(motorControl[j]) {
+		motorControl[j]->pollDevice(now);
 		if( motorControl[j]->isConnected() ) {
+			if( ramp )
+				motorControl[j]->updateMotorRamp(now);
+			if( sample )
+				motorControl[j]->updateCurrentLimit();
 			motorControl[j]->checkEncoderShutdown();
 			motorControl[j]->checkUltrasonicShutdown();
-			if( motorControl[j]->queryFaultFlag() != fault ) {
-				fault = motorControl[j]->queryFaultFlag();
-				publishMotorFaultCode(fault);
+			if( realtime_output && motorControl[j]->isSmartController() &&
+				((RoboteqDevice*)motorControl[j])->statusFrameReady() ) {
+				publishControllerTelemetry(j, ((RoboteqDevice*)motorControl[j])->getStatus());
+				SERIAL_PORT.flush();
+			}
+			// cached or local flags, no I/O unless the bits changed
+			uint8_t fault = (uint8_t)motorControl[j]->queryFaultFlag();
+			if( fault != faultState[j] ) {
+				publishMotorFaultEvent(j, fault, faultState[j], now);
+				faultLatch[j] |= fault;
+				faultState[j] = fault;
 				SERIAL_PORT.flush();
 			}
 		}
 	  }
   }
   
+  // a background stepper move has ended
+  if( stepperService && stepperService->moveComplete() ) {
+	publishStepperComplete(stepperService);
+	SERIAL_PORT.flush();
+  }
+  
+  // run the IMU samples through the filter every pass, the stream only goes out at its interval
+  if( imu ) {
+	imu->updateFusion();
+	if( imuQuantities & IMU_BARO )
+		imu->updateBarometer(now);
+	if( imuInterval && realtime_output && (now - imuTime) >= imuInterval ) {
+		imuTime = now;
+		publishIMU(imu, imuQuantities);
+		SERIAL_PORT.flush();
+	}
+  }
+  
   if( realtime_output ) {		
 	// Check the ultrasonic ranging for all devices defined by successive M301 directives
 	for(int i = 0 ; i < 10; i++) {
@@ -2276,67 +2863,162 @@ void Stop() {
   }
 }
 /*
-* The fault code is bit-ordered for 8 cases
+* Publish the fault bits that changed on a controller as one event, + for a fault that appeared, - for one that cleared.
+* Only called on an edge, the check in manage_inactivity is a byte compare.
+* slot - controller slot
+* fault - fault bits now
+* prev - fault bits at the last event
+* now - time base millis of the edge
 */
-void publishMotorFaultCode(int fault) {
-	uint8_t bfault = 0;
-	uint8_t j = 1;
+void publishMotorFaultEvent(int slot, uint8_t fault, uint8_t prev, uint32_t now) {
+	uint8_t changed = fault ^ prev;
+	uint8_t j = 4;
 	SERIAL_PGM(MSG_BEGIN);
 	SERIAL_PGM(motorFaultCntrlHdr);
 	SERIAL_PGMLN(MSG_DELIMIT);
-	for(int i = 0; i < 8 ; i++) {
-		bfault = fault & (1<<i);
-		switch(bfault) {
-			default:
-			case 0: // bit not set
-				break;
-			case 1:
-				SERIAL_PORT.print(j++);
-				SERIAL_PORT.print(' ');
-				SERIAL_PGMLN(MSG_MOTORCONTROL_1);
-				break;
-			case 2:
-				SERIAL_PORT.print(j++);
-				SERIAL_PORT.print(' ');
-				SERIAL_PGMLN(MSG_MOTORCONTROL_2);
-				break;
-			case 4:
-				SERIAL_PORT.print(j++);
-				SERIAL_PORT.print(' ');
-				SERIAL_PGMLN(MSG_MOTORCONTROL_3);
-				break;
-			case 8:
-				SERIAL_PORT.print(j++);
-				SERIAL_PORT.print(' ');
-				SERIAL_PGMLN(MSG_MOTORCONTROL_4);
-				break;
-			case 16:
-				SERIAL_PORT.print(j++);
-				SERIAL_PORT.print(' ');
-				SERIAL_PGMLN(MSG_MOTORCONTROL_5);
-				break;
-			case 32:
-				SERIAL_PORT.print(j++);
-				SERIAL_PORT.print(' ');
-				SERIAL_PGMLN(MSG_MOTORCONTROL_6);
-				break;
-			case 64:
-				SERIAL_PORT.print(j++);
-				SERIAL_PORT.print(' ');
-				SERIAL_PGMLN(MSG_MOTORCONTROL_7);
-				break;
-			case 128:
-				SERIAL_PORT.print(j++);
-				SERIAL_PORT.print(' ');
-				SERIAL_PGMLN(MSG_MOTORCONTROL_8);
-				break;
-		}
+	SERIAL_PGM("1 "); // controller slot
+	SERIAL_PORT.println(slot);
+	SERIAL_PGM("2 "); // timestamp
+	SERIAL_PORT.println(now);
+	SERIAL_PGM("3 "); // fault bits
+	SERIAL_PORT.println(fault);
+	for(uint8_t i = 0; i < 8; i++) {
+		if( !(changed & (1<<i)) )
+			continue;
+		SERIAL_PORT.print(j++);
+		SERIAL_PORT.print((fault & (1<<i)) ? " +" : " -");
+		serialprintPGM((PGM_P)pgm_read_word(&motorFaultMsg[i]));
+		SERIAL_PORT.println();
 	}
 	SERIAL_PGM(MSG_BEGIN);
 	SERIAL_PGM(motorFaultCntrlHdr);
 	SERIAL_PGMLN(MSG_TERMINATE);
 }
 /*
+* Deliver the position of each stepper slot in use at the end of a background move started by G202/G203/G204,
+* the line number is the slot + 1
+*/
+void publishStepperComplete(StepperInterruptService* service) {
+	SERIAL_PGM(MSG_BEGIN);
+	SERIAL_PGM(stepperCntrlHdr);
+	SERIAL_PGMLN(MSG_DELIMIT);
+	for(int i = 0; i < STEPPER_SLOTS; i++) {
+		if( !accelStepper[i] )
+			continue;
+		SERIAL_PORT.print(i+1);
+		SERIAL_PORT.print(' ');
+		SERIAL_PORT.println(service->currentPosition(i));
+	}
+	SERIAL_PGM(MSG_BEGIN);
+	SERIAL_PGM(stepperCntrlHdr);
+	SERIAL_PGMLN(MSG_TERMINATE);
+}
+/*
+* Deliver the IMU quantities selected by M20 Q, each line number belongs to one value and only those selected
+* and available are sent:
+* 1-4 quaternion w x y z, 5 roll, 6 pitch, 7 heading in degrees, 8 micros of the last gyro sample fused
+* 9-11 accel x y z m/s^2, 12-14 gyro x y z rad/s, 15-17 mag x y z microtesla
+* 18 altitude m, 19 temperature C, 20 pressure hPa
+*/
+void publishIMU(PitchRollHeading* prh, uint8_t quantities) {
+	sensors_vec_t vec;
+	SERIAL_PGM(MSG_BEGIN);
+	SERIAL_PGM(imuCntrlHdr);
+	SERIAL_PGMLN(MSG_DELIMIT);
+	if( (quantities & IMU_ORIENTATION) && prh->fusionReady ) {
+		prh->getOrientation(&vec);
+		SERIAL_PGM("1 ");
+		SERIAL_PORT.println(prh->fusion->q0, 4);
+		SERIAL_PGM("2 ");
+		SERIAL_PORT.println(prh->fusion->q1, 4);
+		SERIAL_PGM("3 ");
+		SERIAL_PORT.println(prh->fusion->q2, 4);
+		SERIAL_PGM("4 ");
+		SERIAL_PORT.println(prh->fusion->q3, 4);
+		SERIAL_PGM("5 ");
+		SERIAL_PORT.println(vec.roll);
+		SERIAL_PGM("6 ");
+		SERIAL_PORT.println(vec.pitch);
+		SERIAL_PGM("7 ");
+		SERIAL_PORT.println(vec.heading);
+		SERIAL_PGM("8 ");
+		SERIAL_PORT.println(prh->getFusionTime());
+	}
+	if( (quantities & IMU_ACCEL) && prh->getVector(SENSOR_TYPE_ACCELEROMETER, &vec) ) {
+		SERIAL_PGM("9 ");
+		SERIAL_PORT.println(vec.x);
+		SERIAL_PGM("10 ");
+		SERIAL_PORT.println(vec.y);
+		SERIAL_PGM("11 ");
+		SERIAL_PORT.println(vec.z);
+	}
+	if( (quantities & IMU_GYRO) && prh->getVector(SENSOR_TYPE_GYROSCOPE, &vec) ) {
+		SERIAL_PGM("12 ");
+		SERIAL_PORT.println(vec.x, 4);
+		SERIAL_PGM("13 ");
+		SERIAL_PORT.println(vec.y, 4);
+		SERIAL_PGM("14 ");
+		SERIAL_PORT.println(vec.z, 4);
+	}
+	if( (quantities & IMU_MAG) && prh->getVector(SENSOR_TYPE_MAGNETIC_FIELD, &vec) ) {
+		SERIAL_PGM("15 ");
+		SERIAL_PORT.println(vec.x);
+		SERIAL_PGM("16 ");
+		SERIAL_PORT.println(vec.y);
+		SERIAL_PGM("17 ");
+		SERIAL_PORT.println(vec.z);
+	}
+	float altitude, temperature, pressure;
+	if( (quantities & IMU_BARO) && prh->getBarometer(&altitude, &temperature, &pressure) ) {
+		SERIAL_PGM("18 ");
+		SERIAL_PORT.println(altitude);
+		SERIAL_PGM("19 ");
+		SERIAL_PORT.println(temperature);
+		SERIAL_PGM("20 ");
+		SERIAL_PORT.println(pressure);
+	}
+	SERIAL_PGM(MSG_BEGIN);
+	SERIAL_PGM(imuCntrlHdr);
+	SERIAL_PGMLN(MSG_TERMINATE);
+}
+/*
+* Deliver the IMU calibration in use, 1-3 gyro bias x y z and 4-6 mag offset x y z in counts, 7-9 mag scale x y z
+* with 4096 as 1
+*/
+void publishIMUCalibration(void) {
+	SERIAL_PGM(MSG_BEGIN);
+	SERIAL_PGM(imuCalibrationHdr);
+	SERIAL_PGMLN(MSG_DELIMIT);
+	for(int i = 0; i < 3; i++) {
+		SERIAL_PORT.print(i+1);
+		SERIAL_PORT.print(' ');
+		SERIAL_PORT.println(imuCalibration.gyroBias[i]);
+	}
+	for(int i = 0; i < 3; i++) {
+		SERIAL_PORT.print(i+4);
+		SERIAL_PORT.print(' ');
+		SERIAL_PORT.println(imuCalibration.magOffset[i]);
+	}
+	for(int i = 0; i < 3; i++) {
+		SERIAL_PORT.print(i+7);
+		SERIAL_PORT.print(' ');
+		SERIAL_PORT.println(imuCalibration.magScale[i]);
+	}
+	SERIAL_PGM(MSG_BEGIN);
+	SERIAL_PGM(imuCalibrationHdr);
+	SERIAL_PGMLN(MSG_TERMINATE);
+}
+/*
+* Bring up the IMU and its interrupt pipeline on first use, with the calibration from EEPROM
+*/
+void startIMU(void) {
+	if( imu )
+		return;
+	imu = new PitchRollHeading();
+	imu->setCalibration(&imuCalibration);
+	imu->startInterrupts();
+}
+/*
 * Deliver the battery voltage from smart controller
 */
 void publishBatteryVolts(int volts) {
@@ -2349,6 +3031,41 @@ void publishBatteryVolts(int volts) {
 	SERIAL_PGM(batteryCntrlHdr);
 	SERIAL_PGMLN(MSG_TERMINATE);
 }
+/*
+* Deliver one streamed status frame from a smart controller, amps and volts * 10, speed in RPM
+*/
+void publishControllerTelemetry(int slot, RoboteqStatus* stat) {
+	SERIAL_PGM(MSG_BEGIN);
+	SERIAL_PGM(telemetryCntrlHdr);
+	SERIAL_PGMLN(MSG_DELIMIT);
+	SERIAL_PGM("1 "); // controller slot
+	SERIAL_PORT.println(slot);
+	SERIAL_PGM("2 "); // motor amps channel 1
+	SERIAL_PORT.println(stat->motorAmps[0]);
+	SERIAL_PGM("3 "); // motor amps channel 2
+	SERIAL_PORT.println(stat->motorAmps[1]);
+	SERIAL_PGM("4 "); // battery amps channel 1
+	SERIAL_PORT.println(stat->batteryAmps[0]);
+	SERIAL_PGM("5 "); // battery amps channel 2
+	SERIAL_PORT.println(stat->batteryAmps[1]);
+	SERIAL_PGM("6 "); // speed channel 1
+	SERIAL_PORT.println(stat->speed[0]);
+	SERIAL_PGM("7 "); // speed channel 2
+	SERIAL_PORT.println(stat->speed[1]);
+	SERIAL_PGM("8 "); // motor volts
+	SERIAL_PORT.println(stat->motorVolts);
+	SERIAL_PGM("9 "); // battery volts
+	SERIAL_PORT.println(stat->batteryVolts);
+	SERIAL_PGM("10 "); // fault flags
+	SERIAL_PORT.println(stat->faultFlags);
+	SERIAL_PGM("11 "); // status flags
+	SERIAL_PORT.println(stat->statusFlags);
+	SERIAL_PGM("12 "); // timestamp
+	SERIAL_PORT.println(stat->timestamp);
+	SERIAL_PGM(MSG_BEGIN);
+	SERIAL_PGM(telemetryCntrlHdr);
+	SERIAL_PGMLN(MSG_TERMINATE);
+}
 /************************************************************************/
 /* only call this if we know code is stall                              */
 /************************************************************************/
@@ -70,9 +70,11 @@ uint8_t Servo::set(int pin, HardwareTimer* hTimer, int min, int max)
     // todo min/max check: abs(min - MIN_PULSE_WIDTH) /4 < 128
     this->min  = (MIN_PULSE_WIDTH - min)/4; //resolution of min/max is 4 uS
     this->max  = (MAX_PULSE_WIDTH - max)/4;
-    // initialize the timer if it has not already been initialized
+    // initialize the timer if it has not already been initialized, provided no one else is running it at another configuration
     timer16_Sequence_t timer = SERVO_INDEX_TO_TIMER(servoIndex);
     if(isTimerActive(timer) == false) {
+      if( hTimer->claim(STATE_OVFL, TIMER_OWNER_SERVO, 0, CLOCK_PRESCALE_8) == TIMER_CLAIM_CONFLICT )
+        return INVALID_SERVO;
       initISR(timer);
 	}
     servos[this->servoIndex].Pin.isActive = true;  // this must be set after the check for isTimerActive
@@ -86,6 +88,7 @@ void Servo::detach()
   timer16_Sequence_t timer = SERVO_INDEX_TO_TIMER(servoIndex);
   if(isTimerActive(timer) == false) {
 	  servos[this->servoIndex].Pin.timer->detachInterrupt(0);
+	  servos[this->servoIndex].Pin.timer->release(STATE_OVFL);
   }
 }
 
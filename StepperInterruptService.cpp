@@ -0,0 +1,411 @@
+/*
+ * StepperInterruptService.cpp
+ * Timer driven, coordinated step generation, see StepperInterruptService.h
+ * The trapezoids are planned in the foreground as moves are queued, the interrupt only walks them.
+ * Created: 10/18/2026 1:12:40 PM
+ *  Author: jg
+ */
+#include "StepperInterruptService.h"
+#include "speed_lookuptable.h"
+
+/*
+* Timer ticks at 2MHz between steps at stepRate steps per second, from the speed_lookuptable tables.
+* Above 2048 steps/s the fast table is indexed by the high byte and the low byte interpolates with the gain
+* in the second column, below that the slow table is indexed in steps of 8 and interpolated by the low 3 bits.
+*/
+uint16_t calcStepTimer(uint16_t stepRate)
+{
+	uint16_t ticks;
+	if( stepRate > STEPPER_MAX_RATE )
+		stepRate = STEPPER_MAX_RATE;
+	if( stepRate < STEPPER_MIN_RATE )
+		stepRate = STEPPER_MIN_RATE;
+	stepRate -= STEPPER_MIN_RATE; // the tables start at the minimum rate
+	if( stepRate >= (8*256) ) {
+		uint8_t idx = stepRate >> 8;
+		uint16_t gain = pgm_read_word(&speed_lookuptable_fast[idx][1]);
+		ticks = pgm_read_word(&speed_lookuptable_fast[idx][0]) - (uint16_t)(((uint32_t)gain * (stepRate & 0xFF)) >> 8);
+	} else {
+		uint8_t idx = stepRate >> 3;
+		uint16_t gain = pgm_read_word(&speed_lookuptable_slow[idx][1]);
+		ticks = pgm_read_word(&speed_lookuptable_slow[idx][0]) - ((gain * (stepRate & 0x07)) >> 3);
+	}
+	if( ticks < 100 ) // 20kHz, leave the rest of the system some time
+		ticks = 100;
+	return ticks;
+}
+/*
+* Claim the timer and set it up for CTC at prescale 8, with the compare interrupt attached but disabled until a move starts.
+* Returns the claim status, TIMER_CLAIM_CONFLICT if the timer is in use for something else, in which case nothing is changed.
+*/
+uint8_t StepperInterruptService::init(void)
+{
+	uint8_t status = timer->claim(STATE_OVFL, TIMER_OWNER_STEPPER, STEPPER_TIMER_MODE, CLOCK_PRESCALE_8);
+	if( status == TIMER_CLAIM_CONFLICT )
+		return status;
+	timer->setClockSource(CLOCK_STOP);
+	timer->setMode(STEPPER_TIMER_MODE);
+	timer->setOCR(CHANNEL_A, 0x4000);
+	timer->setCounter(0);
+	timer->attachInterrupt(INTERRUPT_COMPARE_MATCH_A, this, 0);
+	timer->setClockSource(CLOCK_PRESCALE_8);
+	return status;
+}
+/*
+* Plan the trapezoid of a block from its entry and exit speeds as fractions of its nominal speed.
+* Rates do not go below STEPPER_START_RATE, and where the move is too short to reach the nominal rate it becomes a triangle.
+* A block that has been picked up by the interrupt is left alone.
+*/
+void StepperInterruptService::calculateTrapezoid(StepperBlock* blk, float entryFactor, float exitFactor)
+{
+	uint16_t minRate = blk->nominalRate < STEPPER_START_RATE ? blk->nominalRate : STEPPER_START_RATE;
+	uint16_t initialRate = (uint16_t)ceil(blk->nominalRate * entryFactor);
+	uint16_t finalRate = (uint16_t)ceil(blk->nominalRate * exitFactor);
+	if( initialRate < minRate )
+		initialRate = minRate;
+	if( finalRate < minRate )
+		finalRate = minRate;
+	// events to reach the nominal rate and to come down from it, v^2 = u^2 + 2as
+	float twoA = 2.0 * blk->acceleration;
+	float nominalSq = (float)blk->nominalRate * blk->nominalRate;
+	float initialSq = (float)initialRate * initialRate;
+	float finalSq = (float)finalRate * finalRate;
+	long accelerateSteps = (long)ceil((nominalSq - initialSq) / twoA);
+	long decelerateSteps = (long)floor((nominalSq - finalSq) / twoA);
+	long plateauSteps = (long)blk->stepEventCount - accelerateSteps - decelerateSteps;
+	if( plateauSteps < 0 ) { // triangle, accelerate to where the ramps meet
+		accelerateSteps = (long)ceil((twoA * blk->stepEventCount - initialSq + finalSq) / (2.0 * twoA));
+		if( accelerateSteps < 0 )
+			accelerateSteps = 0;
+		if( accelerateSteps > (long)blk->stepEventCount )
+			accelerateSteps = blk->stepEventCount;
+		plateauSteps = 0;
+	}
+	uint8_t oldSREG = SREG;
+	cli();
+	if( !blk->busy ) {
+		blk->accelerateUntil = accelerateSteps;
+		blk->decelerateAfter = accelerateSteps + plateauSteps;
+		blk->initialRate = initialRate;
+		blk->finalRate = finalRate;
+	}
+	SREG = oldSREG;
+}
+/*
+* Speed reached from speed v over distance d at acceleration a, v^2 = u^2 + 2as
+*/
+static inline float allowableSpeed(float a, float v, float d)
+{
+	return sqrt(v * v + 2.0 * a * d);
+}
+/*
+* Look ahead over the queue. The reverse pass lowers each entry speed to what the move can still slow down from to enter the next
+* at its entry speed, the forward pass lowers it to what the move before can reach from its own entry, then the trapezoids
+* of the blocks whose ends changed are planned again. The block being stepped is fixed, the one after enters at its exit rate.
+*/
+void StepperInterruptService::recalculate(void)
+{
+	uint8_t tail = blockTail;
+	uint8_t head = blockHead;
+	if( tail == head )
+		return;
+	// reverse pass, newest to oldest, the newest already ends at rest
+	uint8_t index = prevBlock(head);
+	while( index != tail ) {
+		StepperBlock* next = &blocks[index];
+		index = prevBlock(index);
+		StepperBlock* blk = &blocks[index];
+		if( blk->busy || blk->entrySpeed == blk->maxEntrySpeed )
+			continue;
+		if( !blk->nominalLength && blk->maxEntrySpeed > next->entrySpeed ) {
+			float v = allowableSpeed(blk->pathAcceleration, next->entrySpeed, blk->length);
+			blk->entrySpeed = v < blk->maxEntrySpeed ? v : blk->maxEntrySpeed;
+		} else {
+			blk->entrySpeed = blk->maxEntrySpeed;
+		}
+		blk->recalculate = 1;
+	}
+	// forward pass, oldest to newest
+	StepperBlock* prev = &blocks[tail];
+	for(index = nextBlock(tail); index != head; index = nextBlock(index)) {
+		StepperBlock* blk = &blocks[index];
+		float limit;
+		if( prev->busy ) // already moving on a fixed trapezoid, enter at the rate it leaves
+			limit = prev->nominalSpeed * prev->finalRate / prev->nominalRate;
+		else if( !prev->nominalLength && prev->entrySpeed < blk->entrySpeed )
+			limit = allowableSpeed(prev->pathAcceleration, prev->entrySpeed, prev->length);
+		else
+			limit = blk->entrySpeed;
+		if( limit < blk->entrySpeed ) {
+			blk->entrySpeed = limit;
+			blk->recalculate = 1;
+		}
+		prev = blk;
+	}
+	// trapezoids, each block exits at the entry speed of the next, the last at rest
+	for(index = tail; index != head; index = nextBlock(index)) {
+		StepperBlock* blk = &blocks[index];
+		uint8_t following = nextBlock(index);
+		if( following == head ) {
+			calculateTrapezoid(blk, blk->entrySpeed / blk->nominalSpeed, 0.0);
+			blk->recalculate = 0;
+		} else if( blk->recalculate || blocks[following].recalculate ) {
+			calculateTrapezoid(blk, blk->entrySpeed / blk->nominalSpeed, blocks[following].entrySpeed / blk->nominalSpeed);
+			blk->recalculate = 0;
+		}
+	}
+}
+/*
+* Queue a coordinated move of steps[slot], + clockwise, - anticlockwise, for each of the STEPPER_SLOTS slots.
+* The slot with the most steps leads, rate and accel are for it, 0 takes them from its AccelStepper max speed and acceleration.
+* Either way they are brought down so that no slot goes over its own max speed or acceleration on its share of the move.
+* The junction speed with the move before is the nominal speed, cut back so no slot changes its speed by more than STEPPER_JERK
+* steps per second at the corner, then the queue is planned again. Returns at once, the steps are taken by the interrupt.
+* Returns STEPPER_QUEUED, or STEPPER_NO_SLOT or STEPPER_FULL in which case nothing is queued.
+*/
+uint8_t StepperInterruptService::queueMove(long* steps, uint16_t rate, uint16_t accel)
+{
+	uint8_t next = nextBlock(blockHead);
+	if( next == blockTail )
+		return STEPPER_FULL;
+	StepperBlock* blk = &blocks[blockHead];
+	uint32_t events = 0;
+	uint8_t lead = 0;
+	float lengthSq = 0;
+	blk->directionBits = 0;
+	for(uint8_t i = 0; i < STEPPER_SLOTS; i++) {
+		blk->steps[i] = labs(steps[i]);
+		if( !blk->steps[i] )
+			continue;
+		if( !steppers || !steppers[i] )
+			return STEPPER_NO_SLOT;
+		if( steps[i] > 0 )
+			blk->directionBits |= (1 << i);
+		if( blk->steps[i] > events ) {
+			events = blk->steps[i];
+			lead = i;
+		}
+		lengthSq += (float)blk->steps[i] * blk->steps[i];
+	}
+	if( !events ) {
+		if( !running )
+			complete = 1;
+		return STEPPER_QUEUED;
+	}
+	// lead rates from the lead stepper, limited by what each slot can do on its fraction of the events
+	float maxRate = rate ? rate : steppers[lead]->maxSpeed();
+	float maxAccel = accel ? accel : steppers[lead]->acceleration();
+	for(uint8_t i = 0; i < STEPPER_SLOTS; i++) {
+		if( !blk->steps[i] )
+			continue;
+		float ratio = (float)events / blk->steps[i];
+		if( steppers[i]->maxSpeed() * ratio < maxRate )
+			maxRate = steppers[i]->maxSpeed() * ratio;
+		if( steppers[i]->acceleration() * ratio < maxAccel )
+			maxAccel = steppers[i]->acceleration() * ratio;
+	}
+	if( maxRate > STEPPER_MAX_RATE )
+		maxRate = STEPPER_MAX_RATE;
+	if( maxRate < 1.0 )
+		maxRate = 1.0;
+	if( maxAccel > 65535.0 )
+		maxAccel = 65535.0;
+	if( maxAccel < 1.0 )
+		maxAccel = 1.0;
+	blk->stepEventCount = events;
+	blk->nominalRate = (uint16_t)maxRate;
+	blk->acceleration = (uint16_t)maxAccel;
+	blk->accelerationRate = (uint32_t)(blk->acceleration * 16777216.0 / (F_CPU / 8));
+	// the same in speeds along the line of the move
+	blk->length = sqrt(lengthSq);
+	float scale = blk->length / events;
+	blk->nominalSpeed = blk->nominalRate * scale;
+	blk->pathAcceleration = blk->acceleration * scale;
+	float minSpeed = (blk->nominalRate < STEPPER_START_RATE ? blk->nominalRate : STEPPER_START_RATE) * scale;
+	// junction with the move before, from rest if there is none
+	float speed[STEPPER_SLOTS];
+	float junction = minSpeed;
+	for(uint8_t i = 0; i < STEPPER_SLOTS; i++) {
+		speed[i] = (float)blk->steps[i] * blk->nominalRate / events;
+		if( !(blk->directionBits & (1 << i)) )
+			speed[i] = -speed[i];
+	}
+	if( blockHead != blockTail && previousNominalSpeed > 0.0 ) {
+		junction = previousNominalSpeed < blk->nominalSpeed ? previousNominalSpeed : blk->nominalSpeed;
+		float factor = 1.0;
+		for(uint8_t i = 0; i < STEPPER_SLOTS; i++) {
+			float jerk = fabs(previousSpeed[i] - speed[i]);
+			if( jerk > STEPPER_JERK && STEPPER_JERK / jerk < factor )
+				factor = STEPPER_JERK / jerk;
+		}
+		junction *= factor;
+		if( junction < minSpeed )
+			junction = minSpeed;
+	}
+	blk->maxEntrySpeed = junction;
+	float allowable = allowableSpeed(blk->pathAcceleration, minSpeed, blk->length);
+	blk->entrySpeed = junction < allowable ? junction : allowable;
+	blk->nominalLength = blk->nominalSpeed <= allowable;
+	blk->recalculate = 1;
+	blk->busy = 0;
+	for(uint8_t i = 0; i < STEPPER_SLOTS; i++)
+		previousSpeed[i] = speed[i];
+	previousNominalSpeed = blk->nominalSpeed;
+	calculateTrapezoid(blk, blk->entrySpeed / blk->nominalSpeed, minSpeed / blk->nominalSpeed);
+	blockHead = next;
+	recalculate();
+	// idle, kick the interrupt to pick up the block
+	if( !running ) {
+		running = 1;
+		complete = 0;
+		timer->setCounter(0);
+		timer->setOCR(CHANNEL_A, 100);
+		timer->clearInterrupt(CHANNEL_A);
+		timer->enableInterrupt(INTERRUPT_COMPARE_MATCH_A);
+	}
+	return STEPPER_QUEUED;
+}
+/*
+* Decelerate from the present rate and stop, dropping the moves queued after the one in progress, which then completes early,
+* as AccelStepper::stop does. All slots stop together on the line of the move.
+*/
+void StepperInterruptService::stop(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	if( current ) {
+		blockHead = nextBlock(blockTail);
+		if( stepEvents <= current->decelerateAfter || current->finalRate > STEPPER_START_RATE ) {
+			// start from the rate actually reached, which on the deceleration ramp of a blended block is above its final rate
+			uint16_t rate = stepRate;
+			uint16_t finalRate = rate < STEPPER_START_RATE ? rate : STEPPER_START_RATE;
+			uint32_t stopSteps = ((uint32_t)rate * rate - (uint32_t)finalRate * finalRate) / (2UL * current->acceleration);
+			// the block ends early but keeps its step counts, so the Bresenham ratios, and with them the line, are unchanged
+			if( stepEvents + stopSteps + 1 < endEvents )
+				endEvents = stepEvents + stopSteps + 1;
+			accStepRate = rate;
+			current->finalRate = finalRate;
+			current->accelerateUntil = stepEvents;
+			current->decelerateAfter = stepEvents;
+			decelerationTime = 0;
+		}
+	} else {
+		blockHead = blockTail;
+	}
+	previousNominalSpeed = 0;
+	SREG = oldSREG;
+}
+/*
+* Stop dead with no deceleration and empty the planner, as before a stepper slot is replaced. No completion is reported.
+*/
+void StepperInterruptService::halt(void)
+{
+	timer->disableInterrupt(INTERRUPT_COMPARE_MATCH_A);
+	running = 0;
+	complete = 0;
+	current = NULL;
+	blockHead = blockTail = 0;
+	previousNominalSpeed = 0;
+}
+/*
+* Position in steps of a slot, read with interrupts off as the interrupt updates it. 0 for an empty slot.
+*/
+long StepperInterruptService::currentPosition(uint8_t slot)
+{
+	if( !steppers || !steppers[slot] )
+		return 0;
+	uint8_t oldSREG = SREG;
+	cli();
+	long pos = steppers[slot]->currentPosition();
+	SREG = oldSREG;
+	return pos;
+}
+/*
+* Take the oldest block for stepping and load the timer with the ticks to its first event, or if the planner is empty
+* come to rest and flag completion. Interrupt context.
+*/
+void StepperInterruptService::loadBlock(void)
+{
+	if( blockTail == blockHead ) {
+		current = NULL;
+		running = 0;
+		timer->disableInterrupt(INTERRUPT_COMPARE_MATCH_A);
+		complete = 1;
+		return;
+	}
+	current = &blocks[blockTail];
+	current->busy = 1;
+	for(uint8_t i = 0; i < STEPPER_SLOTS; i++)
+		counter[i] = -(int32_t)(current->stepEventCount >> 1);
+	stepEvents = 0;
+	endEvents = current->stepEventCount;
+	nominalTimer = calcStepTimer(current->nominalRate);
+	accStepRate = current->initialRate;
+	stepRate = current->initialRate;
+	accelerationTime = calcStepTimer(current->initialRate);
+	decelerationTime = 0;
+	timer->setOCR(CHANNEL_A, (uint16_t)accelerationTime);
+}
+/*
+* Take the steps due on this event, then work out the ticks to the next one from where the move is on the trapezoid.
+* The ramps keep time in timer ticks and the rate is initial + accel * time, which only takes a multiply per event.
+* At the end of a block the next one follows on at once from the rate this one left at.
+*/
+void StepperInterruptService::service(void)
+{
+	if( !running )
+		return;
+	if( !current ) {
+		loadBlock();
+		return;
+	}
+	// raise the step pins of every slot due, hold them for one constant delay, then lower them together
+	uint8_t pulsed = 0;
+	for(uint8_t i = 0; i < STEPPER_SLOTS; i++) {
+		if( !current->steps[i] )
+			continue;
+		counter[i] += current->steps[i];
+		if( counter[i] > 0 ) {
+			if( steppers[i]->stepOnce(current->directionBits & (1 << i)) )
+				pulsed |= (1 << i);
+			counter[i] -= current->stepEventCount;
+		}
+	}
+	if( pulsed ) {
+		_delay_us(STEPPER_PULSE_WIDTH);
+		for(uint8_t i = 0; i < STEPPER_SLOTS; i++)
+			if( pulsed & (1 << i) )
+				steppers[i]->endStep();
+	}
+	uint32_t events = ++stepEvents;
+	if( events >= endEvents ) {
+		blockTail = nextBlock(blockTail);
+		loadBlock();
+		return;
+	}
+	uint16_t ticks;
+	if( events <= current->accelerateUntil ) {
+		uint16_t rate = mulU24X24toH16(accelerationTime, current->accelerationRate) + current->initialRate;
+		if( rate > current->nominalRate )
+			rate = current->nominalRate;
+		accStepRate = rate;
+		stepRate = rate;
+		ticks = calcStepTimer(rate);
+		if( accelerationTime < 0xFFFFFF )
+			accelerationTime += ticks;
+	} else if( events > current->decelerateAfter ) {
+		uint16_t rate = mulU24X24toH16(decelerationTime, current->accelerationRate);
+		if( rate > accStepRate || accStepRate - rate < current->finalRate )
+			rate = current->finalRate;
+		else
+			rate = accStepRate - rate;
+		stepRate = rate;
+		ticks = calcStepTimer(rate);
+		if( decelerationTime < 0xFFFFFF )
+			decelerationTime += ticks;
+	} else {
+		stepRate = current->nominalRate;
+		ticks = nominalTimer;
+	}
+	timer->setOCR(CHANNEL_A, ticks);
+}
@@ -0,0 +1,126 @@
+/*
+ * StepperInterruptService.h
+ * Background step generation for up to STEPPER_SLOTS AccelSteppers from the compare match A interrupt of a 16 bit timer, as Marlin's stepper ISR does it.
+ * The timer runs in CTC mode at prescale 8, 2MHz at 16MHz, and each interrupt is one step event, then OCRnA is loaded with the
+ * ticks to the next event. A move is a block of steps for each slot, the slot with the most steps leads and takes a step on every event,
+ * the others are spread over the events Bresenham style so all slots start and finish together along a straight line.
+ * The event rate follows a trapezoid shared by all slots, ramping up from a start rate at the acceleration to the nominal rate,
+ * then down again to stop on the last event. Rates are turned into timer ticks with the speed_lookuptable tables, so the interrupt
+ * does no division or floating point, only table reads, adds and integer multiplies. The step pins of all the slots stepping on an event
+ * are raised together and held for one constant STEPPER_PULSE_WIDTH delay, never the per stepper G200 pulse width.
+ * Moves are queued by the main loop, which carries on, in a ring buffer planned with look ahead as Marlin's planner does it:
+ * the speed at each junction between moves is the most the change of direction of each slot allows, and a reverse then forward pass
+ * over the queue lowers it where a move is too short to slow down for the next, or to get up to speed from the last,
+ * with the constant acceleration of the AccelStepper model, so moves blend without stopping.
+ * The steppers come to rest when the queue runs dry, which is picked up from moveComplete() in manage_inactivity.
+ * Created: 10/18/2026 1:12:40 PM
+ *  Author: jg
+ */
+#ifndef STEPPERINTERRUPTSERVICE_H_
+#define STEPPERINTERRUPTSERVICE_H_
+#include "AccelStepper.h"
+#include "WHardwareTimer.h"
+#include "WInterruptService.h"
+#include "Configuration_adv.h"
+
+// CTC, TOP in OCRnA
+#define STEPPER_TIMER_MODE 0b0100
+// Steppers driven together
+#define STEPPER_SLOTS 4
+// queueMove results
+#define STEPPER_QUEUED 0
+#define STEPPER_NO_SLOT 1 // steps asked of a slot with no stepper
+#define STEPPER_FULL 2 // planner holds BLOCK_BUFFER_SIZE-1 moves, try again once one completes
+
+// lowest rate in the speed_lookuptable tables, calcStepTimer clamps to it
+#define STEPPER_MIN_RATE (F_CPU/500000)
+
+uint16_t calcStepTimer(uint16_t stepRate);
+/*
+* High 16 bits of a 24 by 24 bit product, (a * b) >> 24, the acceleration ramp in steps per second from ticks and the scaled rate.
+* Done in 8 bit splits so it stays within 32 bit multiplies, the partial products below the result are truncated,
+* which can leave the result 1 low.
+*/
+static inline uint16_t mulU24X24toH16(uint32_t a, uint32_t b)
+{
+	uint32_t a1 = a >> 8, b1 = b >> 8;
+	uint8_t a0 = a & 0xFF, b0 = b & 0xFF;
+	return (uint16_t)((a1 * b1 + ((a1 * b0 + b1 * a0) >> 8)) >> 8);
+}
+/*
+* One coordinated move, rates are lead slot steps, or step events, per second and counts are step events.
+* The planner speeds are along the line of the move through the space of the slots, whose length is in steps,
+* so that consecutive moves with different lead slots can be compared.
+*/
+struct StepperBlock {
+	uint32_t steps[STEPPER_SLOTS]; // steps for each slot
+	uint8_t directionBits; // bit set for clockwise on that slot
+	uint32_t stepEventCount; // steps of the lead slot
+	uint32_t accelerateUntil; // last event of the acceleration ramp
+	uint32_t decelerateAfter; // event after which deceleration begins
+	uint16_t initialRate;
+	uint16_t nominalRate;
+	uint16_t finalRate;
+	uint16_t acceleration; // events per second per second
+	uint32_t accelerationRate; // acceleration in events per second per timer tick, scaled by 2^24
+	// planner
+	float length; // steps along the line of the move
+	float nominalSpeed; // speed along the line at the nominal rate
+	float entrySpeed; // planned speed at the start of the move
+	float maxEntrySpeed; // junction limit with the move before
+	float pathAcceleration; // acceleration along the line
+	uint8_t nominalLength; // long enough to reach nominal speed from any entry, so entry can always be max
+	uint8_t recalculate; // entry or exit changed, trapezoid needs planning
+	volatile uint8_t busy; // being stepped, hands off
+};
+
+class StepperInterruptService : public InterruptService {
+	private:
+	AccelStepper** steppers;
+	HardwareTimer* timer;
+	StepperBlock blocks[BLOCK_BUFFER_SIZE]; // planner ring buffer
+	volatile uint8_t blockHead; // next free block
+	volatile uint8_t blockTail; // oldest block, the one being stepped
+	StepperBlock* current; // move in progress, NULL between moves
+	float previousSpeed[STEPPER_SLOTS]; // velocity of each slot at the nominal speed of the last move queued
+	float previousNominalSpeed;
+	volatile uint32_t stepEvents; // step events so far
+	uint32_t endEvents; // events after which the block ends, stepEventCount unless stop() cut it short
+	int32_t counter[STEPPER_SLOTS]; // Bresenham error per slot
+	uint16_t nominalTimer; // ticks per event at the nominal rate
+	volatile uint16_t accStepRate; // rate reached on the acceleration ramp
+	volatile uint16_t stepRate; // rate of the event last timed, where the stop ramp starts
+	uint32_t accelerationTime; // timer ticks since the start of the acceleration ramp
+	uint32_t decelerationTime; // timer ticks since the start of the deceleration ramp
+	volatile uint8_t running;
+	volatile uint8_t complete;
+	inline uint8_t nextBlock(uint8_t index) { return (index + 1) & (BLOCK_BUFFER_SIZE - 1); }
+	inline uint8_t prevBlock(uint8_t index) { return (index - 1) & (BLOCK_BUFFER_SIZE - 1); }
+	void calculateTrapezoid(StepperBlock* blk, float entryFactor, float exitFactor);
+	void recalculate(void);
+	void loadBlock(void);
+	public:
+	StepperInterruptService(HardwareTimer* timer) : steppers(NULL), timer(timer), blockHead(0), blockTail(0), current(NULL),
+		previousNominalSpeed(0), stepEvents(0), running(0), complete(0) {}
+	// the stepper slot array, kept by the caller, empty slots NULL
+	inline void setSteppers(AccelStepper** steppers) { this->steppers = steppers; }
+	uint8_t init(void);
+	uint8_t queueMove(long* steps, uint16_t rate = 0, uint16_t accel = 0);
+	void stop(void);
+	void halt(void);
+	long currentPosition(uint8_t slot);
+	inline uint8_t isRunning(void) { return running; }
+	// moves in the planner including the one in progress
+	inline uint8_t movesQueued(void) { return (blockHead - blockTail) & (BLOCK_BUFFER_SIZE - 1); }
+	// true once each time the planner runs dry and the steppers come to rest, cleared by the call
+	inline uint8_t moveComplete(void) {
+		if( !complete )
+			return 0;
+		complete = 0;
+		return 1;
+	}
+	// Compare match A, one step event then the ticks to the next
+	void service(void);
+};
+
+#endif /* STEPPERINTERRUPTSERVICE_H_ */
@@ -0,0 +1,102 @@
+/*
+ * TWIService.cpp
+ * Transmit and receive buffers of one device address on the TWI bus, see TwoWire.cpp
+ * The tree had TWIService.h but not this source, it is a reconstruction from the header and its uses in TwoWire.cpp.
+ * Created: 10/18/2026 6:42:51 PM
+ *  Author: jg
+ */
+#include "TWIService.h"
+#include "TwoWire.h"
+
+TWIService::TWIService(uint8_t device)
+{
+	this->device = device;
+	clearBuffers();
+}
+
+void TWIService::clearBuffers()
+{
+	clearTxBuffer();
+	clearRxBuffer();
+}
+
+void TWIService::clearTxBuffer()
+{
+	txBufferIndex = 0;
+	txBufferLength = 0;
+}
+
+void TWIService::clearRxBuffer()
+{
+	rxBufferIndex = 0;
+	rxBufferLength = 0;
+	rxBufferPointer = 0;
+}
+
+boolean TWIService::setRxBufferLength(uint8_t len)
+{
+	if( len > TWI_BUFFER_LENGTH )
+		return false;
+	rxBufferLength = len;
+	return true;
+}
+
+boolean TWIService::setTxBufferLength(uint8_t len)
+{
+	if( len > TWI_BUFFER_LENGTH )
+		return false;
+	txBufferLength = len;
+	return true;
+}
+/*
+* Bytes left to send
+*/
+uint8_t TWIService::remainingXmit()
+{
+	return txBufferLength - txBufferIndex;
+}
+/*
+* Bytes received and not yet taken by getRx
+*/
+uint8_t TWIService::remainingRcve()
+{
+	return rxBufferIndex - rxBufferPointer;
+}
+
+boolean TWIService::addRx(uint8_t trx)
+{
+	if( rxBufferIndex >= TWI_BUFFER_LENGTH )
+		return false;
+	rxBuffer[rxBufferIndex++] = trx;
+	return true;
+}
+
+boolean TWIService::addTx(uint8_t trx)
+{
+	if( txBufferIndex >= TWI_BUFFER_LENGTH )
+		return false;
+	txBuffer[txBufferIndex++] = trx;
+	return true;
+}
+
+uint8_t TWIService::getRx()
+{
+	if( rxBufferPointer >= rxBufferIndex )
+		return 0;
+	return rxBuffer[rxBufferPointer++];
+}
+
+uint8_t TWIService::getTx()
+{
+	if( txBufferIndex >= txBufferLength )
+		return 0;
+	return txBuffer[txBufferIndex++];
+}
+
+void TWIService::onTransmit(void)
+{
+}
+
+void TWIService::onReceive(void)
+{
+}
@@ -1,15 +1,43 @@
 
 /*
  * TWIService.h
- *
+ * Buffers for one device address on the TWI bus, and the completion callback of the transactions queued for it.
  * Created: 3/26/2014 1:45:08 AM
  *  Author: jg
- */ 
+ */
 #ifndef TWISERVICE_H_
 #define TWISERVICE_H_
 #include "DuplexService.h"
 #include "Arduino.h"
 
+// TWITransaction type
+#define TWI_XFER_WRITE 0 // reg, then length bytes of data
+#define TWI_XFER_READ 1 // length bytes into data
+#define TWI_XFER_REGISTER_READ 2 // reg, repeated start, then length bytes into data
+// TWITransaction status, the codes of endTransmission
+#define TWI_SUCCESS 0
+#define TWI_ADDRESS_NACK 2
+#define TWI_DATA_NACK 3
+#define TWI_BUS_FAULT 4
+#define TWI_PENDING 0xFF
+
+class TWIService;
+/*
+* One queued bus transaction. The caller owns the descriptor and the data, both must stay put until status leaves TWI_PENDING.
+* Reads take at least 1 byte.
+*/
+struct TWITransaction {
+	uint8_t address; // 7 bit device address
+	uint8_t type;
+	uint8_t reg; // register for TWI_XFER_WRITE and TWI_XFER_REGISTER_READ
+	uint8_t* data;
+	uint8_t length;
+	volatile uint8_t index; // bytes so far
+	uint8_t regSent;
+	volatile uint8_t status;
+	TWIService* service; // onComplete is called on this when done, may be NULL
+};
+
 class TWIService: public DuplexService {
 	public:
 	uint8_t device;
@@ -31,9 +59,11 @@ class TWIService: public DuplexService {
 	boolean addRx(uint8_t trx);
 	boolean addTx(uint8_t trx);
 	uint8_t getRx();
-	uint8_t getTx();	
+	uint8_t getTx();
 	virtual void onTransmit( void );// called at TW_ST_SLA_ACK, enter slave transmitter mode
 	virtual void onReceive( void ); // called at TW_SR_STOP
+	// a queued transaction is done, status is set, called from the TWI interrupt so keep it short, queueing the next is fine
+	virtual void onComplete( TWITransaction* transaction ) {}
 };
 
-#endif /* TWISERVICE_H_ */
\ No newline at end of file
+#endif /* TWISERVICE_H_ */
@@ -1,7 +1,7 @@
 /*
  * TwoWire.cpp
  * Creates service instances TWIService by channel as needed to maintain transmit and receive buffers
- * for each channel in use.
+ * for each channel in use. Queued transactions are run from the interrupt, see TwoWire.h
  * Created: 3/17/2014 12:03:08 AM
  * Author: jg
  */ 
@@ -14,6 +14,7 @@
 #include <compat/twi.h>
 #include "WString.h"
 #include "TwoWire.h"
+#include "IsrProfile.h"
 #include "new.h"
 
 #ifndef cbi
@@ -28,12 +29,17 @@
 TWIService* TwoWire::deviceService[255];
 uint8_t TwoWire::numService = 0;
 
-uint8_t TwoWire::twi_state;
+volatile uint8_t TwoWire::twi_state = TWI_READY;
 uint8_t TwoWire::twi_slarw;
 uint8_t TwoWire::twi_init = 0;
 
-uint8_t TwoWire::twi_error = 0;
+volatile uint8_t TwoWire::twi_error = 0;
 uint8_t TwoWire::transmitting = 0;
+
+TWITransaction* TwoWire::queue[TWI_QUEUE_LENGTH];
+volatile uint8_t TwoWire::queueHead = 0;
+volatile uint8_t TwoWire::queueTail = 0;
+TWITransaction* volatile TwoWire::current = NULL;
 //void (*TwoWire::user_onRequest)(void);
 //void (*TwoWire::user_onReceive)(int);
 
@@ -57,8 +63,8 @@ TWIService* TwoWire::getService() {
 
 void TwoWire::begin(void)
 {
-	twi_state = TWI_READY;
 	if( !twi_init ) {
+		twi_state = TWI_READY;
 		//MCUCR |= (1<<PUD);      // Disable all pull-ups
 		// activate internal pull-ups for twi
 		// as per note from atmega128 manual pg204
@@ -73,10 +79,21 @@ void TwoWire::begin(void)
 	/* twi bit rate formula from atmega128 manual pg 204
 	SCL Frequency = CPU Clock Frequency / (16 + (2 * TWBR))
 	note: TWBR should be 10 or higher for master mode
-	It is 72 for a 16mhz Wiring board with 100kHz TWI
+	It is 72 for a 16mhz Wiring board with 100kHz TWI, 12 at 400kHz
 	*/
-	// enable twi module, acks, and twi interrupt
-	TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTA) | _BV(TWIE) ;
+	// enable twi module, acks, and twi interrupt, leave the bus alone if it is in use
+	if( twi_state == TWI_READY )
+		TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA);
+}
+/*
+* Set the SCL frequency, TWI_STANDARD_FREQ or TWI_FAST_FREQ. Takes effect on the next transaction, the divisor
+* must stay at 10 or more for master mode so anything above 400kHz is held there.
+*/
+void TwoWire::setClock(uint32_t frequency)
+{
+	if( frequency > TWI_FAST_FREQ )
+		frequency = TWI_FAST_FREQ;
+	TWBR = ((CPU_FREQ / frequency) - 16) / 2;
 }
 
 void TwoWire::begin(uint8_t address)
@@ -106,8 +123,10 @@ void TwoWire::beginTransmission(uint8_t address)
 {
 	// indicate that we are transmitting
 	transmitting = 1;
-	// set address of targeted slave
-	begin(address);
+	if( !twi_init )
+		begin();
+	// set address of targeted slave, send appends from the start of its buffer
+	getService(address)->clearTxBuffer();
 }
 
 uint8_t TwoWire::endTransmission(void)
@@ -136,14 +155,12 @@ void TwoWire::send(uint8_t* data, uint8_t quantity)
 {
 	if(transmitting){
 		// in master transmitter mode
-		// set length and copy data into tx buffer
-		if( !deviceService[numService]->setTxBufferLength(quantity) ) {
-			return;
-		}
-		deviceService[numService]->txBufferIndex = 0;
+		// append to the tx buffer, so a register and its value can be sent one after the other
 		for(int i = 0; i < quantity; ++i){
-			deviceService[numService]->addTx(*(data+i));
+			if( !deviceService[numService]->addTx(*(data+i)) )
+				break;
 		}
+		deviceService[numService]->txBufferLength = deviceService[numService]->txBufferIndex;
 	} else {
 		// in slave send mode
 		// reply to master
@@ -189,10 +206,7 @@ uint8_t TwoWire::twi_readFrom(uint8_t address, uint8_t length)
   }
 
   // wait until twi is ready, become master receiver
-  while(TWI_READY != twi_state){
-    continue;
-  }
-  //twi_state = TWI_MRX;
+  claimBus(TWI_MRX);
   // reset error state (0xFF.. no error occurred)
   twi_error = 0xFF;
 
@@ -246,10 +260,8 @@ uint8_t TwoWire::twi_writeTo(uint8_t address, uint8_t length, uint8_t wait)
   }
 
   // wait until twi is ready, become master transmitter
-  while(TWI_READY != twi_state){
-    continue;
-  }
- 
+  claimBus(TWI_MTX);
+
   // reset error state (0xFF.. no error occured)
   twi_error = 0xFF;
   
@@ -278,6 +290,196 @@ uint8_t TwoWire::twi_writeTo(uint8_t address, uint8_t length, uint8_t wait)
     return 4;   // other twi error
 }
 
+/*
+ * Function claimBus
+ * Desc     waits for the bus to be free of blocking and queued transactions
+ *          and takes it for a blocking one, so the state is set before the
+ *          start condition and the caller's wait loop cannot see TWI_READY early
+ * Input    state: TWI_MRX or TWI_MTX
+ * Output   none
+ */
+void TwoWire::claimBus(uint8_t state)
+{
+  uint8_t oldSREG = SREG;
+  for(;;) {
+    cli();
+    if(TWI_READY == twi_state && queueHead == queueTail)
+      break;
+    SREG = oldSREG;
+  }
+  twi_state = state;
+  SREG = oldSREG;
+}
+
+/*
+ * Function queueTransaction
+ * Desc     queues a transaction to run from the interrupt when the bus is free,
+ *          starting it now if it is. Returns at once, status stays TWI_PENDING
+ *          until the transaction is done, then onComplete of its service is called
+ * Input    transaction: descriptor, owned by the caller until done
+ * Output   0 .. queued
+ *          1 .. queue full, nothing done
+ */
+uint8_t TwoWire::queueTransaction(TWITransaction* transaction)
+{
+  if( !twi_init )
+    begin();
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t next = (queueHead + 1) & (TWI_QUEUE_LENGTH - 1);
+  if( next == queueTail ) {
+    SREG = oldSREG;
+    return 1;
+  }
+  transaction->status = TWI_PENDING;
+  queue[queueHead] = transaction;
+  queueHead = next;
+  if(TWI_READY == twi_state)
+    startQueued();
+  SREG = oldSREG;
+  return 0;
+}
+
+/*
+ * Function readRegisters
+ * Desc     burst read of consecutive registers in one transaction, the register
+ *          write and a repeated start then length bytes, in place of a
+ *          transaction per register. The device must auto increment its register
+ *          address, ST parts need the top bit of reg set for that. Blocks until done,
+ *          waiting first for a free queue slot if the queue is full, as claimBus waits
+ * Input    address: 7bit i2c device address
+ *          reg: first register
+ *          data: pointer to byte array
+ *          length: number of bytes to read, at least 1
+ * Output   TWI_SUCCESS or the error of the transaction
+ */
+uint8_t TwoWire::readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length)
+{
+  TWITransaction transaction;
+  transaction.address = address;
+  transaction.type = TWI_XFER_REGISTER_READ;
+  transaction.reg = reg;
+  transaction.data = data;
+  transaction.length = length;
+  transaction.service = NULL;
+  // the interrupt frees a slot as each queued transaction completes
+  while(queueTransaction(&transaction)){
+    continue;
+  }
+  while(TWI_PENDING == transaction.status){
+    continue;
+  }
+  return transaction.status;
+}
+
+/*
+ * Function startQueued
+ * Desc     puts the oldest queued transaction on the bus with a start condition,
+ *          interrupts off and the bus free
+ * Input    none
+ * Output   none
+ */
+void TwoWire::startQueued(void)
+{
+  if(queueTail == queueHead) {
+    current = NULL;
+    return;
+  }
+  TWITransaction* transaction = queue[queueTail];
+  queueTail = (queueTail + 1) & (TWI_QUEUE_LENGTH - 1);
+  transaction->index = 0;
+  transaction->regSent = 0;
+  current = transaction;
+  if(TWI_XFER_READ == transaction->type) {
+    twi_state = TWI_MRX;
+    twi_slarw = TW_READ | (transaction->address << 1);
+  } else {
+    twi_state = TWI_MTX;
+    twi_slarw = TW_WRITE | (transaction->address << 1);
+  }
+  TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA);
+}
+
+/*
+ * Function serviceTransaction
+ * Desc     moves the queued transaction on the bus along from the TWI status,
+ *          finishing it on the last byte or an error, then starts the next
+ * Input    status: TW_STATUS
+ * Output   0 .. not a master status, nothing done
+ *          1 .. handled
+ */
+uint8_t TwoWire::serviceTransaction(uint8_t status)
+{
+  TWITransaction* transaction = current;
+  uint8_t result = TWI_PENDING;
+  switch(status) {
+    case TW_START:
+    case TW_REP_START:
+      TWDR = twi_slarw;
+      twi_reply(1);
+      return 1;
+    case TW_MT_SLA_ACK:
+    case TW_MT_DATA_ACK:
+      if(!transaction->regSent && TWI_XFER_READ != transaction->type) {
+        transaction->regSent = 1;
+        TWDR = transaction->reg;
+        twi_reply(1);
+        return 1;
+      }
+      if(TWI_XFER_REGISTER_READ == transaction->type) {
+        // register sent, turn the bus around with a repeated start
+        twi_state = TWI_MRX;
+        twi_slarw = TW_READ | (transaction->address << 1);
+        TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA);
+        return 1;
+      }
+      if(transaction->index < transaction->length) {
+        TWDR = transaction->data[transaction->index++];
+        twi_reply(1);
+        return 1;
+      }
+      result = TWI_SUCCESS;
+      break;
+    case TW_MR_SLA_ACK:
+      // ack the bytes before the last, nack the last
+      twi_reply(transaction->length > 1);
+      return 1;
+    case TW_MR_DATA_ACK:
+      transaction->data[transaction->index++] = TWDR;
+      twi_reply(transaction->index < transaction->length - 1);
+      return 1;
+    case TW_MR_DATA_NACK:
+      transaction->data[transaction->index++] = TWDR;
+      result = TWI_SUCCESS;
+      break;
+    case TW_MT_SLA_NACK:
+    case TW_MR_SLA_NACK:
+      result = TWI_ADDRESS_NACK;
+      break;
+    case TW_MT_DATA_NACK:
+      result = TWI_DATA_NACK;
+      break;
+    case TW_MT_ARB_LOST:
+      twi_releaseBus();
+      result = TWI_BUS_FAULT;
+      break;
+    case TW_BUS_ERROR:
+      result = TWI_BUS_FAULT;
+      break;
+    default:
+      return 0;
+  }
+  if(TW_MT_ARB_LOST != status)
+    twi_stop();
+  current = NULL;
+  transaction->status = result;
+  if(transaction->service)
+    transaction->service->onComplete(transaction);
+  if(TWI_READY == twi_state)
+    startQueued();
+  return 1;
+}
+
 /* 
  * Function twi_transmit
  * Desc     fills tx buffer with data
@@ -368,7 +570,10 @@ void TwoWire::twi_releaseBus(void)
 
 ISR(TWI_vect)
 {
+  ISR_PROFILE_SCOPE(TWI_vect_num)
   //TWIService* service = Wire.getService(TWAR);
+  if(Wire.current && Wire.serviceTransaction(TW_STATUS))
+    return;
   TWIService* service = Wire.getService();
   switch(TW_STATUS){
     // All Master
@@ -390,29 +595,36 @@ ISR(TWI_vect)
         Wire.twi_reply(1);
       } else {
         Wire.twi_stop();
+        Wire.startQueued();
       }
       break;
     case TW_MT_SLA_NACK:  // address sent, nack received
       Wire.twi_error = TW_MT_SLA_NACK;
       Wire.twi_stop();
+      Wire.startQueued();
       break;
     case TW_MT_DATA_NACK: // data sent, nack received
       Wire.twi_error = TW_MT_DATA_NACK;
       Wire.twi_stop();
+      Wire.startQueued();
       break;
     case TW_MT_ARB_LOST: // lost bus arbitration
       Wire.twi_error = TW_MT_ARB_LOST;
       Wire.twi_releaseBus();
+      Wire.startQueued();
       break;
 	  
     // Master Receiver
 	case TW_MR_SLA_ACK:  // address sent, ack received
 	  Wire.twi_state = TWI_MRX;
+      // ack if more than one byte is expected, otherwise nack the only one
+      Wire.twi_reply(service->rxBufferLength > 1);
+      break;
     case TW_MR_DATA_ACK: // data received, ack sent
       // put byte into buffer
       service->addRx(TWDR);
-      // ack if more bytes are expected, otherwise nack
-      if(service->rxBufferIndex < service->rxBufferLength){
+      // ack if more bytes are expected after the next, otherwise nack the next
+      if(service->rxBufferIndex < service->rxBufferLength - 1){
         Wire.twi_reply(1);
       } else {
         Wire.twi_reply(0);
@@ -423,6 +635,7 @@ ISR(TWI_vect)
       service->addRx(TWDR);
     case TW_MR_SLA_NACK: // address sent, nack received
       Wire.twi_stop();
+      Wire.startQueued();
       break;
 	  
     // TW_MR_ARB_LOST handled by TW_MT_ARB_LOST case
@@ -495,6 +708,7 @@ ISR(TWI_vect)
     case TW_BUS_ERROR: // bus error, illegal stop/start
       Wire.twi_error = TW_BUS_ERROR;
       Wire.twi_stop();
+      Wire.startQueued();
       break;
   }
 }
@@ -0,0 +1,82 @@
+/*
+ * TwoWire.h
+ * TWI (I2C) master and slave on the ATmega TWI unit, with a TWIService per device address holding its buffers.
+ * The Wiring style calls, beginTransmission/send/endTransmission and requestFrom/receive, block the caller until the bus
+ * transaction is done. For sensors read every loop there is also a queue of TWITransaction descriptors, see TWIService.h,
+ * started one after another from the TWI interrupt, so the bus runs while the main loop carries on with commands, and
+ * each completion is handed to the onComplete of the service in the descriptor.
+ * Blocking calls wait for the queue to drain before taking the bus, and queued transactions wait for a blocking call to finish.
+ * The tree had TwoWire.cpp but not this header, it is a reconstruction from TwoWire.cpp and the sources that include it.
+ * Created: 10/18/2026 6:42:51 PM
+ * Author: jg
+ */
+#ifndef TWOWIRE_H_
+#define TWOWIRE_H_
+#include <inttypes.h>
+#include "Arduino.h"
+#include "TWIService.h"
+
+#define CPU_FREQ F_CPU
+// SCL standard mode and fast mode, the IMU parts all run at 400kHz
+#define TWI_STANDARD_FREQ 100000L
+#define TWI_FAST_FREQ 400000L
+#ifndef TWI_FREQ
+#define TWI_FREQ TWI_FAST_FREQ
+#endif
+#define TWI_BUFFER_LENGTH 32
+// Transactions waiting for the bus, power of 2
+#define TWI_QUEUE_LENGTH 8
+
+// twi_state
+#define TWI_READY 0
+#define TWI_MRX   1
+#define TWI_MTX   2
+#define TWI_SRX   3
+#define TWI_STX   4
+
+class TwoWire {
+	private:
+	static TWITransaction* queue[TWI_QUEUE_LENGTH];
+	static volatile uint8_t queueHead;
+	static volatile uint8_t queueTail;
+	static uint8_t twi_readFrom(uint8_t address, uint8_t length);
+	static uint8_t twi_writeTo(uint8_t address, uint8_t length, uint8_t wait);
+	static uint8_t twi_transmit(uint8_t* data, uint8_t length);
+	static void claimBus(uint8_t state);
+	public:
+	static TWIService* deviceService[255];
+	static uint8_t numService;
+	static volatile uint8_t twi_state;
+	static uint8_t twi_slarw;
+	static uint8_t twi_init;
+	static volatile uint8_t twi_error;
+	static uint8_t transmitting;
+	static TWITransaction* volatile current; // queued transaction on the bus, NULL for none or a blocking one
+	TwoWire();
+	TWIService* getService(uint8_t tdevice);
+	TWIService* getService(void);
+	void begin(void);
+	void begin(uint8_t address);
+	void setClock(uint32_t frequency);
+	uint8_t requestFrom(uint8_t address, uint8_t quantity);
+	void beginTransmission(uint8_t address);
+	uint8_t endTransmission(void);
+	void send(uint8_t data);
+	void send(uint8_t* data, uint8_t quantity);
+	uint8_t available(void);
+	uint8_t receive(void);
+	uint8_t queueTransaction(TWITransaction* transaction);
+	uint8_t readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length);
+	// true when nothing is on the bus or waiting for it
+	inline uint8_t isIdle(void) { return twi_state == TWI_READY && queueHead == queueTail; }
+	// interrupt context from here
+	static void startQueued(void);
+	static uint8_t serviceTransaction(uint8_t status);
+	static void twi_reply(uint8_t ack);
+	static void twi_stop(void);
+	static void twi_releaseBus(void);
+};
+
+extern TwoWire Wire;
+
+#endif /* TWOWIRE_H_ */
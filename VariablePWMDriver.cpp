@@ -25,15 +25,12 @@
 
 int VariablePWMDriver::commandEmergencyStop(int status) {
 	for(int j=0; j < 10; j++) {
-		int pindex = pwmDrive[j][0];
-		if(pindex != 255) {
-				pdigitals[pindex]->digitalWrite(LOW);
+		if( enablePin[j] ) {
+			enablePin[j]->fastWrite(LOW);
 		}
-		pindex = pwmDrive[j][0];
+		int pindex = pwmDrive[j][0];
 		if(pindex != 255) {
-			ppwms[pindex]->init(ppwms[pindex]->pin);
-			ppwms[pindex]->setPWMPrescale(pwmDrive[j][2]);
-			ppwms[pindex]->setPWMResolution(pwmDrive[j][3]);
+			// turning off the output needs no timer setup, pwmOff drives the pin low and disconnects the compare output
 			ppwms[pindex]->pwmOff();
 		}
 	}
@@ -49,16 +46,18 @@ int VariablePWMDriver::commandEmergencyStop(int status) {
 * enable_pin - the enable pin for this channel. Assumed that low is disabled, high is enable.
 * timer_pre - timer prescale default 1 = no prescale
 * timer_res - timer resolution in bits - default 8
+* Returns the timer claim status, TIMER_CLAIM_NEGOTIATED if the timer of the pin already runs another configuration,
+* which the channel then shares as is.
 */
-void  VariablePWMDriver::createPWM(uint8_t channel, uint8_t pin_number, uint8_t enable_pin, int timer_pre, int timer_res) {
+uint8_t VariablePWMDriver::createPWM(uint8_t channel, uint8_t pin_number, uint8_t enable_pin, int timer_pre, int timer_res) {
 	// Attempt to assign PWM pin, lock to 8 bits no prescale, mode 2 CTC
 	if( getChannels() < channel ) setChannels(channel);
 	int foundPin = 0;
-	Digital* dpin;
+	Digital* dpin = NULL;
 	if( assignPin(pin_number) ) {
 		// Set up the digital enable pin, we want to be able to re-use these pins for multiple channels on 1 controller	
 		if( assignPin(enable_pin) ) {
-			Digital* dpin = new Digital(enable_pin);
+			dpin = new Digital(enable_pin);
 			dpin->pinMode(OUTPUT);
 			for(int i = 0; i < 10; i++) {
 				if(!pdigitals[i]) {
@@ -69,18 +68,18 @@ void  VariablePWMDriver::createPWM(uint8_t channel, uint8_t pin_number, uint8_t
 			}
 			if(!foundPin) {
 				delete dpin;
-				return; // no slots?
+				return TIMER_CLAIM_OK; // no slots?
 			}
 		} else { // cant assign, it may be already assigned
 			for(int i = 0; i < 10; i++) {
-				if(pdigitals[i]->pin == enable_pin) {
-					//dpin = pdigitals[i];
+				if(pdigitals[i] && pdigitals[i]->pin == enable_pin) {
+					dpin = pdigitals[i];
 					foundPin = 1;
 					break;
 				}
 			}
 			if(!foundPin) {
-					return; // slots full...
+					return TIMER_CLAIM_OK; // slots full...
 			}
 		}
 		// find slot for new PWM pin and init
@@ -90,16 +89,21 @@ void  VariablePWMDriver::createPWM(uint8_t channel, uint8_t pin_number, uint8_t
 			break;
 		}
 		if( ppwms[pindex] ) // already assigned, slots full
-			return;
+			return TIMER_CLAIM_OK;
+		PWM* ppin = new PWM(pin_number);
+		ppin->init(pin_number);
+		// share a timer already running for someone else at their configuration rather than disturb it
+		uint8_t claim = ppin->claimTimer(TIMER_OWNER_PWM_DRIVER, timer_pre, timer_res, 0, 0, 1);
 				
 		pwmDrive[channel-1][0] = pindex;
 		pwmDrive[channel-1][1] = enable_pin;
+		enablePin[channel-1] = dpin;
 		pwmDrive[channel-1][2] = timer_pre;
 		pwmDrive[channel-1][3] = timer_res;
-		PWM* ppin = new PWM(pin_number);
 		ppwms[pindex] = ppin;
-		ppwms[pindex]->init(pin_number);
+		return claim;
 	}
+	return TIMER_CLAIM_OK;
 }
 /*
 * Command the driver power level. Manage enable pin. If necessary limit min and max power and
@@ -116,15 +120,10 @@ int VariablePWMDriver::commandPWMLevel(uint8_t pwmChannel, int16_t pwmPower) {
 	int foundPin = 0;
 	pwmPower += 1000;
 	pwmLevel[pwmChannel-1] = pwmPower;
-	// get mapping of channel to pin
-	for(int i = 0; i < 10; i++) {
-		if(pdigitals[i] && pdigitals[i]->pin ==  pwmDrive[pwmChannel-1][1]) {
-				//pdigitals[i]->setPin(motorDrive[motorChannel-1][1]);
-				pdigitals[i]->pinMode(OUTPUT);
-				pdigitals[i]->digitalWrite(HIGH);
-				foundPin = 1;
-				break;
-		}
+	// set enable pin resolved in createPWM
+	if( enablePin[pwmChannel-1] ) {
+		enablePin[pwmChannel-1]->fastWrite(HIGH);
+		foundPin = 1;
 	}
 	if(!foundPin) {
 		return commandEmergencyStop(7);
@@ -146,12 +145,9 @@ int VariablePWMDriver::commandPWMLevel(uint8_t pwmChannel, int16_t pwmPower) {
 	int timer_res = pwmDrive[pwmChannel-1][3]; // timer resolution in bits from M3
 	// element 0 of motorDrive has index to PWM array
 	int pindex = pwmDrive[pwmChannel-1][0];
-	// writing power 0 sets mode 0 and timer turnoff
-	ppwms[pindex]->init(ppwms[pindex]->pin);
-	ppwms[pindex]->setPWMPrescale(timer_pre);
-	ppwms[pindex]->setPWMResolution(timer_res);
+	// writing power 0 sets mode 0 and timer turnoff, otherwise the timer is only reprogrammed if prescale or resolution changed
 	//ppwms[pindex]->attachInterrupt(motorDurationService[motorChannel-1]);// last param TRUE indicates an overflow interrupt
-	ppwms[pindex]->pwmWrite(pwmPower, timer_mode);
+	ppwms[pindex]->pwmWrite(pwmPower, timer_pre, timer_res, timer_mode);
 	fault_flag = 0;
 	return 0;
 }
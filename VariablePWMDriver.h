@@ -45,7 +45,7 @@ public:
 	void setMaxPWMLevel(int p) { MAXPWMLEVEL = p; }
 	uint8_t getPWMLevelPin(uint8_t channel) { return pwmDrive[channel-1][0]; }
 	uint8_t getPWMEnablePin(uint8_t channel) {return pwmDrive[channel-1][1]; }
-	void createPWM(uint8_t channel, uint8_t pin_number, uint8_t enable_pin, int timer_pre, int timer_res);
+	uint8_t createPWM(uint8_t channel, uint8_t pin_number, uint8_t enable_pin, int timer_pre, int timer_res);
 	void getDriverInfo(uint8_t ch, char* outStr);
 	int queryFaultFlag(void) { return fault_flag; }
 	int queryStatusFlag(void) { return status_flag; }
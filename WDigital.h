@@ -12,11 +12,31 @@ class Digital {
 	public:
 	uint8_t pin;
 	uint8_t mode = INPUT; // default
+	// Port handles resolved once from the pin tables for fastWrite, byte wide as the ports are 8 bits
+	volatile uint8_t* outReg = NULL;
+	volatile uint8_t* inReg = NULL;
+	uint8_t bitMask = 0;
 	Digital(uint8_t spin) {
-		this->pin = spin;
+		setPin(spin);
 	}
 	
-void setPin(uint8_t spin) { this->pin = spin; }
+void setPin(uint8_t spin) { 
+	this->pin = spin;
+	uint8_t port = digitalPinToPort(spin);
+	if (port == NOT_A_PIN) return;
+	outReg = (volatile uint8_t*)portOutputRegister(port);
+	inReg = (volatile uint8_t*)portInputRegister(port);
+	bitMask = digitalPinToBitMask(spin);
+}
+
+// Write a pin already set to OUTPUT that is never a PWM output, such as a direction or enable pin, without the table
+// lookups, timer check and interrupt lock of digitalWrite. If the level has to change, the bit is toggled by writing it to
+// the PINx register, a single store that leaves the rest of the port alone, as _TOGGLE in fastio.h, so it is atomic on every port.
+inline void fastWrite(uint8_t val)
+{
+	if( outReg && ((*outReg & bitMask) != 0) != (val != LOW) )
+		*inReg = bitMask;
+}
 	
 void pinMode(uint8_t pmode) {
 	this->mode = pmode;
@@ -7,6 +7,7 @@
  * Author: jg
  */ 
 #include "WHardwareTimer.h"
+#include "IsrProfile.h"
 
 // Compare Output Mode bits
 // For 16 bit timers
@@ -23,138 +24,164 @@
 
 ISR(TIMER0_COMPA_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER0_COMPA_vect_num, TCNT0, OCR0A)
   if (Timer0.compareMatchAFunction)
     (*Timer0.compareMatchAFunction).service();
 }
 ISR(TIMER0_COMPB_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER0_COMPB_vect_num, TCNT0, OCR0B)
   if (Timer0.compareMatchBFunction)
     (*Timer0.compareMatchBFunction).service();
 }
 ISR(TIMER0_OVF_vect)
 {
+  ISR_PROFILE_SCOPE(TIMER0_OVF_vect_num)
   if (Timer0.overflowFunction)
     (*Timer0.overflowFunction).service();
 }
 
 ISR(TIMER2_COMPA_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER2_COMPA_vect_num, TCNT2, OCR2A)
   if (Timer2.compareMatchAFunction)
     (*Timer2.compareMatchAFunction).service();
 }
 ISR(TIMER2_COMPB_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER2_COMPB_vect_num, TCNT2, OCR2B)
   if (Timer2.compareMatchBFunction)
    (*Timer2.compareMatchBFunction).service();
 }
 ISR(TIMER2_OVF_vect)
 {
+  ISR_PROFILE_SCOPE(TIMER2_OVF_vect_num)
   if (Timer2.overflowFunction)
     (*Timer2.overflowFunction).service();
 }
 
 ISR(TIMER1_COMPA_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER1_COMPA_vect_num, TCNT1, OCR1A)
   if (Timer1.compareMatchAFunction)
     (*Timer1.compareMatchAFunction).service();
 }
 ISR(TIMER1_COMPB_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER1_COMPB_vect_num, TCNT1, OCR1B)
   if (Timer1.compareMatchBFunction)
     (*Timer1.compareMatchBFunction).service();
 }
 
 ISR(TIMER1_COMPC_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER1_COMPC_vect_num, TCNT1, OCR1C)
   if (Timer1.compareMatchCFunction)
     (*Timer1.compareMatchCFunction).service();
 }
 
 ISR(TIMER1_OVF_vect)
 {
+  ISR_PROFILE_SCOPE(TIMER1_OVF_vect_num)
   if (Timer1.overflowFunction)
     (*Timer1.overflowFunction).service();
 }
 ISR(TIMER1_CAPT_vect)
 {
+  ISR_PROFILE_SCOPE(TIMER1_CAPT_vect_num)
   if (Timer1.captureEventFunction)
     (*Timer1.captureEventFunction).service();
 }
 
 ISR(TIMER3_COMPA_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER3_COMPA_vect_num, TCNT3, OCR3A)
   if (Timer3.compareMatchAFunction)
     (*Timer3.compareMatchAFunction).service();
 }
 ISR(TIMER3_COMPB_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER3_COMPB_vect_num, TCNT3, OCR3B)
   if (Timer3.compareMatchBFunction)
     (*Timer3.compareMatchBFunction).service();
 }
 ISR(TIMER3_COMPC_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER3_COMPC_vect_num, TCNT3, OCR3C)
   if (Timer3.compareMatchCFunction)
    (*Timer3.compareMatchCFunction).service();
 }
 ISR(TIMER3_OVF_vect)
 {
+  ISR_PROFILE_SCOPE(TIMER3_OVF_vect_num)
   if (Timer3.overflowFunction)
     (*Timer3.overflowFunction).service();
 }
 ISR(TIMER3_CAPT_vect)
 {
+  ISR_PROFILE_SCOPE(TIMER3_CAPT_vect_num)
   if (Timer3.captureEventFunction)
     (*Timer3.captureEventFunction).service();
 }
 
 ISR(TIMER4_COMPA_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER4_COMPA_vect_num, TCNT4, OCR4A)
   if (Timer4.compareMatchAFunction)
     (*Timer4.compareMatchAFunction).service();
 }
 ISR(TIMER4_COMPB_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER4_COMPB_vect_num, TCNT4, OCR4B)
   if (Timer4.compareMatchBFunction)
     (*Timer4.compareMatchBFunction).service();
 }
 ISR(TIMER4_COMPC_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER4_COMPC_vect_num, TCNT4, OCR4C)
   if (Timer4.compareMatchCFunction)
     (*Timer4.compareMatchCFunction).service();
 }
 ISR(TIMER4_OVF_vect)
 {
+  ISR_PROFILE_SCOPE(TIMER4_OVF_vect_num)
   if (Timer4.overflowFunction)
     (*Timer4.overflowFunction).service();
 }
 ISR(TIMER4_CAPT_vect)
 {
+  ISR_PROFILE_SCOPE(TIMER4_CAPT_vect_num)
   if (Timer4.captureEventFunction)
     (*Timer4.captureEventFunction).service();
 }
 
 ISR(TIMER5_COMPA_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER5_COMPA_vect_num, TCNT5, OCR5A)
   if (Timer5.compareMatchAFunction)
     (*Timer5.compareMatchAFunction).service();
 }
 ISR(TIMER5_COMPB_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER5_COMPB_vect_num, TCNT5, OCR5B)
   if (Timer5.compareMatchBFunction)
     (*Timer5.compareMatchBFunction).service();
 }
 ISR(TIMER5_COMPC_vect)
 {
+  ISR_PROFILE_LATE_SCOPE(TIMER5_COMPC_vect_num, TCNT5, OCR5C)
   if (Timer5.compareMatchCFunction)
     (*Timer5.compareMatchCFunction).service();
 }
 ISR(TIMER5_OVF_vect)
 {
+  ISR_PROFILE_SCOPE(TIMER5_OVF_vect_num)
   if (Timer5.overflowFunction)
     (*Timer5.overflowFunction).service();
 }
 ISR(TIMER5_CAPT_vect)
 {
+  ISR_PROFILE_SCOPE(TIMER5_CAPT_vect_num)
   if (Timer5.captureEventFunction)
     (*Timer5.captureEventFunction).service();
 }
@@ -182,6 +209,8 @@ HardwareTimer::HardwareTimer(uint8_t timerNumber)
       _ocrncl = NULL;
 	  
 	  _tifrn = &TIFR0;
+	  _icrnh = NULL;
+	  _icrnl = NULL;
 	  _tovrn = TOV0;
 	  _ocfna = OCF0A;
 	  _ocfnb = OCF0B;
@@ -211,6 +240,8 @@ HardwareTimer::HardwareTimer(uint8_t timerNumber)
       _ocrncl = &OCR1CL;
 	  
 	  _tifrn = &TIFR1;
+	  _icrnh = &ICR1H;
+	  _icrnl = &ICR1L;
 	  _tovrn = TOV1;
 	  _ocfna = OCF1A;
 	  _ocfnb = OCF1B;
@@ -240,6 +271,8 @@ HardwareTimer::HardwareTimer(uint8_t timerNumber)
       _ocrncl = NULL;
 	  
 	  _tifrn = &TIFR2;
+	  _icrnh = NULL;
+	  _icrnl = NULL;
 	  _tovrn = TOV2;
 	  _ocfna = OCF2A;
 	  _ocfnb = OCF2B;
@@ -269,6 +302,8 @@ HardwareTimer::HardwareTimer(uint8_t timerNumber)
       _ocrncl = &OCR3CL;
 	  
 	  _tifrn = &TIFR3;
+	  _icrnh = &ICR3H;
+	  _icrnl = &ICR3L;
 	  _tovrn = TOV3;
 	  _ocfna = OCF3A;
 	  _ocfnb = OCF3B;
@@ -298,6 +333,8 @@ HardwareTimer::HardwareTimer(uint8_t timerNumber)
       _ocrncl = &OCR4CL;
 	  
 	  _tifrn = &TIFR4;
+	  _icrnh = &ICR4H;
+	  _icrnl = &ICR4L;
 	  _tovrn = TOV4;
 	  _ocfna = OCF4A;
 	  _ocfnb = OCF4B;
@@ -327,6 +364,8 @@ HardwareTimer::HardwareTimer(uint8_t timerNumber)
       _ocrncl = &OCR5CL;
 	  
 	  _tifrn = &TIFR5;
+	  _icrnh = &ICR5H;
+	  _icrnl = &ICR5L;
 	  _tovrn = TOV5;
 	  _ocfna = OCF5A;
 	  _ocfnb = OCF5B;
@@ -342,6 +381,14 @@ HardwareTimer::HardwareTimer(uint8_t timerNumber)
       break;
   }
 
+  _mode = 0xFF; // unknown until setMode
+  _frequency = 0;
+  _top = 0;
+  for(uint8_t i = 0; i < 4; i++)
+    _owner[i] = TIMER_OWNER_NONE;
+  _claimMode = 0xFF;
+  _claimClock = CLOCK_STOP;
+  _claimFrequency = 0;
   setClockSource(CLOCK_STOP);
   
   if (_tcntnh != NULL)  // 16 bit timers
@@ -464,6 +511,7 @@ uint8_t HardwareTimer::setClockSource(uint8_t clockSource)
     }
   oldSource = (*_tccrnb & 0b00000111);
   *_tccrnb = (*_tccrnb & 0b11111000) | bits;
+  _clockSource = clockSource;
   return oldSource;
  
 }
@@ -607,6 +655,100 @@ void HardwareTimer::setMode(uint8_t mode)
   *_tccrna = (*_tccrna & 0b11111100) | (mode & 0b00000011);
   *_tccrnb = (*_tccrnb & 0b11100111) | ((mode & 0b00001100) << 1);
   SREG = oldSREG;
+  _mode = mode;
+  _frequency = 0; // TOP is fixed by a resolution mode until setFrequency says otherwise
+}
+
+/*
+* Run the timer at the given PWM frequency with TOP in ICRn, 16 bit timers only.
+* The smallest prescale that fits TOP in 16 bits is chosen, which gives the most duty resolution, TOP+1 steps in fast PWM
+* and TOP steps in phase correct. Fast PWM: f = F_CPU / (N * (1 + TOP)), phase correct: f = F_CPU / (2 * N * TOP).
+* At 16MHz and 20kHz that is prescale 1 with TOP 799 in fast PWM, or TOP 400 in phase correct.
+* Returns the frequency actually achieved, 0 if the timer cannot do it, in which case nothing is changed.
+*/
+uint32_t HardwareTimer::setFrequency(uint32_t frequency, uint8_t phaseCorrect)
+{
+  static const uint16_t prescale[5] = { 1, 8, 64, 256, 1024 };
+  static const uint8_t source[5] = { CLOCK_NO_PRESCALE, CLOCK_PRESCALE_8, CLOCK_PRESCALE_64, CLOCK_PRESCALE_256, CLOCK_PRESCALE_1024 };
+  if (_icrnh == NULL || frequency == 0)
+    return 0;
+  uint8_t i;
+  uint32_t top = 0;
+  for(i = 0; i < 5; i++) {
+    if (phaseCorrect)
+      top = F_CPU / (2UL * prescale[i] * frequency);
+    else
+      top = F_CPU / ((uint32_t)prescale[i] * frequency) - 1;
+    if (top <= 0xFFFF)
+      break;
+  }
+  if (i == 5 || top < 3)
+    return 0;
+  uint8_t mode = phaseCorrect ? MODE_PHASE_CORRECT_ICR : MODE_FAST_PWM_ICR;
+  setClockSource(CLOCK_STOP);
+  setTop((uint16_t)top);
+  setCounter(0);
+  setMode(mode);
+  setClockSource(source[i]);
+  if (phaseCorrect)
+    _frequency = F_CPU / (2UL * prescale[i] * top);
+  else
+    _frequency = F_CPU / ((uint32_t)prescale[i] * (top + 1));
+  return _frequency;
+}
+
+/*
+* Claim a channel of this timer, or the whole timer with STATE_OVFL, for an owner at the given configuration.
+* mode and clockSource are what setMode and setClockSource would be given, or if frequency is nonzero, mode is the ICR mode
+* and the frequency that setFrequency would be given replaces the clock source, which it computes.
+* The timer is shared by all its channels, so with no other channel claimed the caller gets the timer at its configuration.
+* If another channel is claimed, the same configuration is fine, a different one is rejected unless negotiate is set,
+* in which case the caller agrees to run at the configuration already in place. Nothing is programmed here,
+* the caller programs the timer on TIMER_CLAIM_OK and leaves it alone on TIMER_CLAIM_NEGOTIATED.
+* Reclaiming a channel, as when a driver is configured again, replaces its previous claim.
+*/
+uint8_t HardwareTimer::claim(uint8_t channel, uint8_t owner, uint8_t mode, uint8_t clockSource, uint32_t frequency, uint8_t negotiate)
+{
+  uint8_t shared = 0;
+  for(uint8_t i = 0; i < 4; i++) {
+    if (i != channel && _owner[i] != TIMER_OWNER_NONE)
+      shared = 1;
+  }
+  if (!shared) {
+    _owner[channel] = owner;
+    _claimMode = mode;
+    _claimClock = frequency ? CLOCK_STOP : clockSource;
+    _claimFrequency = frequency;
+    return TIMER_CLAIM_OK;
+  }
+  if (mode == _claimMode && frequency == _claimFrequency && (frequency || clockSource == _claimClock)) {
+    _owner[channel] = owner;
+    return TIMER_CLAIM_OK;
+  }
+  if (negotiate) {
+    _owner[channel] = owner;
+    return TIMER_CLAIM_NEGOTIATED;
+  }
+  return TIMER_CLAIM_CONFLICT;
+}
+/*
+* Release the claim on a channel, the configuration stays with the timer for the remaining owners.
+*/
+void HardwareTimer::release(uint8_t channel)
+{
+  _owner[channel] = TIMER_OWNER_NONE;
+}
+
+void HardwareTimer::setTop(uint16_t top)
+{
+  if (_icrnh == NULL)
+    return;
+  uint8_t oldSREG = SREG;
+  cli();
+  *_icrnh = top >> 8;
+  *_icrnl = top & 0x00ff;
+  SREG = oldSREG;
+  _top = top;
 }
 
 /*
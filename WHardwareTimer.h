@@ -33,11 +33,29 @@
 #define INTERRUPT_COMPARE_MATCH_C       3
 #define INTERRUPT_CAPTURE_EVENT         4
 
+// Waveform generation modes with TOP in ICRn, 16 bit timers only
+#define MODE_FAST_PWM_ICR               0b1110
+#define MODE_PHASE_CORRECT_ICR          0b1010
+
 #define CHANNEL_A                       0
 #define CHANNEL_B                       1
 #define CHANNEL_C                       2
 #define STATE_OVFL						3
 
+// Timer resource owners, the first claim on a timer sets its configuration and later claims must agree with it, see claim()
+#define TIMER_OWNER_NONE                0
+#define TIMER_OWNER_TIMEBASE            1 // millis/micros on Timer0, never reprogrammed
+#define TIMER_OWNER_MOTOR               2 // M3/M4 propulsion PWM
+#define TIMER_OWNER_PWM_DRIVER          3 // M9 variable PWM driver
+#define TIMER_OWNER_PWM                 4 // M45 free PWM pin
+#define TIMER_OWNER_SERVO               5 // servo pulse train, the whole timer in normal mode
+#define TIMER_OWNER_STEPPER             6 // stepper step interrupt, the whole timer in CTC mode
+#define TIMER_OWNER_PROFILE             7 // ISR_PROFILE clock, the whole timer free running in normal mode
+// Result of a claim
+#define TIMER_CLAIM_OK                  0 // timer is free, or already runs the requested configuration
+#define TIMER_CLAIM_NEGOTIATED          1 // timer is shared at the configuration of its current owner, do not reprogram it
+#define TIMER_CLAIM_CONFLICT            2 // timer runs a different configuration for another owner, request rejected
+
 ISR(TIMER0_COMPA_vect);
 ISR(TIMER0_COMPB_vect);
 ISR(TIMER0_OVF_vect);
@@ -121,6 +139,8 @@ class HardwareTimer : public virtual InterruptsBase
 	volatile uint8_t *_ocrnch;
 	volatile uint8_t *_ocrncl;
 	volatile uint8_t *_tifrn;
+	volatile uint8_t *_icrnh;
+	volatile uint8_t *_icrnl;
 	uint8_t _tovrn;
 	uint8_t _ocfna;
 	uint8_t _ocfnb;
@@ -130,6 +150,17 @@ class HardwareTimer : public virtual InterruptsBase
 	uint8_t _ocieb;
 	uint8_t _ociec;
 	uint8_t _icie;
+	// Last mode and clock source programmed, so callers can skip reprogramming an unchanged timer
+	uint8_t _mode;
+	uint8_t _clockSource;
+	// Frequency and TOP programmed by setFrequency, 0 if the timer runs at a fixed resolution
+	uint32_t _frequency;
+	uint16_t _top;
+	// Owner of each channel A,B,C and of the whole timer at STATE_OVFL, with the configuration the first owner claimed
+	uint8_t _owner[4];
+	uint8_t _claimMode;
+	uint8_t _claimClock;
+	uint32_t _claimFrequency;
 	// User interrupt handlers
 	InterruptService* overflowFunction;
 	InterruptService* compareMatchAFunction;
@@ -140,6 +171,19 @@ class HardwareTimer : public virtual InterruptsBase
 	public:
 	HardwareTimer(uint8_t timerNumber);
 	inline uint8_t getTimerNumber(void) { return _timerNumber; }
+	inline uint8_t getMode(void) { return _mode; }
+	inline uint8_t getClockSource(void) { return _clockSource; }
+	inline uint32_t getFrequency(void) { return _frequency; }
+	inline uint16_t getTop(void) { return _top; }
+	uint32_t setFrequency(uint32_t frequency, uint8_t phaseCorrect = 0);
+	void setTop(uint16_t top);
+	uint8_t claim(uint8_t channel, uint8_t owner, uint8_t mode, uint8_t clockSource, uint32_t frequency = 0, uint8_t negotiate = 0);
+	void release(uint8_t channel);
+	inline uint8_t getOwner(uint8_t channel) { return _owner[channel]; }
+	inline uint8_t getClaimMode(void) { return _claimMode; }
+	inline uint8_t getClaimClock(void) { return _claimClock; }
+	inline uint32_t getClaimFrequency(void) { return _claimFrequency; }
+	inline uint8_t getChannelCount(void) { return _channelCount; }
 	inline uint8_t stop(void) { return setClockSource(CLOCK_STOP); };
 	void stopChannel(uint8_t channel);
 	uint8_t setClockSource(uint8_t clockSource);
@@ -12,38 +12,57 @@
 
 #include "WInterrupts.h"
 #include "WInterruptService.h"
+#include "CounterInterruptService.h"
+#include "IsrProfile.h"
 
 InterruptService* services[EXTERNAL_NUM_INTERRUPTS];
+CounterInterruptService* counters[EXTERNAL_NUM_INTERRUPTS];
+// inlined into each vector with a constant index, a counter is incremented in place
+static inline void dispatch(uint8_t interruptNum) {
+	if( counters[interruptNum] )
+		counters[interruptNum]->count();
+	else if( services[interruptNum] )
+		services[interruptNum]->service();
+}
+
 ISR(INT0_vect) {
-	services[EXTERNAL_INT_0]->service();
+	ISR_PROFILE_SCOPE(INT0_vect_num)
+	dispatch(EXTERNAL_INT_0);
 }
 
 ISR(INT1_vect) {
-	services[EXTERNAL_INT_1]->service();
+	ISR_PROFILE_SCOPE(INT1_vect_num)
+	dispatch(EXTERNAL_INT_1);
 }
 
 ISR(INT2_vect) {
-	services[EXTERNAL_INT_2]->service();
+	ISR_PROFILE_SCOPE(INT2_vect_num)
+	dispatch(EXTERNAL_INT_2);
 }
 
 ISR(INT3_vect) {
-	services[EXTERNAL_INT_3]->service();
+	ISR_PROFILE_SCOPE(INT3_vect_num)
+	dispatch(EXTERNAL_INT_3);
 }
 
 ISR(INT4_vect) {
-	services[EXTERNAL_INT_4]->service();
+	ISR_PROFILE_SCOPE(INT4_vect_num)
+	dispatch(EXTERNAL_INT_4);
 }
 
 ISR(INT5_vect) {
-	services[EXTERNAL_INT_5]->service();
+	ISR_PROFILE_SCOPE(INT5_vect_num)
+	dispatch(EXTERNAL_INT_5);
 }
 
 ISR(INT6_vect) {
-	services[EXTERNAL_INT_6]->service();
+	ISR_PROFILE_SCOPE(INT6_vect_num)
+	dispatch(EXTERNAL_INT_6);
 }
 
 ISR(INT7_vect) {
-	services[EXTERNAL_INT_7]->service();
+	ISR_PROFILE_SCOPE(INT7_vect_num)
+	dispatch(EXTERNAL_INT_7);
 }
 
 	uint8_t Interrupts::attachInterrupt(InterruptService* userFunc, int mode) {
@@ -52,8 +71,20 @@ ISR(INT7_vect) {
 
 	void Interrupts::attachInterrupt(uint8_t interruptNum, InterruptService* userFunc, int mode) {
 		if(interruptNum < EXTERNAL_NUM_INTERRUPTS) {
-		services[interruptNum] = userFunc;
-    
+			counters[interruptNum] = NULL;
+			services[interruptNum] = userFunc;
+			setMode(interruptNum, mode);
+		}
+	}
+
+	void Interrupts::attachCounter(uint8_t interruptNum, CounterInterruptService* counter, int mode) {
+		if(interruptNum < EXTERNAL_NUM_INTERRUPTS) {
+			counters[interruptNum] = counter;
+			setMode(interruptNum, mode);
+		}
+	}
+
+	void Interrupts::setMode(uint8_t interruptNum, int mode) {
 		// Configure the interrupt mode (trigger on low input, any change, rising
 		// edge, or falling edge).  The mode constants were chosen to correspond
 		// to the configuration bits in the hardware register, so we simply shift
@@ -95,7 +126,6 @@ ISR(INT7_vect) {
 			EIMSK |= (1 << INT7);
 			break;
 		}
-		}
 	}
 
 
@@ -12,11 +12,18 @@
 #include "WInterruptService.h"
 
 	static uint8_t highInt = 0; 
+class CounterInterruptService;
+/*
+* INT0-INT7, one vector per pin with the edge selected in hardware. A CounterInterruptService attached with attachCounter
+* is counted inline in its vector with no virtual call, for encoders at tens of kHz.
+*/
 class Interrupts: public InterruptsBase {
 	private:
+	void setMode(uint8_t interruptNum, int mode);
 	public:
 	uint8_t attachInterrupt(InterruptService* userFunc, int mode);
 	void attachInterrupt(uint8_t interruptNum, InterruptService* userFunc, int mode);
+	void attachCounter(uint8_t interruptNum, CounterInterruptService* counter, int mode);
 	void detachInterrupt(uint8_t interruptNum);
 };
 
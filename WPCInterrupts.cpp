@@ -4,111 +4,128 @@
  * Created: 3/12/2014 3:17:27 AM
  *  Author: jg
  */
-#include "WPCInterrupts.h" 
+#include "WPCInterrupts.h"
+#include "IsrProfile.h"
+
+static PCintHandler PCintFunc[24];
+static void* PCintArg[24];
+volatile static uint8_t PCintLast[3];
+// pins of each port serviced on a rising and on a falling edge
+volatile static uint8_t PCintRising[3];
+volatile static uint8_t PCintFalling[3];
+volatile static uint8_t *PCport[3] = {&PINB,&PINJ,&PINK};
+// lowest set bit of a nibble
+static const uint8_t PCintLowBit[16] = {0,0,1,0,2,0,1,0,3,0,1,0,2,0,1,0};
+
+static void serviceHandler(void* arg) {
+	((InterruptService*)arg)->service();
+}
+
 uint8_t PCInterrupts::attachInterrupt(InterruptService* userFunc, int mode) { return 0; }
 /*
  * attach an interrupt to a specific pin using pin change interrupts.
  * mode is CHANGE, RISING, FALLING
  */
- void PCInterrupts::attachInterrupt(uint8_t pin, InterruptService* userFunc, int mode) {
+void PCInterrupts::attachInterrupt(uint8_t pin, InterruptService* userFunc, int mode) {
+	attach(pin, serviceHandler, userFunc, mode);
+}
+/*
+ * attach a plain function, called with arg from the ISR
+ */
+void PCInterrupts::attachInterrupt(uint8_t pin, PCintHandler handler, void* arg, int mode) {
+	attach(pin, handler, arg, mode);
+}
+
+void PCInterrupts::attach(uint8_t pin, PCintHandler handler, void* arg, int mode) {
   this->pin = pin;
   uint8_t bit = digitalPinToBitMask(pin);
   uint8_t port = digitalPinToPort(pin);
-  uint8_t slot;
   volatile uint16_t *pcmask = digitalPinToPCMSK(pin);
   uint8_t pcslot = digitalPinToPCMSKbit(pin);
     // map pin to PCIR register
   if (pcmask == ((uint16_t*)0)) { //not a valid pin for PCINT
     return;
-  } 
-  uint8_t sport;
+  }
+  uint8_t posi;
   if( pcmask == &PCMSK0 ) {// PCInt 7:0
-	sport = 1;
-	slot = pcslot;
-	PCintLast[0] = *portInputRegister(port);
+	posi = 0;
   } else {
 	if( pcmask == &PCMSK1 ) {// PCInt 15:8
-		sport = 2;
-		slot = 8 + pcslot;
-		PCintLast[1] = *portInputRegister(port);
+		posi = 1;
 	} else {
-		sport = 4; // PCInt 23:16
-		slot = 16 + pcslot;
-		PCintLast[2] = *portInputRegister(port);
+		posi = 2; // PCInt 23:16
 	}
   }
-
-  //for(uint8_t j = 0; j < 3; j++)
-	//if( pcmask == PCmsk[j] ) { 
-	//	slot = (j * 8) + pcslot; // 3 registers, 8 bits each, more or less...Arduino doesnt pin them all out, grr
-	//	PCintLast[j] = *PCport[j];
-	//}
-
-  PCintMode[slot] = mode;
-  PCintFunc[slot] = userFunc;
+  uint8_t slot = (posi * 8) + pcslot;
+  uint8_t edge = 1 << pcslot;
+  uint8_t oldSREG = SREG;
+  cli();
+  PCintLast[posi] = *portInputRegister(port);
+  PCintFunc[slot] = handler;
+  PCintArg[slot] = arg;
+  if( mode == RISING || mode == CHANGE )
+	PCintRising[posi] |= edge;
+  else
+	PCintRising[posi] &= ~edge;
+  if( mode == FALLING || mode == CHANGE )
+	PCintFalling[posi] |= edge;
+  else
+	PCintFalling[posi] &= ~edge;
   // set the mask
   *pcmask |= bit;
   // enable the interrupt, port bits are 0,1,2 (1,2,4) for PCMSKn
- 
-  sei();
-  PCICR |= sport;
+  PCICR |= (1 << posi);
+  SREG = oldSREG;
 }
 
 void PCInterrupts::detachInterrupt(uint8_t pin) {
   uint8_t bit = digitalPinToBitMask(pin);
-  uint8_t port = digitalPinToPort(pin);
   volatile uint16_t *pcmask = digitalPinToPCMSK(pin);
+  uint8_t pcslot = digitalPinToPCMSKbit(pin);
 
   // map pin to PCIR register
-  if (port == NOT_A_PORT) {
+  if (pcmask == ((uint16_t*)0)) {
     return;
-  } 
-
+  }
+  uint8_t posi = (pcmask == &PCMSK0) ? 0 : ((pcmask == &PCMSK1) ? 1 : 2);
+  uint8_t oldSREG = SREG;
+  cli();
   // disable the mask.
   *pcmask &= ~bit;
+  PCintRising[posi] &= ~(1 << pcslot);
+  PCintFalling[posi] &= ~(1 << pcslot);
   // if that's the last one, disable the interrupt.
   if (*pcmask == 0) {
-    PCICR &= ~(0x01 << port);
+    PCICR &= ~(1 << posi);
   }
+  SREG = oldSREG;
 }
 
 // common code for isr handler. "posi" is the PCINT number.
-static void PCint(uint8_t posi) {
-  uint8_t bit;
-  uint8_t curr;
-  uint8_t mask;
-  uint8_t pin;
-
+static inline void PCint(uint8_t posi) {
   // get the pin states for the indicated port.
-  curr = *(PCport[posi]);
-  //uint8_t port = digitalPinToPort(pin);
-  //curr = *portInputRegister(port);
-  mask = curr ^ PCintLast[posi];
+  uint8_t curr = *(PCport[posi]);
+  uint8_t mask = curr ^ PCintLast[posi];
   PCintLast[posi] = curr;
-  // mask is pins that have changed. screen out non pcint pins.
-  if ((mask &= *PCmsk[posi]) == 0) {
-    return;
-  }
-  // mask is pcint pins that have changed.
-  for (uint8_t i=0; i < 8; i++) {
-    bit = 0x01 << i;
-    if (bit & mask) {
-      pin = (posi * 8) + i;
-      // Trigger interrupt if mode is CHANGE, or if mode is RISING and
-      // the bit is currently high, or if mode is FALLING and bit is low.
-      if ((PCintMode[pin] == CHANGE || ((PCintMode[pin] == RISING) && (curr & bit)) || ((PCintMode[pin] == FALLING) && !(curr & bit)))) {
-        PCintFunc[pin]->service();
-      }
-    }
+  // mask is pins that have changed, keep those attached for this edge, high now for rising, low for falling.
+  mask &= (curr & PCintRising[posi]) | (~curr & PCintFalling[posi]);
+  while( mask ) {
+	uint8_t i = (mask & 0x0F) ? PCintLowBit[mask & 0x0F] : 4 + PCintLowBit[mask >> 4];
+	mask &= mask - 1;
+	uint8_t slot = (posi * 8) + i;
+	PCintFunc[slot](PCintArg[slot]);
   }
 }
 
 ISR(PCINT0_vect) {
+  ISR_PROFILE_SCOPE(PCINT0_vect_num)
   PCint(0);
 }
 ISR(PCINT1_vect) {
+  ISR_PROFILE_SCOPE(PCINT1_vect_num)
   PCint(1);
 }
 ISR(PCINT2_vect) {
+  ISR_PROFILE_SCOPE(PCINT2_vect_num)
   PCint(2);
-}
\ No newline at end of file
+}
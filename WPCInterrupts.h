@@ -3,7 +3,7 @@
  *
  * Created: 3/8/2014 12:27:33 AM
  *  Author: jg
- */ 
+ */
 
 #ifndef WPCINTERRUPTS_H_
 #define WPCINTERRUPTS_H_
@@ -16,21 +16,23 @@
  * must use some logic to actually implement a per-pin interrupt service.
  * look up PCMSK to determine ISR 0-3, port position and port. once we have those we can map the rest with macros
  * We make no attempt to ensure that the stated pin is set up as INPUT
+ * Attaching a pin sets its bit in the rising and falling edge masks of its port, both for CHANGE, so the ISR
+ * screens the changed bits by edge with two ANDs and services only what is left, lowest bit first.
+ * Each pin has a handler and argument, an InterruptService goes through a trampoline to its virtual service,
+ * a PCintHandler is called directly for the lowest cost.
+ * The vectors are scoped for ISR_PROFILE, M707 gives the count, total and longest cycles of PCINT0 to PCINT2 on the board.
  */
+typedef void (*PCintHandler)(void* arg);
 
-static int PCintMode[24];
-static InterruptService* PCintFunc[24];
-volatile static uint8_t PCintLast[3];
-volatile static const uint8_t *PCmsk[3]={&PCMSK0,&PCMSK1,&PCMSK2};
-volatile static const uint8_t *PCport[3] = {&PINB,&PINJ,&PINK};
-	
 class PCInterrupts: public InterruptsBase {
 	private:
+	void attach(uint8_t pin, PCintHandler handler, void* arg, int mode);
 	public:
 	uint8_t pin;
 	PCInterrupts(void){}
 	uint8_t attachInterrupt(InterruptService* userFunc, int mode);
 	void attachInterrupt(uint8_t pin, InterruptService* userFunc, int mode);
+	void attachInterrupt(uint8_t pin, PCintHandler handler, void* arg, int mode);
 	void detachInterrupt(uint8_t interruptNum);
 };
 
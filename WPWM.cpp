@@ -15,6 +15,13 @@
 		this->pin = spin;
 		pinModeOut();
 	}
+	/*
+	* Release the timer channel claim so the configuration can go to the next owner
+	*/
+	PWM::~PWM() {
+		if( timer && owner != TIMER_OWNER_NONE )
+			(*timer).release(channel);
+	}
 
 	void PWM::init(uint8_t spin) {
 	 this->pin = spin; 
@@ -87,6 +94,27 @@
 
 	}
 	/*
+	* Claim the timer channel of this pin for owner at the prescale and resolution, or at frequency hz if nonzero, see HardwareTimer::claim.
+	* With negotiate set a conflicting configuration is accepted as is and the pin writes against it from then on.
+	* Returns TIMER_CLAIM_OK, TIMER_CLAIM_NEGOTIATED or TIMER_CLAIM_CONFLICT, a pin not on a timer is always OK.
+	* ASSUMES INIT HAS BEEN CALLED.
+	*/
+	uint8_t PWM::claimTimer(uint8_t owner, uint8_t prescalar, uint8_t bitResolution, uint32_t hz, uint8_t phase, uint8_t negotiate) {
+		if( !timer )
+			return TIMER_CLAIM_OK;
+		phaseCorrect = phase;
+		uint8_t status;
+		if( hz )
+			status = (*timer).claim(channel, owner, phase ? MODE_PHASE_CORRECT_ICR : MODE_FAST_PWM_ICR, CLOCK_STOP, hz, negotiate);
+		else
+			status = (*timer).claim(channel, owner, getResolutionMode(bitResolution), prescalar, 0, negotiate);
+		if( status != TIMER_CLAIM_CONFLICT ) {
+			this->owner = owner;
+			negotiated = (status == TIMER_CLAIM_NEGOTIATED);
+		}
+		return status;
+	}
+	/*
 	* Sets up the PWM pin for interrupt service with a counter or its subclass.
 	* Sets the counter to 0, attaches the interrupt to be serviced each cycle.
 	* The channel is determined from the pin, however, if we want an overflow
@@ -193,27 +221,93 @@
 		}
 	}
 
-	void PWM::setPWMResolution(uint8_t bitResolution)
+	/*
+	* Write the duty cycle at the given prescale and resolution. The timer is only reprogrammed if its last
+	* programmed clock source or mode differ, so a power level change on a channel that is already running, the common case from G5,
+	* comes down to the compare output mode and the OCR write instead of init, prescale, resolution and write every time.
+	* A 0 value takes the normal path to turn the output off. ASSUMES INIT HAS BEEN CALLED ONCE FOR PIN ASSIGNMENT.
+	*/
+	void PWM::pwmWrite(uint16_t val, uint8_t prescalar, uint8_t bitResolution, uint8_t outputMode)
+	{
+		if( timer && val != 0 && !negotiated ) {
+			if( (*timer).getClockSource() != prescalar )
+				setPWMPrescale(prescalar);
+			if( (*timer).getMode() != getResolutionMode(bitResolution) )
+				setPWMResolution(bitResolution);
+		}
+		pwmWrite(val, outputMode);
+	}
+	/*
+	* Write the duty cycle as a fraction of fullScale against the TOP computed from the frequency set by setPWMFrequency,
+	* so the caller keeps its own command resolution whatever TOP the frequency gives. The timer is only reprogrammed
+	* if its mode no longer matches, as when another pin on the same timer changed it.
+	* ASSUMES INIT AND setPWMFrequency HAVE BEEN CALLED.
+	*/
+	void PWM::pwmWriteDuty(uint16_t duty, uint16_t fullScale, uint8_t outputMode)
+	{
+		if( timer && frequency && duty != 0 && !negotiated ) {
+			uint8_t mode = phaseCorrect ? MODE_PHASE_CORRECT_ICR : MODE_FAST_PWM_ICR;
+			if( (*timer).getMode() != mode || !(*timer).getFrequency() )
+				(*timer).setFrequency(frequency, phaseCorrect);
+			if( duty > fullScale )
+				duty = fullScale;
+			duty = ((uint32_t)duty * (*timer).getTop()) / fullScale;
+			if( !duty ) // below one step of TOP, hold the minimum pulse rather than turn off
+				duty = 1;
+		}
+		pwmWrite(duty, outputMode);
+	}
+	/*
+	* Set an exact PWM frequency for the timer of this pin, 16 bit timers only.
+	* Returns the frequency achieved, 0 if the timer cannot do it and the pin stays on resolution and prescale.
+	*/
+	uint32_t PWM::setPWMFrequency(uint32_t hz, uint8_t phase)
+	{
+		phaseCorrect = phase;
+		frequency = 0;
+		if( !timer || !hz )
+			return 0;
+		uint32_t actual = (*timer).setFrequency(hz, phase);
+		if( actual )
+			frequency = hz;
+		return actual;
+	}
+	/*
+	* Timer mode for fast, or phase correct, PWM at given resolution on the timer for this pin
+	*/
+	uint8_t PWM::getResolutionMode(uint8_t bitResolution)
 	{
 		uint8_t mode = 0b0101; // fast 8 default
-		if( timer ) {
-			if( (*timer).getTimerNumber() == 2 ) {
-				mode = 0b0011; // fast 8 for timer 2
-			} else {
-				if (bitResolution == 9) // fast 9
-					mode = 0b0110;
-				else 
-					if (bitResolution == 10) // fast 10
-						mode = 0b0111;
-			}
-			(*timer).setMode(mode);
+		if( timer && (*timer).getTimerNumber() == 2 ) {
+			mode = phaseCorrect ? 0b0001 : 0b0011; // phase correct or fast 8 for timer 2
+		} else if( phaseCorrect ) {
+			mode = 0b0001; // phase correct 8
+			if (bitResolution == 9) // phase correct 9
+				mode = 0b0010;
+			else
+				if (bitResolution == 10) // phase correct 10
+					mode = 0b0011;
+		} else {
+			if (bitResolution == 9) // fast 9
+				mode = 0b0110;
+			else 
+				if (bitResolution == 10) // fast 10
+					mode = 0b0111;
+		}
+		return mode;
+	}
+
+	void PWM::setPWMResolution(uint8_t bitResolution)
+	{
+		if( timer && !negotiated ) {
+			(*timer).setMode(getResolutionMode(bitResolution));
 			(*timer).setOCR(channel,0);
 		}
 	}
 
 	void PWM::setPWMPrescale(uint8_t prescalar)
 	{
-		if( timer ) (*timer).setClockSource(prescalar);
+		if( timer && !negotiated ) (*timer).setClockSource(prescalar);
 	}
 	
 
@@ -14,14 +14,24 @@ class PWM {
 	public:
 	uint8_t pin;
 	uint8_t mode = OUTPUT;
-	HardwareTimer* timer;
+	HardwareTimer* timer = NULL;
 	uint8_t channel = 0;
 	InterruptService* interruptService=NULL;
+	uint32_t frequency = 0; // PWM frequency when the timer TOP is computed from it, 0 - fixed resolution and prescale
+	uint8_t phaseCorrect = 0; // phase correct instead of fast PWM
+	uint8_t owner = TIMER_OWNER_NONE; // owner of the timer channel claim, see HardwareTimer::claim
+	uint8_t negotiated = 0; // sharing the timer at another owner's configuration, never reprogram it
 	PWM(uint8_t spin);
+	~PWM();
+	uint8_t claimTimer(uint8_t owner, uint8_t prescalar, uint8_t bitResolution, uint32_t hz = 0, uint8_t phase = 0, uint8_t negotiate = 0);
 	void init(uint8_t spin);
 	void pwmWrite(uint16_t val, uint8_t outputMode = 0b10);
+	void pwmWrite(uint16_t val, uint8_t prescalar, uint8_t bitResolution, uint8_t outputMode);
 	inline void pwmOff() { pwmWrite(0, 0); };
+	void pwmWriteDuty(uint16_t duty, uint16_t fullScale, uint8_t outputMode = 0b10);
+	uint32_t setPWMFrequency(uint32_t hz, uint8_t phase = 0);
 	void setPWMResolution(uint8_t bitResolution);
+	uint8_t getResolutionMode(uint8_t bitResolution);
 	void setPWMPrescale(uint8_t prescalar);
 	void setCounter(int cntx);
 	int getCounter(void);
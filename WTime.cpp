@@ -0,0 +1,63 @@
+/*
+ * WTime.cpp
+ * Free running time base for the unified Wiring library. See WTime.h for the Timer0 configuration and its
+ * interaction with PWM pins 4 and 13.
+ * Created: 10/18/2026 9:02:14 AM
+ *  Author: jg
+ */
+#include "WTime.h"
+
+TimeBaseInterruptService timeBase;
+
+/*
+* Return milliseconds since timebase_init. 32 bit value, so it rolls over after about 49 days,
+* use unsigned differences of two readings to compute intervals and rollover is harmless.
+*/
+uint32_t TimeBaseInterruptService::getMillis(void)
+{
+	uint32_t m;
+	uint8_t oldSREG = SREG;
+	cli();
+	m = millisCount;
+	SREG = oldSREG;
+	return m;
+}
+/*
+* Return microseconds since timebase_init, resolution is 4 microseconds (one Timer0 tick at prescale 64).
+* If the overflow is pending but not yet serviced we account for it here, as Wiring does.
+*/
+uint32_t TimeBaseInterruptService::getMicros(void)
+{
+	uint32_t m;
+	uint8_t t;
+	uint8_t oldSREG = SREG;
+	cli();
+	m = overflowCount;
+	t = TCNT0;
+	if( (TIFR0 & _BV(TOV0)) && (t < 255) )
+		m++;
+	SREG = oldSREG;
+	return ((m << 8) + t) * (64 / clockCyclesPerMicrosecond());
+}
+
+/*
+* Start Timer0 in 8 bit fast PWM, prescale 64, and attach the overflow service.
+* Called once from setup before anything else can claim Timer0.
+*/
+void timebase_init(void)
+{
+	Timer0.claim(STATE_OVFL, TIMER_OWNER_TIMEBASE, 0b0011, CLOCK_PRESCALE_64);
+	Timer0.setMode(0b0011); // Fast PWM 8 bit, TOP 0xFF
+	Timer0.setClockSource(CLOCK_PRESCALE_64);
+	Timer0.attachInterrupt(INTERRUPT_OVERFLOW, &timeBase);
+}
+
+uint32_t millis(void)
+{
+	return timeBase.getMillis();
+}
+
+uint32_t micros(void)
+{
+	return timeBase.getMicros();
+}
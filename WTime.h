@@ -0,0 +1,60 @@
+/*
+ * WTime.h
+ * Free running time base for the unified Wiring library, the equivalent of millis() and micros() in the original Wiring.
+ * Timer0 is run in 8 bit fast PWM mode with a prescale of 64, exactly as Wiring does it, and an overflow interrupt service
+ * accumulates the elapsed time. At 16MHz the overflow occurs every 1024 microseconds, the extra 24 microseconds are carried
+ * as a fraction in 1/8 millisecond units and folded back into the millisecond count as they accumulate.
+ * IMPORTANT: Timer0 is shared with the PWM pins 4 and 13. The time base claims Timer0 at startup, so motor drivers are refused
+ * those pins and PWM pins and drivers assigned to them run at the time base configuration, 8 bit at about 976Hz, whatever they ask for.
+ * Created: 10/18/2026 9:02:14 AM
+ *  Author: jg
+ */
+
+
+#ifndef WTIME_H_
+#define WTIME_H_
+#include <inttypes.h>
+#include "Arduino.h"
+#include "WHardwareTimer.h"
+
+// the prescaler is set so that timer0 ticks every 64 clock cycles, and the overflow handler is called every 256 ticks.
+#define MICROSECONDS_PER_TIMER0_OVERFLOW (clockCyclesToMicroseconds(64 * 256))
+// the whole number of milliseconds per timer0 overflow
+#define MILLIS_INC (MICROSECONDS_PER_TIMER0_OVERFLOW / 1000)
+// the fractional number of milliseconds per timer0 overflow. we shift right by three to fit these numbers into a byte.
+#define FRACT_INC ((MICROSECONDS_PER_TIMER0_OVERFLOW % 1000) >> 3)
+#define FRACT_MAX (1000 >> 3)
+
+class TimeBaseInterruptService : public InterruptService {
+	private:
+	volatile uint32_t overflowCount;
+	volatile uint32_t millisCount;
+	volatile uint8_t millisFract;
+	public:
+	TimeBaseInterruptService(void) : overflowCount(0), millisCount(0), millisFract(0) {}
+	// Timer0 overflow, keep it short, we are in every loop of every other ISR's latency
+	void service(void)
+	{
+		uint32_t m = millisCount;
+		uint8_t f = millisFract;
+		m += MILLIS_INC;
+		f += FRACT_INC;
+		if( f >= FRACT_MAX ) {
+			f -= FRACT_MAX;
+			++m;
+		}
+		millisFract = f;
+		millisCount = m;
+		++overflowCount;
+	}
+	uint32_t getMillis(void);
+	uint32_t getMicros(void);
+};
+
+extern TimeBaseInterruptService timeBase;
+
+void timebase_init(void);
+uint32_t millis(void);
+uint32_t micros(void);
+
+#endif /* WTIME_H_ */
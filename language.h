@@ -33,6 +33,10 @@
 	#define motorFaultCntrlHdr "motorfault"
 	#define PWMFaultCntrlHdr "pwmfault"
 	#define batteryCntrlHdr "battery"
+	#define telemetryCntrlHdr "controllertelemetry"
+	#define stepperCntrlHdr "stepper"
+	#define imuCntrlHdr "imu"
+	#define imuCalibrationHdr "imucalibration"
 	#define digitalPinHdr "digitalpin"
 	#define analogPinHdr "analogpin"
 	#define digitalPinSettingHdr "digitalpinsetting"
@@ -44,6 +48,9 @@
 	#define pinSettingHdr "assignedpins"
 	#define controllerStatusHdr "controllerstatus"
 	#define eepromHdr "eeprom"
+	#define isrProfileHdr "isrprofile"
+	#define loopProfileHdr "loopprofile"
+	#define stepperProfileHdr "stepperprofile"
 		
 	// Message delimiters, quasi XML
 	#define MSG_BEGIN "<"
@@ -75,6 +82,13 @@
 	#define MSG_UNKNOWN_MCODE "Unknown M code "
 	#define MSG_BAD_MOTOR "Bad Motor command "
 	#define MSG_BAD_PWM "Bad PWM Driver command "
+	#define MSG_TIMER_CONFLICT "Timer in use by another owner, pin "
+	#define MSG_STEPPER_TIMER "Stepper timer in use by another owner "
+	#define MSG_BAD_STEPPER "Bad Stepper command, no stepper in slot "
+	#define MSG_STEPPER_FULL "Stepper planner full "
+	#define MSG_NO_BAROMETER "BMP085 not found "
+	#define MSG_NO_ISR_PROFILE "ISR profiling not compiled in, or its timer in use "
+	#define MSG_IMU_CALIBRATION "IMU calibration failed, too little range or too few samples "
 	
 	// These correspond to the controller faults return by 'queryFaultCode'
 	#define MSG_MOTORCONTROL_1 "Overheat"
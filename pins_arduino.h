@@ -118,6 +118,11 @@ static const uint8_t A15 = 69;
 ( (((p) >= 62) && ((p) <= 69)) ? ((p) - 62) : \
 0 ) ) ) ) ) )
 
+// External interrupt INTn on a pin, INT6 and INT7 are not brought out on the Mega
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ( (p) == 2 ? EXTERNAL_INT_4 : ( (p) == 3 ? EXTERNAL_INT_5 : \
+( (((p) >= 18) && ((p) <= 21)) ? (21 - (p)) : NOT_AN_INTERRUPT ) ) )
+
 const uint16_t PROGMEM port_to_mode_PGM[] = {
 	NOT_A_PORT,
 	(uint16_t) &DDRA,
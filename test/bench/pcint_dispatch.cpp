@@ -0,0 +1,171 @@
+/*
+ * pcint_dispatch.cpp
+ * Host timing of the pin change interrupt dispatch of WPCInterrupts.cpp, the loop over the 8 bits of the port from before
+ * 4a997be against the edge mask and lowest set bit dispatch from it, with the same pins attached and the same service behind them.
+ * Both dispatch routines are copies, PCintOld from 4a997be^ and PCintNew from WPCInterrupts.cpp, with the port and mask
+ * registers replaced by variables, keep PCintNew in step with the tree. The times are x86 ns per interrupt including the
+ * port toggle, the best of 5 runs, for the trend only. Cycles on the board come from M707 with ISR_PROFILE.
+ * Build and run with make pcint, see the Makefile.
+ * Created: 10/18/2026 11:20:41 PM
+ *  Author: jg
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define RUNS 5
+#define INTERRUPTS 20000000L
+
+class InterruptService {
+	public:
+	virtual void service(void) = 0;
+};
+class CountService : public InterruptService {
+	public:
+	volatile uint32_t count;
+	void service(void) { ++count; }
+};
+typedef void (*PCintHandler)(void* arg);
+
+// port input and PCMSK registers
+static volatile uint8_t PORT[3];
+static volatile uint8_t PCMSK[3];
+
+// before, a loop over the bits of the port testing the mode of each changed pin
+static volatile uint8_t *PCmsk[3] = {&PCMSK[0],&PCMSK[1],&PCMSK[2]};
+static volatile uint8_t *PCportOld[3] = {&PORT[0],&PORT[1],&PORT[2]};
+static int PCintMode[24];
+static InterruptService* PCintFuncOld[24];
+volatile static uint8_t PCintLastOld[3];
+
+__attribute__((noinline)) static void PCintOld(uint8_t posi) {
+  uint8_t bit;
+  uint8_t curr;
+  uint8_t mask;
+  uint8_t pin;
+  curr = *(PCportOld[posi]);
+  mask = curr ^ PCintLastOld[posi];
+  PCintLastOld[posi] = curr;
+  if ((mask &= *PCmsk[posi]) == 0) {
+    return;
+  }
+  for (uint8_t i=0; i < 8; i++) {
+    bit = 0x01 << i;
+    if (bit & mask) {
+      pin = (posi * 8) + i;
+      if ((PCintMode[pin] == CHANGE || ((PCintMode[pin] == RISING) && (curr & bit)) || ((PCintMode[pin] == FALLING) && !(curr & bit)))) {
+        PCintFuncOld[pin]->service();
+      }
+    }
+  }
+}
+
+// after, edge masks and the lowest set bit
+static PCintHandler PCintFunc[24];
+static void* PCintArg[24];
+volatile static uint8_t PCintLast[3];
+volatile static uint8_t PCintRising[3];
+volatile static uint8_t PCintFalling[3];
+static volatile uint8_t *PCport[3] = {&PORT[0],&PORT[1],&PORT[2]};
+static const uint8_t PCintLowBit[16] = {0,0,1,0,2,0,1,0,3,0,1,0,2,0,1,0};
+
+static void serviceHandler(void* arg) {
+	((InterruptService*)arg)->service();
+}
+
+__attribute__((noinline)) static void PCintNew(uint8_t posi) {
+  uint8_t curr = *(PCport[posi]);
+  uint8_t mask = curr ^ PCintLast[posi];
+  PCintLast[posi] = curr;
+  mask &= (curr & PCintRising[posi]) | (~curr & PCintFalling[posi]);
+  while( mask ) {
+	uint8_t i = (mask & 0x0F) ? PCintLowBit[mask & 0x0F] : 4 + PCintLowBit[mask >> 4];
+	mask &= mask - 1;
+	uint8_t slot = (posi * 8) + i;
+	PCintFunc[slot](PCintArg[slot]);
+  }
+}
+
+// a plain PCintHandler, as a high rate encoder would attach
+static volatile uint32_t plainCount[8];
+static void countHandler(void* arg) {
+	++*(volatile uint32_t*)arg;
+}
+
+static CountService services[8];
+
+#define VERSION_OLD 0
+#define VERSION_NEW 1
+#define VERSION_DIRECT 2
+/*
+* Attach the pins of port 0 in the mask at mode, as attach in WPCInterrupts.cpp does for the new version and as it did for the old
+*/
+static void attachPins(uint8_t pins, int mode, int version) {
+	PCMSK[0] = pins;
+	PCintRising[0] = PCintFalling[0] = 0;
+	for(int i = 0; i < 8; i++) {
+		PCintMode[i] = mode;
+		PCintFuncOld[i] = &services[i];
+		if( version == VERSION_DIRECT ) {
+			PCintFunc[i] = countHandler;
+			PCintArg[i] = (void*)&plainCount[i];
+		} else {
+			PCintFunc[i] = serviceHandler;
+			PCintArg[i] = &services[i];
+		}
+		if( pins & (1 << i) ) {
+			if( mode != FALLING )
+				PCintRising[0] |= 1 << i;
+			if( mode != RISING )
+				PCintFalling[0] |= 1 << i;
+		}
+	}
+	PORT[0] = PCintLast[0] = PCintLastOld[0] = 0;
+}
+
+static double nanos(void) {
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+/*
+* Toggle the port by each pattern of toggles in turn, one interrupt per pattern, and report the best ns per interrupt of each version
+*/
+static void run(const char* name, uint8_t pins, int mode, const uint8_t* toggles, int ntoggles) {
+	double best[3];
+	for(int version = 0; version < 3; version++) {
+		best[version] = 1e9;
+		for(int r = 0; r < RUNS; r++) {
+			attachPins(pins, mode, version);
+			double start = nanos();
+			for(long k = 0; k < INTERRUPTS; k++) {
+				PORT[0] ^= toggles[k % ntoggles];
+				if( version == VERSION_OLD )
+					PCintOld(0);
+				else
+					PCintNew(0);
+			}
+			double elapsed = (nanos() - start) / INTERRUPTS;
+			if( elapsed < best[version] )
+				best[version] = elapsed;
+		}
+	}
+	printf("%-42s %6.2f %6.2f %6.2f\n", name, best[VERSION_OLD], best[VERSION_NEW], best[VERSION_DIRECT]);
+}
+
+int main(void) {
+	const uint8_t bit0[1] = {0x01};
+	const uint8_t bit7[1] = {0x80};
+	const uint8_t walk[8] = {0x01,0x02,0x04,0x08,0x10,0x20,0x40,0x80};
+	const uint8_t all[1] = {0xFF};
+	printf("%-42s %6s %6s %6s  ns/interrupt\n", "case", "old", "new", "direct");
+	run("1 pin RISING, toggling", 0x01, RISING, bit0, 1);
+	run("1 pin bit 7 RISING, toggling", 0x80, RISING, bit7, 1);
+	run("8 pins CHANGE, one changes each time", 0xFF, CHANGE, walk, 8);
+	run("8 pins RISING, all change together", 0xFF, RISING, all, 1);
+	run("1 pin CHANGE, 7 unattached also change", 0x01, CHANGE, all, 1);
+	return 0;
+}
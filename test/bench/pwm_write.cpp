@@ -0,0 +1,76 @@
+/*
+ * pwm_write.cpp
+ * Host timing of the PWM write a bridge driver does per power command, the G5 path, before and after 9f1dc22.
+ * Before, commandMotorPower reprogrammed the timer on every command with init, setPWMPrescale and setPWMResolution and then wrote
+ * the duty with pwmWrite. After, pwmWrite with the prescale and resolution only reprograms the timer when they differ from what it runs.
+ * Both sequences are the PWM and HardwareTimer code of the tree, built against the register stand ins in stub/, on pin 11, OC1A,
+ * at no prescale and 8 bits as M3 sets by default, with the power alternating between two levels as from a stream of G5.
+ * Besides the time, the OCR1A value seen after each sequence is checked so the two write the same duty.
+ * The times are x86 ns per command, the best of 5 runs, for the trend only. The whole G5 on the board, with the command parsing and
+ * the reply, is timed by M708 with LOOP_PROFILE.
+ * Build and run with make pwm, see the Makefile.
+ * Created: 10/19/2026 12:31:17 AM
+ *  Author: jg
+ */
+#include <stdio.h>
+#include <time.h>
+#include "WPWM.h"
+
+#define RUNS 5
+#define COMMANDS 5000000L
+#define PWM_PIN 11
+#define TIMER_PRE CLOCK_NO_PRESCALE
+#define TIMER_RES 8
+#define TIMER_MODE 2
+
+static double nanos(void) {
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void writeBefore(PWM* pwm, uint16_t power) {
+	pwm->init(pwm->pin);
+	pwm->setPWMPrescale(TIMER_PRE);
+	pwm->setPWMResolution(TIMER_RES);
+	pwm->pwmWrite(power, TIMER_MODE);
+}
+
+static void writeAfter(PWM* pwm, uint16_t power) {
+	pwm->pwmWrite(power, TIMER_PRE, TIMER_RES, TIMER_MODE);
+}
+
+static double best(PWM* pwm, void (*write)(PWM*, uint16_t)) {
+	double fastest = 1e9;
+	for(int r = 0; r < RUNS; r++) {
+		double start = nanos();
+		for(long k = 0; k < COMMANDS; k++)
+			write(pwm, (k & 1) ? 100 : 200);
+		double elapsed = (nanos() - start) / COMMANDS;
+		if( elapsed < fastest )
+			fastest = elapsed;
+	}
+	return fastest;
+}
+
+int main(void) {
+	PWM pwm(PWM_PIN);
+	pwm.init(PWM_PIN);
+	if( pwm.claimTimer(TIMER_OWNER_MOTOR, TIMER_PRE, TIMER_RES) == TIMER_CLAIM_CONFLICT ) {
+		printf("timer claim refused\n");
+		return 1;
+	}
+	writeBefore(&pwm, 150);
+	uint8_t ocrBefore = OCR1AL;
+	writeAfter(&pwm, 150);
+	uint8_t ocrAfter = OCR1AL;
+	if( ocrBefore != ocrAfter || ocrAfter != 150 ) {
+		printf("duty differs, before %d after %d\n", ocrBefore, ocrAfter);
+		return 1;
+	}
+	double before = best(&pwm, writeBefore);
+	double after = best(&pwm, writeAfter);
+	printf("PWM write per power command, pin %d at prescale %d and %d bits\n", PWM_PIN, TIMER_PRE, TIMER_RES);
+	printf("before %6.2f ns  after %6.2f ns  %.1fx\n", before, after, before / after);
+	return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * stepper_profile.cpp
+ * Host comparison of the integer and float step interval profiles of AccelStepper, computeNewSpeedInteger against
+ * computeNewSpeedFloat, dry run through profileMove and profileStep as M709 does on the board. For each case it reports the steps
+ * and the planned move time of each profile and of the ideal trapezoid, the move time difference of the integer profile from the float,
+ * the largest difference of any one interval and the mean relative difference per step, and the host ns per step of each.
+ * The host ns are x86 and only show the trend, the computation time on the board comes from M709.
+ * With arguments maxSpeed acceleration steps every, the intervals of both profiles are printed every so many steps instead,
+ * along with the first and last few.
+ * Build and run with make profile, see the Makefile, AccelStepper.cpp is built from the tree against the stand ins in stub.
+ * Created: 10/18/2026 11:48:02 PM
+ *  Author: jg
+ */
+#include <stdio.h>
+#include <time.h>
+#include "AccelStepper.h"
+
+#define TIMING_REPEATS 20
+
+struct ProfileCase {
+	float maxSpeed;
+	float acceleration;
+	long steps;
+};
+
+static const ProfileCase cases[] = {
+	{500, 400, 1000}, {500, 400, 20000}, {1000, 2000, 5000}, {2000, 1000, 20000},
+	{4000, 8000, 20000}, {8000, 20000, 50000}, {100, 50, 2000}, {40, 20, 500}
+};
+
+static void noStep(void) {}
+
+static double nanos(void) {
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+/*
+* Move time in microseconds of the trapezoid, or triangle, the profiles approximate
+*/
+static double idealMicros(const ProfileCase* c) {
+	double rampSteps = (double)c->maxSpeed * c->maxSpeed / (2.0 * c->acceleration);
+	double seconds;
+	if( 2.0 * rampSteps >= c->steps )
+		seconds = 2.0 * sqrt(c->steps / c->acceleration);
+	else
+		seconds = 2.0 * c->maxSpeed / c->acceleration + (c->steps - 2.0 * rampSteps) / c->maxSpeed;
+	return seconds * 1e6;
+}
+/*
+* Host ns per step of one profile over TIMING_REPEATS dry runs
+*/
+static double nanosPerStep(const ProfileCase* c, bool integer) {
+	AccelStepper stepper(noStep, noStep);
+	stepper.setMaxSpeed(c->maxSpeed);
+	stepper.setAcceleration(c->acceleration);
+	long steps = 0;
+	double start = nanos();
+	for(int r = 0; r < TIMING_REPEATS; r++) {
+		unsigned long interval = stepper.profileMove(c->steps, integer);
+		while( interval ) {
+			interval = stepper.profileStep(integer);
+			++steps;
+		}
+	}
+	return (nanos() - start) / steps;
+}
+
+static void compare(const ProfileCase* c) {
+	AccelStepper integer(noStep, noStep), floating(noStep, noStep);
+	integer.setMaxSpeed(c->maxSpeed);
+	integer.setAcceleration(c->acceleration);
+	floating.setMaxSpeed(c->maxSpeed);
+	floating.setAcceleration(c->acceleration);
+	unsigned long intervalI = integer.profileMove(c->steps, true);
+	unsigned long intervalF = floating.profileMove(c->steps, false);
+	double moveI = 0, moveF = 0, maxDiff = 0, maxRel = 0, sumRel = 0;
+	long stepsI = 0, stepsF = 0, maxStep = 0, both = 0;
+	while( intervalI || intervalF ) {
+		if( intervalI && intervalF ) {
+			double diff = fabs((double)intervalI - (double)intervalF);
+			double rel = diff / intervalF;
+			if( diff > maxDiff ) {
+				maxDiff = diff;
+				maxRel = rel;
+				maxStep = both;
+			}
+			sumRel += rel;
+			++both;
+		}
+		if( intervalI ) {
+			moveI += intervalI;
+			++stepsI;
+			intervalI = integer.profileStep(true);
+		}
+		if( intervalF ) {
+			moveF += intervalF;
+			++stepsF;
+			intervalF = floating.profileStep(false);
+		}
+	}
+	printf("%6.0f %6.0f %6ld | %6ld %6ld | %10.0f %10.0f %10.0f | %+6.2f | %6.0f@%ld (%.1f%%) | %5.2f | %3.0f %3.0f\n",
+		c->maxSpeed, c->acceleration, c->steps, stepsI, stepsF, moveI, moveF, idealMicros(c),
+		100.0 * (moveI - moveF) / moveF, maxDiff, maxStep, 100.0 * maxRel, both ? 100.0 * sumRel / both : 0.0,
+		nanosPerStep(c, true), nanosPerStep(c, false));
+}
+
+static void trace(float maxSpeed, float acceleration, long steps, long every) {
+	AccelStepper integer(noStep, noStep), floating(noStep, noStep);
+	integer.setMaxSpeed(maxSpeed);
+	integer.setAcceleration(acceleration);
+	floating.setMaxSpeed(maxSpeed);
+	floating.setAcceleration(acceleration);
+	unsigned long intervalI = integer.profileMove(steps, true);
+	unsigned long intervalF = floating.profileMove(steps, false);
+	printf("step integer(us) float(us)\n");
+	for(long k = 0; intervalI || intervalF; k++) {
+		if( k % every == 0 || k < 5 || k >= steps - 5 )
+			printf("%ld %lu %lu\n", k, intervalI, intervalF);
+		if( intervalI )
+			intervalI = integer.profileStep(true);
+		if( intervalF )
+			intervalF = floating.profileStep(false);
+	}
+}
+
+int main(int argc, char** argv) {
+	if( argc == 5 ) {
+		long every = atol(argv[4]);
+		trace(atof(argv[1]), atof(argv[2]), atol(argv[3]), every > 0 ? every : 1);
+		return 0;
+	}
+	printf("maxSpeed accel  steps | stepsI stepsF |   moveI(us)  moveF(us)  ideal(us) | I-F %%  | max interval diff(us)@step | mean %% | ns I F\n");
+	for(unsigned int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+		compare(&cases[i]);
+	return 0;
+}
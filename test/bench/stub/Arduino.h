@@ -0,0 +1,32 @@
+/*
+ * Arduino.h
+ * Host stand in for the Arduino.h of the tree, just what the tree sources built by the host benchmarks use.
+ * Created: 10/18/2026 11:48:02 PM
+ *  Author: jg
+ */
+#ifndef ARDUINO_H_
+#define ARDUINO_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <math.h>
+#include <avr/pgmspace.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+#define F_CPU 16000000UL
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+#define clockCyclesToMicroseconds(a) ((a) / clockCyclesPerMicrosecond())
+#define microsecondsToClockCycles(a) ((a) * clockCyclesPerMicrosecond())
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define min(a,b) ((a)<(b)?(a):(b))
+static inline void _delay_us(double us) {}
+#endif /* ARDUINO_H_ */
@@ -0,0 +1 @@
+// Host stand in for RoboCore.h, the benchmarks need none of it
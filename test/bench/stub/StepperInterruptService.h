@@ -0,0 +1,14 @@
+/*
+ * StepperInterruptService.h
+ * Host stand in for the StepperInterruptService.h of the tree, the part AccelStepper.cpp uses. STEPPER_MAX_RATE,
+ * STEPPER_MIN_RATE, mulU24X24toH16 and calcStepTimer are pulled out of Configuration_adv.h, StepperInterruptService.h
+ * and StepperInterruptService.cpp by the Makefile into stepper_extract.h, so the benchmark runs the code in the tree.
+ * Created: 10/18/2026 11:48:02 PM
+ *  Author: jg
+ */
+#ifndef STEPPERINTERRUPTSERVICE_H_
+#define STEPPERINTERRUPTSERVICE_H_
+#include "Arduino.h"
+#include "speed_lookuptable.h"
+#include "stepper_extract.h"
+#endif /* STEPPERINTERRUPTSERVICE_H_ */
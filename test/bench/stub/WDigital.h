@@ -0,0 +1,16 @@
+/*
+ * WDigital.h
+ * Host stand in for the Digital pin class, the benchmarks never step a pin.
+ * Created: 10/18/2026 11:48:02 PM
+ *  Author: jg
+ */
+#ifndef WDIGITAL_H_
+#define WDIGITAL_H_
+class Digital {
+	public:
+	uint8_t pin;
+	Digital(uint8_t pin) { this->pin = pin; }
+	void pinMode(int mode) {}
+	void digitalWrite(int val) {}
+};
+#endif /* WDIGITAL_H_ */
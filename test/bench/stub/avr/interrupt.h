@@ -0,0 +1,12 @@
+/*
+ * avr/interrupt.h
+ * Host stand in, interrupts are a no op and a vector is a plain function.
+ * Created: 10/19/2026 12:31:17 AM
+ *  Author: jg
+ */
+#ifndef AVR_INTERRUPT_H_
+#define AVR_INTERRUPT_H_
+#define cli()
+#define sei()
+#define ISR(vector, ...) extern "C" void vector(void)
+#endif /* AVR_INTERRUPT_H_ */
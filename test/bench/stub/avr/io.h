@@ -0,0 +1,147 @@
+/*
+ * avr/io.h
+ * Host stand in for the ATmega2560 registers the timer and PWM classes use, bytes of one register file at their data space
+ * addresses, so the benchmarks run the register code of the tree against memory shared by every source. The register file
+ * is defined in stub/registers.cpp. Bit numbers are those of the 2560.
+ * Created: 10/19/2026 12:31:17 AM
+ *  Author: jg
+ */
+#ifndef AVR_IO_H_
+#define AVR_IO_H_
+#include <stdint.h>
+
+#define AVR_REGISTERS 0x200
+extern volatile uint8_t avrRegisters[AVR_REGISTERS];
+#define _SFR_MEM8(addr) (avrRegisters[(addr)])
+#define _BV(bit) (1 << (bit))
+
+#define TIFR0 _SFR_MEM8(0x35)
+#define TIFR1 _SFR_MEM8(0x36)
+#define TIFR2 _SFR_MEM8(0x37)
+#define TIFR3 _SFR_MEM8(0x38)
+#define TIFR4 _SFR_MEM8(0x39)
+#define TIFR5 _SFR_MEM8(0x3A)
+#define TCCR0A _SFR_MEM8(0x44)
+#define TCCR0B _SFR_MEM8(0x45)
+#define TCNT0 _SFR_MEM8(0x46)
+#define OCR0A _SFR_MEM8(0x47)
+#define OCR0B _SFR_MEM8(0x48)
+#define SREG _SFR_MEM8(0x5F)
+#define TIMSK0 _SFR_MEM8(0x6E)
+#define TIMSK1 _SFR_MEM8(0x6F)
+#define TIMSK2 _SFR_MEM8(0x70)
+#define TIMSK3 _SFR_MEM8(0x71)
+#define TIMSK4 _SFR_MEM8(0x72)
+#define TIMSK5 _SFR_MEM8(0x73)
+#define TCCR1A _SFR_MEM8(0x80)
+#define TCCR1B _SFR_MEM8(0x81)
+#define TCCR1C _SFR_MEM8(0x82)
+#define TCNT1L _SFR_MEM8(0x84)
+#define TCNT1H _SFR_MEM8(0x85)
+#define ICR1L _SFR_MEM8(0x86)
+#define ICR1H _SFR_MEM8(0x87)
+#define OCR1AL _SFR_MEM8(0x88)
+#define OCR1AH _SFR_MEM8(0x89)
+#define OCR1BL _SFR_MEM8(0x8A)
+#define OCR1BH _SFR_MEM8(0x8B)
+#define OCR1CL _SFR_MEM8(0x8C)
+#define OCR1CH _SFR_MEM8(0x8D)
+#define TCCR3A _SFR_MEM8(0x90)
+#define TCCR3B _SFR_MEM8(0x91)
+#define TCCR3C _SFR_MEM8(0x92)
+#define TCNT3L _SFR_MEM8(0x94)
+#define TCNT3H _SFR_MEM8(0x95)
+#define ICR3L _SFR_MEM8(0x96)
+#define ICR3H _SFR_MEM8(0x97)
+#define OCR3AL _SFR_MEM8(0x98)
+#define OCR3AH _SFR_MEM8(0x99)
+#define OCR3BL _SFR_MEM8(0x9A)
+#define OCR3BH _SFR_MEM8(0x9B)
+#define OCR3CL _SFR_MEM8(0x9C)
+#define OCR3CH _SFR_MEM8(0x9D)
+#define TCCR4A _SFR_MEM8(0xA0)
+#define TCCR4B _SFR_MEM8(0xA1)
+#define TCCR4C _SFR_MEM8(0xA2)
+#define TCNT4L _SFR_MEM8(0xA4)
+#define TCNT4H _SFR_MEM8(0xA5)
+#define ICR4L _SFR_MEM8(0xA6)
+#define ICR4H _SFR_MEM8(0xA7)
+#define OCR4AL _SFR_MEM8(0xA8)
+#define OCR4AH _SFR_MEM8(0xA9)
+#define OCR4BL _SFR_MEM8(0xAA)
+#define OCR4BH _SFR_MEM8(0xAB)
+#define OCR4CL _SFR_MEM8(0xAC)
+#define OCR4CH _SFR_MEM8(0xAD)
+#define TCCR2A _SFR_MEM8(0xB0)
+#define TCCR2B _SFR_MEM8(0xB1)
+#define TCNT2 _SFR_MEM8(0xB2)
+#define OCR2A _SFR_MEM8(0xB3)
+#define OCR2B _SFR_MEM8(0xB4)
+#define TCCR5A _SFR_MEM8(0x120)
+#define TCCR5B _SFR_MEM8(0x121)
+#define TCCR5C _SFR_MEM8(0x122)
+#define TCNT5L _SFR_MEM8(0x124)
+#define TCNT5H _SFR_MEM8(0x125)
+#define ICR5L _SFR_MEM8(0x126)
+#define ICR5H _SFR_MEM8(0x127)
+#define OCR5AL _SFR_MEM8(0x128)
+#define OCR5AH _SFR_MEM8(0x129)
+#define OCR5BL _SFR_MEM8(0x12A)
+#define OCR5BH _SFR_MEM8(0x12B)
+#define OCR5CL _SFR_MEM8(0x12C)
+#define OCR5CH _SFR_MEM8(0x12D)
+
+#define TOV0 0
+#define OCF0A 1
+#define OCF0B 2
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+#define TOV1 0
+#define OCF1A 1
+#define OCF1B 2
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define OCF1C 3
+#define ICF1 5
+#define OCIE1C 3
+#define ICIE1 5
+#define TOV2 0
+#define OCF2A 1
+#define OCF2B 2
+#define TOIE2 0
+#define OCIE2A 1
+#define OCIE2B 2
+#define TOV3 0
+#define OCF3A 1
+#define OCF3B 2
+#define TOIE3 0
+#define OCIE3A 1
+#define OCIE3B 2
+#define OCF3C 3
+#define ICF3 5
+#define OCIE3C 3
+#define ICIE3 5
+#define TOV4 0
+#define OCF4A 1
+#define OCF4B 2
+#define TOIE4 0
+#define OCIE4A 1
+#define OCIE4B 2
+#define OCF4C 3
+#define ICF4 5
+#define OCIE4C 3
+#define ICIE4 5
+#define TOV5 0
+#define OCF5A 1
+#define OCF5B 2
+#define TOIE5 0
+#define OCIE5A 1
+#define OCIE5B 2
+#define OCF5C 3
+#define ICF5 5
+#define OCIE5C 3
+#define ICIE5 5
+
+#endif /* AVR_IO_H_ */
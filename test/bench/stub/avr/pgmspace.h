@@ -0,0 +1,12 @@
+/*
+ * avr/pgmspace.h
+ * Host stand in, program memory is ordinary memory.
+ * Created: 10/19/2026 12:31:17 AM
+ *  Author: jg
+ */
+#ifndef AVR_PGMSPACE_H_
+#define AVR_PGMSPACE_H_
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(p))
+#endif /* AVR_PGMSPACE_H_ */
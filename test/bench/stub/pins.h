@@ -0,0 +1 @@
+// Host stand in for pins.h, the benchmarks need no pin map
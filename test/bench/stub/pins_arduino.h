@@ -0,0 +1,55 @@
+/*
+ * pins_arduino.h
+ * Host stand in for the Mega2560 pin map, the PWM pins 2 to 13 only. The tree keeps the register addresses in 16 bit
+ * program memory tables, which cannot hold a host address, so the ports here are arrays looked up by function.
+ * Created: 10/19/2026 12:31:17 AM
+ *  Author: jg
+ */
+#ifndef Pins_Arduino_h
+#define Pins_Arduino_h
+#include <stdint.h>
+#include <avr/io.h>
+
+#define NOT_A_PIN 0
+#define NOT_A_PORT 0
+#define NOT_ON_TIMER 0
+
+#define PB 2
+#define PE 5
+#define PG 7
+#define PH 8
+#define PORTS 13
+
+#define TIMER0A 1
+#define TIMER0B 2
+#define TIMER1A 3
+#define TIMER1B 4
+#define TIMER2A 5
+#define TIMER2B 6
+#define TIMER3A 7
+#define TIMER3B 8
+#define TIMER3C 9
+#define TIMER4A 10
+#define TIMER4B 11
+#define TIMER4C 12
+#define TIMER4D 13
+#define TIMER5A 14
+#define TIMER5B 15
+#define TIMER5C 16
+
+// port, bit and timer of pins 2 to 13 as on the Mega
+static const uint8_t pwmPinPort[12] = {PE, PE, PG, PE, PH, PH, PH, PH, PB, PB, PB, PB};
+static const uint8_t pwmPinBit[12] = {4, 5, 5, 3, 3, 4, 5, 6, 4, 5, 6, 7};
+static const uint8_t pwmPinTimer[12] = {TIMER3B, TIMER3C, TIMER0B, TIMER3A, TIMER4A, TIMER4B, TIMER4C, TIMER2B, TIMER2A, TIMER1A, TIMER1B, TIMER0A};
+// the port registers, defined in stub/registers.cpp, the tree reaches them through both byte and word pointers
+extern volatile uint16_t portOutput[PORTS];
+extern volatile uint16_t portInput[PORTS];
+extern volatile uint16_t portMode[PORTS];
+
+static inline uint8_t digitalPinToPort(uint8_t pin) { return (pin >= 2 && pin <= 13) ? pwmPinPort[pin - 2] : NOT_A_PIN; }
+static inline uint8_t digitalPinToBitMask(uint8_t pin) { return (pin >= 2 && pin <= 13) ? 1 << pwmPinBit[pin - 2] : 0; }
+static inline uint8_t digitalPinToTimer(uint8_t pin) { return (pin >= 2 && pin <= 13) ? pwmPinTimer[pin - 2] : NOT_ON_TIMER; }
+#define portOutputRegister(P) (&portOutput[(P)])
+#define portInputRegister(P) (&portInput[(P)])
+#define portModeRegister(P) (&portMode[(P)])
+#endif /* Pins_Arduino_h */
@@ -0,0 +1,13 @@
+/*
+ * registers.cpp
+ * The register file and ports of the host stand ins in avr/io.h and pins_arduino.h, one copy shared by every source of a benchmark.
+ * Created: 10/19/2026 12:31:17 AM
+ *  Author: jg
+ */
+#include <avr/io.h>
+#include <pins_arduino.h>
+
+volatile uint8_t avrRegisters[AVR_REGISTERS];
+volatile uint16_t portOutput[PORTS];
+volatile uint16_t portInput[PORTS];
+volatile uint16_t portMode[PORTS];